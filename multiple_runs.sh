@@ -1,6 +1,12 @@
 #!/bin/bash
 
+# Each of the 8 instances gets its share of the CPUs
+cpus=$(( $(nproc) / 8 ))
+if [ $cpus -lt 1 ] ; then
+    cpus=1
+fi
+
 for i in {0..7}
 do
-    ./run_exp.sh $(($i*1000 + 1)) &
+    CPUS=$cpus ./run_exp.sh $(($i*1000 + 1)) &
 done
@@ -12,16 +12,20 @@ init_run=$1
 
 trap "kill 0; exit 0" SIGINT SIGTERM EXIT
 
+# Share the CPUs (all of them unless CPUS is set) between the sweeps
+# spawned below, which all run at the same time
+cpus=${CPUS:-$(nproc)}
+sweeps=$(grep -c '^spawn_sim' "$0")
+jobs=$(( cpus / sweeps ))
+if [ $jobs -lt 1 ] ; then
+    jobs=1
+fi
+
+# Each sweep forks its workers from a single process, so the
+# memory limit below applies to every run separately
 function spawn_sim {
-    for (( run=$init_run; run<$(($init_run + 500)); run++ ))
-    do
-        RunValue="RngRun="$run
-        #echo $RunValue
-        export NS_GLOBAL_VALUE=$RunValue
-        ulimit -Sv 750000 # 1.5GB memory limit
-        #echo $1
-        time ./waf --run "$1 --simprefix=$2"
-    done
+    ulimit -Sv 750000 # 1.5GB memory limit
+    time ./waf --run "$1 --simprefix=$2 --RngRun=$init_run --runs=500 --jobs=$jobs"
 }
 
 # Packet Spray Lossless Red TCP
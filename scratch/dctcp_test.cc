@@ -78,7 +78,6 @@ main (int argc, char *argv[])
 
   //GlobalValue::Bind ("ChecksumEnabled", BooleanValue (true));
   //GlobalValue::Bind ("SchedulerType", TypeIdValue (CalendarScheduler::GetTypeId ())); //XXX: Crazy debugging idea
-  Packet::EnablePrinting ();
 
   bool tracing = false;
   uint32_t maxBytes = 0;
@@ -40,32 +40,6 @@ NS_LOG_COMPONENT_DEFINE ("OldiScript");
 
 const uint16_t port = 1337;   // Discard port (RFC 863)
 
-sgi::hash_map<Ptr<Socket>, Time, PtrHash> sockets;
-//std::map<Ptr<Socket>, Time> sockets;
-
-static void
-SockStart (Ptr<OutputStreamWrapper> stream, Ptr<Socket> s)
-{
-  //NS_LOG_UNCOND (Simulator::Now ().GetSeconds () << "\t" << s << " start");
-  //*stream->GetStream () << Simulator::Now ().GetSeconds () << "\t" << s << " start" << std::endl;
-  sockets[s] = Simulator::Now ();
-}
-
-static void
-SockStop (Ptr<OutputStreamWrapper> stream, Ptr<Socket> s, uint32_t totBytes)
-{
-  Time stop = Simulator::Now ();
-  Time start = sockets[s];
-  sockets.erase(s);
-  double completionTime = (stop - start).GetSeconds ();
-  //double bps = 8 * totBytes / completionTime;
-  std::ostringstream oss;
-  oss << "- [" << Simulator::Now ().GetSeconds () << ", ";
-  oss << completionTime << ", " << totBytes << ", 1]";
-  //NS_LOG_UNCOND (oss.str ());
-  *stream->GetStream () << oss.str () << std::endl;
-}
-
 #if 0
 void
 RttTracer (Time oldval, Time newval)
@@ -99,6 +73,18 @@ PrintTime (void)
     Simulator::Schedule (Seconds(0.005), &PrintTime);
 }
 
+/* Hands the flows of a flow trace to the bulk senders of their hosts */
+struct TraceFlows
+{
+    std::vector<Ptr<PersistentBulkSendApplication> > apps;
+    std::vector<Address> remotes;
+
+    void Start (uint32_t src, uint32_t dst, uint64_t bytes)
+    {
+        apps.at (src)->AddFlow (remotes.at (dst), bytes);
+    }
+};
+
 int main (int argc, char *argv[])
 {
 	// Turn on logging
@@ -107,9 +93,6 @@ int main (int argc, char *argv[])
 	LogComponentEnableAll(LOG_PREFIX_FUNC);
 //	LogComponentPrintList();
 
-        //XXX: Whoah.  Necessary for DCTCP to receive IP:CE
-        Packet::EnablePrinting ();
-
 	double linkBw = 10e9;		// Link bandwidth in bps
 	double linkDelay = 20e-6;	// Link delay in seconds (5ns = 1m wire)
         uint32_t threshold = 22.5e3;
@@ -128,9 +111,16 @@ int main (int argc, char *argv[])
         bool red = 0;
         bool pFabric = 0;
         bool lossless = 0;              // Use Lossless queues
+        bool virtualPayload = 0;        // Bulk flows send and receive zero-filled virtual payload
+        bool reuseConnections = 0;      // Incasts and bulk flows use long-lived connections
+        std::string flowCdf = "";       // Bulk flow size CDF file, "<bytes> <cdf>" per line
+        double bulkLoad = 0;            // Offered bulk load per host, 0 for back-to-back flows
+        std::string flowTrace = "";     // Flow trace file to replay instead of random bulk flows
 	int pausetime = 10;		// Pause duration in us
         double simLength = 1;           // Number of seconds in simulation
         std::string simPrefix = "OLDI_sim";
+        uint32_t runs = 1;              // Number of replications, from RngRun on
+        uint32_t jobs = 1;              // Replications running at the same time
 
 	CommandLine cmd;
 	cmd.AddValue("bw","Link bandwidth",linkBw);
@@ -149,8 +139,15 @@ int main (int argc, char *argv[])
         cmd.AddValue("red","Use RED/ECN with TCP",red);
         cmd.AddValue("pFabric","Use pFabric",pFabric);
         cmd.AddValue("lossless","Use Lossless queues",lossless);
+        cmd.AddValue("virtualPayload","Bulk flows carry virtual payload instead of packet data",virtualPayload);
+        cmd.AddValue("reuseConnections","Carry incasts and bulk flows over long-lived connections",reuseConnections);
+        cmd.AddValue("flowCdf","Draw bulk flow sizes from this CDF file",flowCdf);
+        cmd.AddValue("bulkLoad","Offered bulk load per host as a fraction of the link rate, with Poisson arrivals",bulkLoad);
+        cmd.AddValue("flowTrace","Replay the bulk flows of this flow trace file",flowTrace);
         cmd.AddValue("simLength", "Seconds in simulation", simLength);
         cmd.AddValue("simprefix", "The prefix for the logging files", simPrefix);
+        cmd.AddValue("runs", "Number of replications, with consecutive RngRun values", runs);
+        cmd.AddValue("jobs", "Number of replications run in parallel", jobs);
 	cmd.Parse (argc, argv);
 
         uint32_t segmentSize = 1460;
@@ -204,6 +201,8 @@ int main (int argc, char *argv[])
         } else if (dctcp || d2tcp) {
             NS_LOG_UNCOND ("Enabling DCTCP");
             Config::SetDefault ("ns3::TcpL4Protocol::SocketType", TypeIdValue (Dctcp::GetTypeId ()));
+            if (d2tcp)
+                Config::SetDefault ("ns3::Dctcp::ControlType", TypeIdValue (D2tcpControl::GetTypeId ()));
             queueType = "ns3::SimpleRedEcnQueue";
             n3 = "Th";
             v3 = Create<UintegerValue> (threshold);
@@ -234,6 +233,13 @@ int main (int argc, char *argv[])
             }
         }
 
+        /* Fork a worker per replication; each one builds and runs its own network */
+        SweepHelper sweep;
+        sweep.SetRuns (SeedManager::GetRun (), runs);
+        sweep.SetJobs (jobs);
+        if (!sweep.Fork ())
+            return sweep.GetFailures () > 0;
+
         /* Build the physical network */
         NodeContainer hosts; // Host nodes
 	Ipv4InterfaceContainer hostIfs;	// Host interfaces
@@ -309,6 +315,7 @@ int main (int argc, char *argv[])
         incastHelper->SetAttribute("IncastsPerSecond", UintegerValue (200 * numHosts));
         if (d2tcp)
             incastHelper->SetAttribute("TimeAllowed", TimeValue (Seconds (0.005)));
+        incastHelper->SetAttribute("ReuseConnections", BooleanValue (reuseConnections));
         incastHelper->SetAttribute("Trace", BooleanValue (true));
         incastHelper->SetAttribute("TraceName", StringValue (simPrefix));
         incastHelper->SetAggs (hosts);
@@ -321,15 +328,15 @@ int main (int argc, char *argv[])
 	const char* socketSpec = "ns3::TcpSocketFactory";
 	for (unsigned i = 0; i < numHosts; i++) {
 		PacketSinkHelper sink (socketSpec, Address(InetSocketAddress(Ipv4Address::GetAny(), port)));
+		sink.SetAttribute ("VirtualPayload", BooleanValue (virtualPayload));
 		ApplicationContainer app = sink.Install (hosts.Get (i));
 		app.Start (Seconds (0));
 	};
 
         // Create the traces for the bulk send application
         std::ostringstream oss;
-        oss << "bulkSend." << simPrefix << "-" << SeedManager::GetRun () << ".fct";
-        AsciiTraceHelper asciiTraceHelper;
-        Ptr<OutputStreamWrapper> stream = asciiTraceHelper.CreateFileStream (oss.str ());
+        oss << "bulkSend." << simPrefix << "-" << SeedManager::GetRun () << ".fctb";
+        Ptr<FlowRecordWriter> records = Create<FlowRecordWriter> (oss.str ());
 
         // Create the bulk send sources
         std::vector<uint64_t> bulkSizes;
@@ -346,18 +353,52 @@ int main (int argc, char *argv[])
         bulkSendFactory.SetTypeId ("ns3::PersistentBulkSendApplication");
         bulkSendFactory.Set ("SendSize", UintegerValue (4192));
         bulkSendFactory.Set ("Protocol", StringValue (socketSpec));
+        bulkSendFactory.Set ("VirtualPayload", BooleanValue (virtualPayload));
+        bulkSendFactory.Set ("ReuseConnections", BooleanValue (reuseConnections));
+        Ptr<FlowSizeDistribution> flowSizes;
+        if (!flowCdf.empty ()) {
+            flowSizes = Create<FlowSizeDistribution> ();
+            flowSizes->LoadCdf (flowCdf);
+        }
+        if (!flowTrace.empty ()) {
+            bulkSendFactory.Set ("Arrivals", EnumValue (PersistentBulkSendApplication::ARRIVALS_EXTERNAL));
+        } else if (bulkLoad > 0) {
+            double meanSize = 0;
+            if (flowSizes) {
+                meanSize = flowSizes->GetMean ();
+            } else {
+                for (unsigned i = 0; i < bulkSizes.size (); i++)
+                    meanSize += bulkSizes[i];
+                meanSize /= bulkSizes.size ();
+            }
+            NS_LOG_INFO ("Mean bulk flow size: " << meanSize);
+            bulkSendFactory.Set ("Arrivals", EnumValue (PersistentBulkSendApplication::ARRIVALS_POISSON));
+            bulkSendFactory.Set ("MeanArrivalInterval", TimeValue (Seconds (8 * meanSize / (bulkLoad * linkBw))));
+        }
+        TraceFlows traceFlows;
+        traceFlows.remotes = remoteHostAddrs;
         ApplicationContainer apps;
 	for (unsigned i = 0; i < numHosts; i++) {
             Ptr<PersistentBulkSendApplication> bulkSend = bulkSendFactory.Create<PersistentBulkSendApplication> ();
             bulkSend->SetRemotes (remoteHostAddrs);
             bulkSend->SetSizes (bulkSizes);
-            bulkSend->TraceConnectWithoutContext ("Start", MakeBoundCallback (&SockStart, stream));
-            bulkSend->TraceConnectWithoutContext ("Stop", MakeBoundCallback (&SockStop, stream));
+            if (flowSizes)
+                bulkSend->SetSizeDistribution (flowSizes);
+            bulkSend->TraceConnectWithoutContext ("FlowComplete", MakeCallback (&FlowRecordWriter::Record, records));
             hosts.Get (i)->AddApplication (bulkSend);
             apps.Add (bulkSend);
+            traceFlows.apps.push_back (bulkSend);
 	};
         apps.Start (Seconds (0));
 
+        Ptr<FlowTraceHelper> flowTraceHelper;
+        if (!flowTrace.empty ()) {
+            flowTraceHelper = Create<FlowTraceHelper> (flowTrace);
+            NS_ABORT_MSG_UNLESS (flowTraceHelper->IsValid (), "Cannot read flow trace " << flowTrace);
+            flowTraceHelper->SetFlowCallback (MakeCallback (&TraceFlows::Start, &traceFlows));
+            flowTraceHelper->Start ();
+        }
+
 	// Collect packet trace
 //	PointToPointHelper::EnablePcapAll ("FatTreeSimulation");
 //	std::ofstream ascii;
@@ -77,7 +77,6 @@ main (int argc, char *argv[])
   LogComponentEnableAll(LOG_PREFIX_FUNC);
 
   //GlobalValue::Bind ("ChecksumEnabled", BooleanValue (true));
-  Packet::EnablePrinting (); //XXX: Necessary!
 
   bool tracing = false;
   uint32_t maxBytes = 0;
@@ -0,0 +1,87 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "flow-trace-helper.h"
+#include "ns3/log.h"
+#include "ns3/simulator.h"
+
+NS_LOG_COMPONENT_DEFINE ("FlowTraceHelper");
+
+namespace ns3 {
+
+FlowTraceHelper::FlowTraceHelper (std::string filename, uint32_t batch)
+  : m_reader (filename),
+    m_batch (batch)
+{
+  NS_LOG_FUNCTION (this << filename << batch);
+}
+
+bool
+FlowTraceHelper::IsValid (void) const
+{
+  return m_reader.IsValid ();
+}
+
+void
+FlowTraceHelper::SetFlowCallback (FlowCallback cb)
+{
+  NS_LOG_FUNCTION (this);
+  m_flow = cb;
+}
+
+void
+FlowTraceHelper::Start (void)
+{
+  NS_LOG_FUNCTION (this);
+  NS_LOG_LOGIC ("Replaying " << m_reader.GetN () << " flows");
+  ScheduleBatch ();
+}
+
+void
+FlowTraceHelper::ScheduleBatch (void)
+{
+  NS_LOG_FUNCTION (this);
+
+  FlowTraceEntry entry;
+  Time delay;
+  for (uint32_t i = 0; i < m_batch; ++i)
+    {
+      if (!m_reader.Next (entry))
+        {
+          return;
+        }
+      delay = NanoSeconds (entry.start) - Simulator::Now ();
+      if (delay.IsNegative ())
+        {
+          delay = Seconds (0);
+        }
+      Simulator::Schedule (delay, &FlowTraceHelper::StartFlow, this, entry.src, entry.dst, entry.bytes);
+    }
+  // Read the next batch once the last flow of this one has started
+  Simulator::Schedule (delay, &FlowTraceHelper::ScheduleBatch, this);
+}
+
+void
+FlowTraceHelper::StartFlow (uint32_t src, uint32_t dst, uint64_t bytes)
+{
+  NS_LOG_FUNCTION (this << src << dst << bytes);
+  if (!m_flow.IsNull ())
+    {
+      m_flow (src, dst, bytes);
+    }
+}
+
+} // namespace ns3
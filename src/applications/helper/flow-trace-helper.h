@@ -0,0 +1,67 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef FLOW_TRACE_HELPER_H
+#define FLOW_TRACE_HELPER_H
+
+#include <stdint.h>
+#include <string>
+#include "ns3/callback.h"
+#include "ns3/simple-ref-count.h"
+#include "ns3/flow-workload.h"
+
+namespace ns3 {
+
+/**
+ * \brief Replays the flows of a flow trace file.
+ *
+ * Each flow is handed to the flow callback at its start time, typically
+ * to call AddFlow on the bulk send application of the source host. Only
+ * one batch of flows is scheduled at a time, so the event list does not
+ * grow with the length of the trace.
+ */
+class FlowTraceHelper : public SimpleRefCount<FlowTraceHelper>
+{
+public:
+  /// Called with the source host, destination host and size of a flow
+  typedef Callback<void, uint32_t, uint32_t, uint64_t> FlowCallback;
+
+  /**
+   * \param filename the flow trace file
+   * \param batch the number of flows scheduled at a time
+   */
+  FlowTraceHelper (std::string filename, uint32_t batch = 1024);
+
+  /// \return true if the trace file could be read
+  bool IsValid (void) const;
+
+  void SetFlowCallback (FlowCallback cb);
+
+  /// Start replaying the trace; flow start times are absolute
+  void Start (void);
+
+private:
+  void ScheduleBatch (void);
+  void StartFlow (uint32_t src, uint32_t dst, uint64_t bytes);
+
+  FlowTraceReader m_reader;
+  uint32_t m_batch;
+  FlowCallback m_flow;
+};
+
+} // namespace ns3
+
+#endif /* FLOW_TRACE_HELPER_H */
@@ -32,15 +32,14 @@
 #include "ns3/tcp-socket-factory.h"
 #include "ns3/names.h"
 
+#include <sstream>
+
 NS_LOG_COMPONENT_DEFINE ("IncastHelper");
 
 namespace ns3 {
 
 NS_OBJECT_ENSURE_REGISTERED (IncastHelper);
 
-sgi::hash_map<Ptr<Socket>, Time, PtrHash> IncastHelper::m_sockets;
-sgi::hash_map<Ptr<IncastAggregator>, Time, PtrHash> IncastHelper::m_incasts;
-
 #if 0
 If for every t > 0 the number of arrivals in the time interval [0,t] follows the Poisson distribution with mean λ t, then the sequence of inter-arrival times are independent and identically distributed exponential random variables having mean 1 / λ.[20]
 #endif
@@ -76,6 +75,11 @@ IncastHelper::GetTypeId (void)
                    TypeIdValue (TcpSocketFactory::GetTypeId ()),
                    MakeTypeIdAccessor (&IncastHelper::m_tid),
                    MakeTypeIdChecker ())
+    .AddAttribute ("ReuseConnections",
+                   "Carry incast requests and responses over long-lived connections",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&IncastHelper::m_reuse),
+                   MakeBooleanChecker ())
     .AddAttribute ("Trace", "True to enable tracing",
                    BooleanValue (false),
                    MakeBooleanAccessor (&IncastHelper::m_trace),
@@ -155,18 +159,19 @@ IncastHelper::Start (Time start)
     }
   m_aggFactory.Set ("Protocol", TypeIdValue (m_tid));
   m_senderFactory.Set ("Protocol", TypeIdValue (m_tid));
+  m_aggFactory.Set ("ReuseConnections", BooleanValue (m_reuse));
+  m_senderFactory.Set ("ReuseConnections", BooleanValue (m_reuse));
   m_nextIncastVar = ExponentialVariable (1.0 / m_incastsPerSecond);
 
   // Setup logging
   if (m_trace)
     {
-      AsciiTraceHelper asciiTraceHelper;
       std::ostringstream oss;
-      oss << "sockets." << m_fileName << "-" << SeedManager::GetRun () << ".fct";
-      m_sockStream = asciiTraceHelper.CreateFileStream (oss.str ());
+      oss << "sockets." << m_fileName << "-" << SeedManager::GetRun () << ".fctb";
+      m_sockRecords = Create<FlowRecordWriter> (oss.str ());
       oss.str ("");
-      oss << "incasts." << m_fileName << "-" << SeedManager::GetRun () << ".fct";
-      m_incastStream = asciiTraceHelper.CreateFileStream (oss.str ());
+      oss << "incasts." << m_fileName << "-" << SeedManager::GetRun () << ".fctb";
+      m_incastRecords = Create<FlowRecordWriter> (oss.str ());
     }
 
   // Install the senders
@@ -176,7 +181,7 @@ IncastHelper::Start (Time start)
         Ptr<Node> sender = *i;
         Ptr<Application> senderApp = m_senderFactory.Create<Application> ();
         sender->AddApplication(senderApp);
-        m_aggApps.Add (senderApp);
+        m_senderApps.Add (senderApp);
         senderApp->SetStartTime (start);
     }
 
@@ -216,6 +221,18 @@ IncastHelper::Stop (Time stop)
   //XXX: No-op for now.
 }
 
+ApplicationContainer
+IncastHelper::GetAggApps (void) const
+{
+  return m_aggApps;
+}
+
+ApplicationContainer
+IncastHelper::GetSenderApps (void) const
+{
+  return m_senderApps;
+}
+
 std::vector<Ipv4Address>
 IncastHelper::GetRandomSenders (uint32_t numSenders)
 {
@@ -244,22 +261,34 @@ IncastHelper::StartAgg (void)
   NS_LOG_LOGIC ("Starting an incast with " << numSenders <<
     " senders and an SRU of " << sru);
   
-  // Start an agg
+  // Start an agg, reusing one that finished its round on the same node
   int aggI = UniformVariable ().GetInteger (0, m_aggs.GetN () - 1);
   Ptr<Node> agg = m_aggs.Get (aggI);
-  Ptr<IncastAggregator> aggApp = m_aggFactory.Create<IncastAggregator> ();
-  aggApp->SetSenders (GetRandomSenders (numSenders));
-  aggApp->SetRoundFinishCallback (
-    MakeCallback (&IncastHelper::HandleRoundFinish, this));
-  agg->AddApplication(aggApp);
-  m_aggApps.Add (aggApp);
-  aggApp->SetStartTime (Simulator::Now ());
-  if (m_trace)
+  std::vector<Ptr<IncastAggregator> > &idle = m_idleAggs[agg->GetId ()];
+  if (!idle.empty ())
     {
-      aggApp->TraceConnectWithoutContext ("SockStart", MakeBoundCallback (&IncastHelper::SockStart, m_sockStream));
-      aggApp->TraceConnectWithoutContext ("SockStop", MakeBoundCallback (&IncastHelper::SockStop, m_sockStream));
-      aggApp->TraceConnectWithoutContext ("Start", MakeBoundCallback (&IncastHelper::IncastStart, m_incastStream));
-      aggApp->TraceConnectWithoutContext ("Stop", MakeBoundCallback (&IncastHelper::IncastStop, m_incastStream));
+      Ptr<IncastAggregator> aggApp = idle.back ();
+      idle.pop_back ();
+      aggApp->SetAttribute ("SRU", UintegerValue (sru));
+      aggApp->SetSenders (GetRandomSenders (numSenders));
+      aggApp->SetStartTime (Seconds (0));
+      aggApp->Restart ();
+    }
+  else
+    {
+      Ptr<IncastAggregator> aggApp = m_aggFactory.Create<IncastAggregator> ();
+      aggApp->SetSenders (GetRandomSenders (numSenders));
+      aggApp->SetRoundFinishCallback (
+        MakeCallback (&IncastHelper::HandleRoundFinish, this));
+      agg->AddApplication(aggApp);
+      m_aggApps.Add (aggApp);
+      // The start time counts from now, when the node starts the application
+      aggApp->SetStartTime (Seconds (0));
+      if (m_trace)
+        {
+          aggApp->TraceConnectWithoutContext ("FlowComplete", MakeCallback (&FlowRecordWriter::Record, m_sockRecords));
+          aggApp->TraceConnectWithoutContext ("IncastComplete", MakeCallback (&FlowRecordWriter::Record, m_incastRecords));
+        }
     }
 
   NS_LOG_LOGIC ("Starting Agg app at node " << agg->GetId ());
@@ -276,62 +305,8 @@ IncastHelper::HandleRoundFinish (Ptr<IncastAggregator> aggApp)
 {
   NS_LOG_FUNCTION (this);
 
-  //TODO: Just stop the application for now
-  aggApp->SetStopTime (Simulator::Now ());
-
-  //XXX: start next round
-  //aggApp->SetStartTime (Simulator::Now ());
-  //XXX: Doesn't actually restart the 
-  //aggApp->DoStart (); //Actually schedule the next round
-}
-
-void
-IncastHelper::SockStart (Ptr<OutputStreamWrapper> stream, Ptr<Socket> s)
-{
-  //NS_LOG_UNCOND (Simulator::Now ().GetSeconds () << "\t" << s << " start");
-  //*stream->GetStream () << Simulator::Now ().GetSeconds () << "\t" << s << " start" << std::endl;
-  m_sockets[s] = Simulator::Now ();
-}
-
-void
-IncastHelper::SockStop (Ptr<OutputStreamWrapper> stream, Ptr<Socket> s, uint32_t totBytes)
-{
-  Time stop = Simulator::Now ();
-  Time start = m_sockets[s];
-  m_sockets.erase(s);
-  double completionTime = (stop - start).GetSeconds ();
-  //double bps = 8 * totBytes / completionTime;
-  std::ostringstream oss;
-  oss << "- [" << Simulator::Now ().GetSeconds () << ", ";
-  oss << completionTime << ", " << totBytes << ", 1]";
-  //NS_LOG_UNCOND (oss.str ());
-  *stream->GetStream () << oss.str () << std::endl;
-}
-
-void
-IncastHelper::IncastStart (Ptr<OutputStreamWrapper> stream, Ptr<IncastAggregator> app)
-{
-  //NS_LOG_UNCOND (Simulator::Now ().GetSeconds () << "\t" << app << " start");
-  //*stream->GetStream () << Simulator::Now ().GetSeconds () << "\t" << app << " start" << std::endl;
-  m_incasts[app] = Simulator::Now ();
-}
-
-void
-IncastHelper::IncastStop (Ptr<OutputStreamWrapper> stream, Ptr<IncastAggregator> app, uint32_t totBytes)
-{
-  Time stop = Simulator::Now ();
-  Time start = m_incasts[app];
-  m_incasts.erase(app);
-  double completionTime = (stop - start).GetSeconds ();
-  //double bps = 8 * totBytes / completionTime;
-  UintegerValue sru;
-  app->GetAttribute("SRU", sru);
-  int numflows = totBytes / sru.Get ();
-  std::ostringstream oss;
-  oss << "- [" << Simulator::Now ().GetSeconds () << ", ";
-  oss << completionTime << ", " << totBytes << ", " << numflows << "]";
-  //NS_LOG_UNCOND (oss.str ());
-  *stream->GetStream () << oss.str () << std::endl;
+  // Keep the finished aggregator for a later incast on the same node
+  m_idleAggs[aggApp->GetNode ()->GetId ()].push_back (aggApp);
 }
 
 } // namespace ns3
@@ -25,6 +25,8 @@
 
 #include <stdint.h>
 #include <string>
+#include <map>
+#include <vector>
 #include "ns3/object-factory.h"
 #include "ns3/address.h"
 #include "ns3/attribute.h"
@@ -35,8 +37,7 @@
 #include "ns3/net-device.h"
 #include "ns3/node-container.h"
 #include "ns3/random-variable.h"
-#include "ns3/sgi-hashmap.h"
-#include "ns3/trace-helper.h"
+#include "ns3/flow-record.h"
 #include "ns3/traced-callback.h"
 #include "ns3/application-container.h"
 
@@ -119,6 +120,18 @@ public:
 
   void SetSenderSizes (std::vector<uint32_t> senderSizes);
 
+  /**
+   * \return the aggregator applications created so far. An aggregator
+   * whose round has finished is reused for a later incast on its node,
+   * so this holds each of them once.
+   */
+  ApplicationContainer GetAggApps (void) const;
+
+  /**
+   * \return the sender applications, one per sender node
+   */
+  ApplicationContainer GetSenderApps (void) const;
+
 private:
   std::vector<Ipv4Address> GetRandomSenders (uint32_t numSenders);
   void StartAgg (void);
@@ -134,6 +147,7 @@ private:
 
   NodeContainer m_aggs;     // Aggregator nodes
   ApplicationContainer m_aggApps; // Aggregator applications
+  std::map<uint32_t, std::vector<Ptr<IncastAggregator> > > m_idleAggs; // Finished aggregators by node id
   NodeContainer m_senders;  // Sender nodes
   ApplicationContainer m_senderApps; // Sender applications
   std::vector<Ipv4Address> m_senderAddrs;	// Sender Addresses
@@ -141,16 +155,10 @@ private:
 
   //bool m_persistent;
   bool m_trace;
+  bool m_reuse;
   std::string m_fileName;
-  Ptr<OutputStreamWrapper> m_sockStream;
-  Ptr<OutputStreamWrapper> m_incastStream;
-
-  static sgi::hash_map<Ptr<Socket>, Time, PtrHash> m_sockets;
-  static sgi::hash_map<Ptr<IncastAggregator>, Time, PtrHash> m_incasts;
-  static void SockStart (Ptr<OutputStreamWrapper> stream, Ptr<Socket> s);
-  static void SockStop (Ptr<OutputStreamWrapper> stream, Ptr<Socket> s, uint32_t totBytes);
-  static void IncastStart (Ptr<OutputStreamWrapper> stream, Ptr<IncastAggregator> app);
-  static void IncastStop (Ptr<OutputStreamWrapper> stream, Ptr<IncastAggregator> app, uint32_t totBytes);
+  Ptr<FlowRecordWriter> m_sockRecords;    // Completed incast flows
+  Ptr<FlowRecordWriter> m_incastRecords;  // Completed incasts
 };
 
 } // namespace ns3
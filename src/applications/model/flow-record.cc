@@ -0,0 +1,107 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ns3/log.h"
+#include "ns3/abort.h"
+#include "ns3/simulator.h"
+#include "flow-record.h"
+
+#include <cstring>
+
+NS_LOG_COMPONENT_DEFINE ("FlowRecord");
+
+namespace ns3 {
+
+static const char g_flowRecordMagic[8] = { 'N', 'S', '3', 'F', 'C', 'T', '0', '1' };
+
+FlowRecordWriter::FlowRecordWriter (std::string filename, uint32_t batch)
+  : m_file (filename.c_str (), std::ios::out | std::ios::binary | std::ios::trunc),
+    m_batch (batch)
+{
+  NS_LOG_FUNCTION (this << filename << batch);
+  NS_ABORT_MSG_UNLESS (m_file.good (), "Unable to open flow record file " << filename);
+  m_file.write (g_flowRecordMagic, sizeof (g_flowRecordMagic));
+  m_buffer.reserve (m_batch);
+  // The writer may outlive the simulation, or never be released if its
+  // trace sinks are leaked, so write out the records when it ends
+  Simulator::ScheduleDestroy (&FlowRecordWriter::Flush, Ptr<FlowRecordWriter> (this));
+}
+
+FlowRecordWriter::~FlowRecordWriter ()
+{
+  NS_LOG_FUNCTION (this);
+  Flush ();
+}
+
+void
+FlowRecordWriter::Record (Time start, uint64_t bytes, uint32_t flows)
+{
+  NS_LOG_FUNCTION (this << start << bytes << flows);
+  Time stop = Simulator::Now ();
+  FlowRecord record;
+  record.stop = stop.GetNanoSeconds ();
+  record.duration = (stop - start).GetNanoSeconds ();
+  record.bytes = bytes;
+  record.flows = flows;
+  record.reserved = 0;
+  m_buffer.push_back (record);
+  if (m_buffer.size () >= m_batch)
+    {
+      Flush ();
+    }
+}
+
+void
+FlowRecordWriter::Flush (void)
+{
+  NS_LOG_FUNCTION (this);
+  if (!m_buffer.empty ())
+    {
+      m_file.write (reinterpret_cast<const char *> (&m_buffer[0]), m_buffer.size () * sizeof (FlowRecord));
+      m_buffer.clear ();
+    }
+  m_file.flush ();
+}
+
+FlowRecordReader::FlowRecordReader (std::string filename)
+  : m_file (filename.c_str (), std::ios::in | std::ios::binary),
+    m_valid (false)
+{
+  NS_LOG_FUNCTION (this << filename);
+  char magic[sizeof (g_flowRecordMagic)];
+  if (m_file.read (magic, sizeof (magic)))
+    {
+      m_valid = std::memcmp (magic, g_flowRecordMagic, sizeof (magic)) == 0;
+    }
+}
+
+bool
+FlowRecordReader::IsValid (void) const
+{
+  return m_valid;
+}
+
+bool
+FlowRecordReader::Next (FlowRecord &record)
+{
+  if (!m_valid)
+    {
+      return false;
+    }
+  return m_file.read (reinterpret_cast<char *> (&record), sizeof (FlowRecord)).gcount () == sizeof (FlowRecord);
+}
+
+} // namespace ns3
@@ -0,0 +1,107 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef FLOW_RECORD_H
+#define FLOW_RECORD_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <fstream>
+#include "ns3/nstime.h"
+#include "ns3/simple-ref-count.h"
+
+namespace ns3 {
+
+/**
+ * \ingroup applications
+ *
+ * One completed flow, as stored in a flow record file. A file is the
+ * 8-byte magic "NS3FCT01" followed by fixed-size records in the host's
+ * byte order; utils/fct_records.py reads it on the analysis side.
+ */
+struct FlowRecord
+{
+  int64_t  stop;      //< Completion time, in nanoseconds
+  int64_t  duration;  //< Flow completion time, in nanoseconds
+  uint64_t bytes;     //< Bytes transferred
+  uint32_t flows;     //< Number of flows, more than one for an incast
+  uint32_t reserved;
+};
+
+/**
+ * \ingroup applications
+ *
+ * Writes FlowRecords to a file in batches. Connect Record() to the
+ * FlowComplete trace source of the applications to log their flows.
+ * The last batch is written when the writer is released, or at the
+ * latest by Simulator::Destroy().
+ */
+class FlowRecordWriter : public SimpleRefCount<FlowRecordWriter>
+{
+public:
+  /**
+   * \param filename the file to create
+   * \param batch the number of records buffered before a write
+   */
+  FlowRecordWriter (std::string filename, uint32_t batch = 4096);
+  ~FlowRecordWriter ();
+
+  /**
+   * Add a flow completing now
+   *
+   * \param start the time the flow started
+   * \param bytes the bytes transferred
+   * \param flows the number of flows making up the transfer
+   */
+  void Record (Time start, uint64_t bytes, uint32_t flows);
+
+  /// Write out the buffered records
+  void Flush (void);
+
+private:
+  std::ofstream m_file;
+  std::vector<FlowRecord> m_buffer;
+  uint32_t m_batch;
+};
+
+/**
+ * \ingroup applications
+ *
+ * Reads back the FlowRecords of a file made by FlowRecordWriter.
+ */
+class FlowRecordReader
+{
+public:
+  FlowRecordReader (std::string filename);
+
+  /// \return true if the file was opened and has the flow record magic
+  bool IsValid (void) const;
+
+  /**
+   * \param record filled with the next record of the file
+   * \return false at the end of the file
+   */
+  bool Next (FlowRecord &record);
+
+private:
+  std::ifstream m_file;
+  bool m_valid;
+};
+
+} // namespace ns3
+
+#endif /* FLOW_RECORD_H */
@@ -0,0 +1,218 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ns3/log.h"
+#include "ns3/abort.h"
+#include "flow-workload.h"
+
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+NS_LOG_COMPONENT_DEFINE ("FlowWorkload");
+
+namespace ns3 {
+
+static const char g_flowTraceMagic[8] = { 'N', 'S', '3', 'F', 'L', 'W', '0', '1' };
+
+FlowSizeDistribution::FlowSizeDistribution ()
+  : m_mean (0),
+    m_uniform (0, 1)
+{
+  NS_LOG_FUNCTION (this);
+}
+
+void
+FlowSizeDistribution::SetCdf (const std::vector<uint64_t> &sizes, const std::vector<double> &cdf)
+{
+  NS_LOG_FUNCTION (this);
+  NS_ABORT_MSG_IF (sizes.empty () || sizes.size () != cdf.size (), "A flow size CDF needs one probability per size");
+  NS_ABORT_MSG_IF (std::abs (cdf.back () - 1) > 1e-6, "A flow size CDF must end at 1, not " << cdf.back ());
+
+  // One segment per CDF step; the first point is a point mass
+  m_segments.clear ();
+  std::vector<double> probs;
+  m_mean = 0;
+  for (uint32_t i = 0; i < sizes.size (); i++)
+    {
+      double low = i ? cdf[i - 1] : 0;
+      NS_ABORT_MSG_IF (cdf[i] < low || (i && sizes[i] < sizes[i - 1]),
+                       "Flow size CDF is not increasing at size " << sizes[i]);
+      if (cdf[i] == low)
+        {
+          continue;
+        }
+      Segment s;
+      s.low = i ? sizes[i - 1] : sizes[0];
+      s.high = sizes[i];
+      m_segments.push_back (s);
+      probs.push_back (cdf[i] - low);
+      m_mean += (cdf[i] - low) * (s.low + s.high) / 2.0;
+    }
+
+  // Walker's alias table: every slot has probability 1/n, split between
+  // its own segment and at most one other
+  uint32_t n = m_segments.size ();
+  std::vector<uint32_t> small, large;
+  for (uint32_t i = 0; i < n; i++)
+    {
+      probs[i] *= n;
+      m_segments[i].alias = i;
+      (probs[i] < 1 ? small : large).push_back (i);
+    }
+  while (!small.empty () && !large.empty ())
+    {
+      uint32_t s = small.back ();
+      small.pop_back ();
+      uint32_t l = large.back ();
+      m_segments[s].prob = probs[s];
+      m_segments[s].alias = l;
+      probs[l] -= 1 - probs[s];
+      if (probs[l] < 1)
+        {
+          large.pop_back ();
+          small.push_back (l);
+        }
+    }
+  // What is left is 1 up to rounding
+  for (uint32_t i = 0; i < small.size (); i++)
+    {
+      m_segments[small[i]].prob = 1;
+    }
+  for (uint32_t i = 0; i < large.size (); i++)
+    {
+      m_segments[large[i]].prob = 1;
+    }
+}
+
+void
+FlowSizeDistribution::LoadCdf (std::string filename)
+{
+  NS_LOG_FUNCTION (this << filename);
+  std::ifstream file (filename.c_str ());
+  NS_ABORT_MSG_UNLESS (file.good (), "Unable to open flow size CDF " << filename);
+
+  std::vector<uint64_t> sizes;
+  std::vector<double> cdf;
+  std::string line;
+  while (std::getline (file, line))
+    {
+      if (line.empty () || line[0] == '#')
+        {
+          continue;
+        }
+      std::istringstream iss (line);
+      uint64_t size;
+      double p;
+      NS_ABORT_MSG_UNLESS (iss >> size >> p, "Bad line in flow size CDF " << filename << ": " << line);
+      sizes.push_back (size);
+      cdf.push_back (p);
+    }
+  SetCdf (sizes, cdf);
+}
+
+uint64_t
+FlowSizeDistribution::Sample (void)
+{
+  NS_ASSERT_MSG (!m_segments.empty (), "Flow size distribution has no CDF");
+  double u = m_uniform.GetValue () * m_segments.size ();
+  uint32_t i = static_cast<uint32_t> (u);
+  if (i >= m_segments.size ())
+    {
+      i = m_segments.size () - 1;
+    }
+  const Segment &s = (u - i < m_segments[i].prob) ? m_segments[i] : m_segments[m_segments[i].alias];
+  uint64_t size = s.low + static_cast<uint64_t> (m_uniform.GetValue () * (s.high - s.low) + 0.5);
+  return size ? size : 1;
+}
+
+double
+FlowSizeDistribution::GetMean (void) const
+{
+  return m_mean;
+}
+
+FlowTraceReader::FlowTraceReader (std::string filename)
+  : m_map (0),
+    m_length (0),
+    m_entries (0),
+    m_n (0),
+    m_next (0)
+{
+  NS_LOG_FUNCTION (this << filename);
+  int fd = open (filename.c_str (), O_RDONLY);
+  if (fd < 0)
+    {
+      return;
+    }
+  struct stat st;
+  if (fstat (fd, &st) == 0 && st.st_size >= (off_t)sizeof (g_flowTraceMagic))
+    {
+      void *map = mmap (0, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (map != MAP_FAILED)
+        {
+          m_map = map;
+          m_length = st.st_size;
+        }
+    }
+  close (fd);
+  if (m_map && std::memcmp (m_map, g_flowTraceMagic, sizeof (g_flowTraceMagic)) == 0)
+    {
+      madvise (m_map, m_length, MADV_SEQUENTIAL);
+      m_entries = reinterpret_cast<const FlowTraceEntry *> (static_cast<const char *> (m_map) + sizeof (g_flowTraceMagic));
+      m_n = (m_length - sizeof (g_flowTraceMagic)) / sizeof (FlowTraceEntry);
+    }
+}
+
+FlowTraceReader::~FlowTraceReader ()
+{
+  NS_LOG_FUNCTION (this);
+  if (m_map)
+    {
+      munmap (m_map, m_length);
+    }
+}
+
+bool
+FlowTraceReader::IsValid (void) const
+{
+  return m_entries != 0;
+}
+
+uint64_t
+FlowTraceReader::GetN (void) const
+{
+  return m_n;
+}
+
+bool
+FlowTraceReader::Next (FlowTraceEntry &entry)
+{
+  if (m_next >= m_n)
+    {
+      return false;
+    }
+  // The entries follow an 8-byte magic, so copy rather than rely on alignment
+  std::memcpy (&entry, &m_entries[m_next++], sizeof (FlowTraceEntry));
+  return true;
+}
+
+} // namespace ns3
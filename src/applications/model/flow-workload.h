@@ -0,0 +1,126 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef FLOW_WORKLOAD_H
+#define FLOW_WORKLOAD_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include "ns3/random-variable.h"
+#include "ns3/simple-ref-count.h"
+
+namespace ns3 {
+
+/**
+ * \ingroup applications
+ *
+ * An empirical flow size distribution, given as the points of its CDF.
+ * Sizes are interpolated linearly between consecutive points, and the
+ * segment is picked with Walker's alias method, so a sample costs two
+ * uniform draws whatever the number of points.
+ */
+class FlowSizeDistribution : public SimpleRefCount<FlowSizeDistribution>
+{
+public:
+  FlowSizeDistribution ();
+
+  /**
+   * \param sizes flow sizes in bytes, in increasing order
+   * \param cdf the fraction of flows no larger than each size, ending in 1
+   *
+   * The probability at the first point is a point mass at that size.
+   */
+  void SetCdf (const std::vector<uint64_t> &sizes, const std::vector<double> &cdf);
+
+  /**
+   * Read the CDF from a text file with one "<bytes> <cdf>" pair per line.
+   * Empty lines and lines starting with '#' are skipped.
+   */
+  void LoadCdf (std::string filename);
+
+  /// \return a flow size in bytes, at least one
+  uint64_t Sample (void);
+
+  /// \return the mean flow size in bytes
+  double GetMean (void) const;
+
+private:
+  struct Segment
+  {
+    double   prob;    //< Probability of keeping this segment in its slot
+    uint32_t alias;   //< Segment taken otherwise
+    uint64_t low;     //< Smallest size of the segment
+    uint64_t high;    //< Largest size of the segment
+  };
+  std::vector<Segment> m_segments;
+  double m_mean;
+  UniformVariable m_uniform;
+};
+
+/**
+ * \ingroup applications
+ *
+ * One flow of a flow trace file. A file is the 8-byte magic "NS3FLW01"
+ * followed by fixed-size entries in the host's byte order, sorted by
+ * start time; utils/flow_trace.py writes it from text.
+ */
+struct FlowTraceEntry
+{
+  int64_t  start;     //< Start time, in nanoseconds
+  uint32_t src;       //< Index of the sending host
+  uint32_t dst;       //< Index of the receiving host
+  uint64_t bytes;     //< Flow size
+};
+
+/**
+ * \ingroup applications
+ *
+ * Reads the entries of a flow trace file. The file is mapped into
+ * memory rather than read, so a long trace costs no heap.
+ */
+class FlowTraceReader
+{
+public:
+  FlowTraceReader (std::string filename);
+  ~FlowTraceReader ();
+
+  /// \return true if the file was mapped and has the flow trace magic
+  bool IsValid (void) const;
+
+  /// \return the number of entries in the file
+  uint64_t GetN (void) const;
+
+  /**
+   * \param entry filled with the next entry of the file
+   * \return false at the end of the file
+   */
+  bool Next (FlowTraceEntry &entry);
+
+private:
+  FlowTraceReader (const FlowTraceReader &);
+  FlowTraceReader &operator = (const FlowTraceReader &);
+
+  void *m_map;
+  uint64_t m_length;
+  const FlowTraceEntry *m_entries;
+  uint64_t m_n;
+  uint64_t m_next;
+};
+
+} // namespace ns3
+
+#endif /* FLOW_WORKLOAD_H */
@@ -50,6 +50,12 @@ IncastAggregator::GetTypeId (void)
                    TypeIdValue (TcpNewReno::GetTypeId ()),
                    MakeTypeIdAccessor (&IncastAggregator::m_tid),
                    MakeTypeIdChecker ())
+    .AddAttribute ("ReuseConnections",
+                   "Keep one connection per sender open across rounds and send each "
+                   "request as a 4-byte SRU over it instead of connecting per round",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&IncastAggregator::m_reuse),
+                   MakeBooleanChecker ())
     .AddTraceSource ("SockStart", "A transfer (socket) starts",
                      MakeTraceSourceAccessor (&IncastAggregator::m_sockStart))
     .AddTraceSource ("SockStop", "A transfer (socket) stops",
@@ -58,6 +64,10 @@ IncastAggregator::GetTypeId (void)
                      MakeTraceSourceAccessor (&IncastAggregator::m_start))
     .AddTraceSource ("Stop", "A transfer (socket) stops",
                      MakeTraceSourceAccessor (&IncastAggregator::m_stop))
+    .AddTraceSource ("FlowComplete", "A transfer (socket) completes, with its start time, bytes and number of flows",
+                     MakeTraceSourceAccessor (&IncastAggregator::m_flowComplete))
+    .AddTraceSource ("IncastComplete", "An incast completes, with its start time, bytes and number of flows",
+                     MakeTraceSourceAccessor (&IncastAggregator::m_incastComplete))
   ;
   return tid;
 }
@@ -66,7 +76,8 @@ IncastAggregator::GetTypeId (void)
 IncastAggregator::IncastAggregator ()
   : m_running (false),
     m_closeCount (0),
-    m_byteCount (0)
+    m_byteCount (0),
+    m_reuse (false)
 {
   NS_LOG_FUNCTION (this);
 }
@@ -82,6 +93,9 @@ IncastAggregator::DoDispose (void)
   NS_LOG_FUNCTION (this);
 
   m_sockets.clear ();
+  m_connections.clear ();
+  m_requests.clear ();
+  m_received.clear ();
   // chain up
   Application::DoDispose ();
 }
@@ -104,8 +118,15 @@ void IncastAggregator::StartApplication (void) // Called at time specified by St
   m_running = true;
   m_closeCount = 0;
   m_byteCount = 0;
+  m_roundStart = Simulator::Now ();
   m_start (this->GetObject<IncastAggregator> ());
 
+  if (m_reuse)
+    {
+      StartReuseRound ();
+      return;
+    }
+
   // Connection initiator. Connect to each peer and wait for data.
   for (std::vector<Ipv4Address>::iterator i = m_senders.begin (); i != m_senders.end (); ++i)
     {
@@ -140,6 +161,77 @@ void IncastAggregator::StartApplication (void) // Called at time specified by St
     }
 }
 
+void IncastAggregator::StartReuseRound (void)
+{
+  NS_LOG_FUNCTION (this);
+
+  for (std::vector<Ipv4Address>::iterator i = m_senders.begin (); i != m_senders.end (); ++i)
+    {
+      Ptr<Socket> s;
+      std::map<Ipv4Address, Ptr<Socket> >::iterator it = m_connections.find (*i);
+      if (it != m_connections.end ())
+        {
+          s = it->second;
+        }
+      else
+        {
+          s = Socket::CreateSocket (GetNode (), m_tid);
+          if (s->GetSocketType () != Socket::NS3_SOCK_STREAM &&
+              s->GetSocketType () != Socket::NS3_SOCK_SEQPACKET)
+            {
+              NS_FATAL_ERROR ("Only NS_SOCK_STREAM or NS_SOCK_SEQPACKET sockets are allowed.");
+            }
+          NS_LOG_LOGIC ("Connect to " << *i);
+          s->Bind ();
+          m_sockStart (s);
+          s->Connect (InetSocketAddress (*i, m_port));
+          s->SetRecvCallback (MakeCallback (&IncastAggregator::HandleReuseRead, this));
+          s->SetCloseCallbacks (
+            MakeCallback (&IncastAggregator::HandleClose, this),
+            MakeCallback (&IncastAggregator::HandleClose, this));
+          m_connections[*i] = s;
+          m_requests[s] = 0;
+          m_received[s] = 0;
+        }
+
+      // A request is the SRU itself. Requests sent before the connection
+      // is established wait in the socket's buffer.
+      Ptr<Packet> packet = Create<Packet> ((uint8_t *)&m_sru, sizeof(m_sru));
+      int actual = s->Send (packet);
+      NS_ASSERT (actual == sizeof(m_sru));
+      ++m_requests[s];
+    }
+}
+
+void IncastAggregator::HandleReuseRead (Ptr<Socket> socket)
+{
+  NS_LOG_FUNCTION (this << socket);
+  uint32_t &received = m_received[socket];
+  uint32_t &requests = m_requests[socket];
+  Ptr<Packet> packet;
+  while (packet = socket->Recv ())
+    {
+      m_byteCount += packet->GetSize ();
+      received += packet->GetSize ();
+    }
+
+  // Responses to the same connection arrive back to back
+  while (requests > 0 && received >= m_sru)
+    {
+      received -= m_sru;
+      --requests;
+      ++m_closeCount;
+      m_sockStop (socket, m_sru);
+      m_flowComplete (m_roundStart, m_sru, 1);
+      if (m_closeCount == m_senders.size ())
+        {
+          m_running = false;
+          m_closeCount = 0;
+          Simulator::ScheduleNow (&IncastAggregator::RoundFinish, this);
+        }
+    }
+}
+
 #if 0
 void IncastAggregator::HandleAdmCtrl (Ptr<TcpAdmCtrl> sock, Ipv4Address addr, uint16_t port)
 {
@@ -173,8 +265,25 @@ void IncastAggregator::HandleRead (Ptr<Socket> socket)
 void IncastAggregator::HandleClose (Ptr<Socket> socket)
 {
   NS_LOG_FUNCTION (this << socket);
+  if (m_reuse)
+    {
+      NS_LOG_WARN ("Reused connection " << socket << " closed");
+      for (std::map<Ipv4Address, Ptr<Socket> >::iterator i = m_connections.begin ();
+           i != m_connections.end (); ++i)
+        {
+          if (i->second == socket)
+            {
+              m_connections.erase (i);
+              break;
+            }
+        }
+      m_requests.erase (socket);
+      m_received.erase (socket);
+      return;
+    }
   ++m_closeCount;
   m_sockStop(socket, m_sru);
+  m_flowComplete (m_roundStart, m_sru, 1);
   m_sockets.remove (socket);
   if (m_closeCount == m_senders.size ())
     {
@@ -199,6 +308,7 @@ void IncastAggregator::RoundFinish (void)
   NS_LOG_FUNCTION (this);
   NS_ASSERT (m_byteCount == m_sru * m_senders.size ());
   m_stop (this->GetObject<IncastAggregator> (), m_sru * m_senders.size ());
+  m_incastComplete (m_roundStart, m_sru * m_senders.size (), m_senders.size ());
   if (!m_roundFinish.IsNull ())
     m_roundFinish (this->GetObject<IncastAggregator> ());
 }
@@ -211,6 +321,25 @@ void IncastAggregator::StopApplication (void) // Called at time specified by Sto
     {
       (*i)->Close ();
     }
+  std::map<Ipv4Address, Ptr<Socket> > connections = m_connections;
+  for (std::map<Ipv4Address, Ptr<Socket> >::iterator i = connections.begin (); i != connections.end (); ++i)
+    {
+      i->second->Close ();
+    }
+}
+
+void IncastAggregator::Restart (void)
+{
+  NS_LOG_FUNCTION (this);
+  NS_ASSERT (!m_running);
+  Simulator::ScheduleWithContext (GetNode ()->GetId (), Seconds (0),
+                                  &IncastAggregator::DoRestart, this);
+}
+
+void IncastAggregator::DoRestart (void)
+{
+  NS_LOG_FUNCTION (this);
+  m_startEvent = Simulator::Schedule (m_startTime, &IncastAggregator::StartApplication, this);
 }
 
 void IncastAggregator::SetRoundFinishCallback (Callback<void, Ptr<IncastAggregator> > cb)
@@ -25,6 +25,9 @@
 #include "ns3/ipv4-interface-container.h"
 #include "ns3/inet-socket-address.h"
 #include "ns3/traced-callback.h"
+#include "ns3/nstime.h"
+
+#include <map>
 
 //class TcpAdmCtrl;
 
@@ -58,6 +61,13 @@ public:
    */
   void SetRoundFinishCallback (Callback<void, Ptr<IncastAggregator> > cb);
 
+  /**
+   * Run another round on an aggregator whose previous round has finished.
+   * The round starts as if the application had just been added to its
+   * node, i.e. after the delay given by its start time.
+   */
+  void Restart (void);
+
 protected:
   virtual void DoDispose (void);
 //private:
@@ -81,6 +91,13 @@ protected:
   TracedCallback<Ptr<Socket>, uint32_t> m_sockStop;
   TracedCallback<Ptr<IncastAggregator> > m_start;
   TracedCallback<Ptr<IncastAggregator>, uint32_t> m_stop;
+  TracedCallback<Time, uint64_t, uint32_t> m_flowComplete;
+  TracedCallback<Time, uint64_t, uint32_t> m_incastComplete;
+  Time            m_roundStart;   //< Start time of the running incast
+  bool            m_reuse;        //< Keep connections to senders across rounds
+  std::map<Ipv4Address, Ptr<Socket> > m_connections;  //< Reused connections by sender
+  std::map<Ptr<Socket>, uint32_t> m_requests;     //< Responses outstanding per connection
+  std::map<Ptr<Socket>, uint32_t> m_received;     //< Bytes received toward the next response
 
 //private:
   void HandleAccept (Ptr<Socket> socket, const Address& from);
@@ -88,8 +105,11 @@ protected:
   void HandleSend (Ptr<Socket> socket, uint32_t n);
   //virtual void HandleSend (Ptr<Socket> socket, uint32_t n);
   void HandleRead (Ptr<Socket> socket);
+  void StartReuseRound (void);
+  void HandleReuseRead (Ptr<Socket> socket);
   //void HandleAdmCtrl (Ptr<TcpAdmCtrl> sock, Ipv4Address addr, uint16_t port);
   void RoundFinish (void);
+  void DoRestart (void);
 };
 
 } // namespace ns3
@@ -45,12 +45,18 @@ IncastSender::GetTypeId (void)
                    TypeIdValue (TcpNewReno::GetTypeId ()),
                    MakeTypeIdAccessor (&IncastSender::m_tid),
                    MakeTypeIdChecker ())
+    .AddAttribute ("ReuseConnections",
+                   "Keep connections open after a response and serve every 4-byte "
+                   "SRU request read from them",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&IncastSender::m_reuse),
+                   MakeBooleanChecker ())
   ;
   return tid;
 }
 
 
-IncastSender::IncastSender () : m_listensock (0)
+IncastSender::IncastSender () : m_listensock (0), m_reuse (false)
 {
   NS_LOG_FUNCTION (this);
 }
@@ -94,6 +100,25 @@ void IncastSender::StartApplication (void) // Called at time specified by Start
 void IncastSender::HandleRead (Ptr<Socket> socket)
 {
   NS_LOG_FUNCTION (this << socket);
+  if (m_reuse)
+    {
+      // Requests are framed as one SRU each; a partial request stays in
+      // the socket until the rest of it arrives. m_sockSrus and
+      // m_sockCounts count the bytes requested and sent over the
+      // lifetime of the connection.
+      uint32_t sru;
+      while (socket->GetRxAvailable () >= sizeof(sru))
+        {
+          Ptr<Packet> packet = socket->Recv (sizeof(sru), 0);
+          packet->CopyData ((uint8_t *)&sru, sizeof(sru));
+          NS_LOG_LOGIC ("Read an sru of " << sru);
+          SetupSocket (socket);
+          m_sockSrus[socket] += sru;
+        }
+      socket->SetSendCallback (MakeCallback (&IncastSender::HandleSend, this));
+      HandleSend (socket, 10000);
+      return;
+    }
   //NS_ASSERT (m_sockSrus.find (socket) == m_sockCounts.end ());
   NS_ASSERT (m_sockSrus[socket] == 0);
   Ptr<Packet> packet;
@@ -120,13 +145,13 @@ void IncastSender::HandleSend (Ptr<Socket> socket, uint32_t n)
   NS_LOG_FUNCTION (this);
   NS_ASSERT (m_sockCounts.find (socket) != m_sockCounts.end ());
 
-  uint32_t sru = m_sockSrus[socket];
+  uint64_t sru = m_sockSrus[socket];
   if (sru <= 0)
     return;
-  uint32_t sentCount = m_sockCounts[socket];
+  uint64_t sentCount = m_sockCounts[socket];
   while (sentCount < sru && socket->GetTxAvailable ())
     { // Not yet finish the one SRU data
-      Ptr<Packet> packet = Create<Packet> (std::min(sru - sentCount, n));
+      Ptr<Packet> packet = Create<Packet> (std::min<uint64_t> (sru - sentCount, n));
       int actual = socket->Send (packet);
       if (actual > 0) 
         {
@@ -136,7 +161,7 @@ void IncastSender::HandleSend (Ptr<Socket> socket, uint32_t n)
       NS_LOG_LOGIC(actual << " bytes sent");
     }
   // If finished, close the socket
-  if (sentCount == sru)
+  if (sentCount == sru && !m_reuse)
     {
       Address sockAddr;
       socket->GetSockName (sockAddr);
@@ -62,7 +62,8 @@ protected:
   uint16_t        m_port;         //< TCP port for incast applications
   TypeId          m_tid;          //< Socket's TypeId
   Ptr<Socket>     m_listensock;   //< Listening TCP socket
-  typedef sgi::hash_map<Ptr<Socket>, uint32_t, PtrHash> SockCounts;
+  bool            m_reuse;        //< Serve many requests per connection
+  typedef sgi::hash_map<Ptr<Socket>, uint64_t, PtrHash> SockCounts;
   SockCounts      m_sockSrus;     //< Number of bytes to send per socket
   SockCounts      m_sockCounts;   //< Number of bytes sent per socket
 
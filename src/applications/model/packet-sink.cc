@@ -28,6 +28,7 @@
 #include "ns3/simulator.h"
 #include "ns3/socket-factory.h"
 #include "ns3/packet.h"
+#include "ns3/boolean.h"
 #include "ns3/trace-source-accessor.h"
 #include "ns3/udp-socket-factory.h"
 #include "packet-sink.h"
@@ -51,6 +52,11 @@ PacketSink::GetTypeId (void)
                    TypeIdValue (UdpSocketFactory::GetTypeId ()),
                    MakeTypeIdAccessor (&PacketSink::m_tid),
                    MakeTypeIdChecker ())
+    .AddAttribute ("VirtualPayload",
+                   "Have TCP sockets only count the received bytes instead of copying them out",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&PacketSink::m_virtual),
+                   MakeBooleanChecker ())
     .AddTraceSource ("Rx", "A packet has been received",
                      MakeTraceSourceAccessor (&PacketSink::m_rxTrace))
   ;
@@ -62,6 +68,7 @@ PacketSink::PacketSink ()
   NS_LOG_FUNCTION (this);
   m_socket = 0;
   m_totalRx = 0;
+  m_virtual = false;
 }
 
 PacketSink::~PacketSink()
@@ -108,6 +115,10 @@ void PacketSink::StartApplication ()    // Called at time specified by Start
   if (!m_socket)
     {
       m_socket = Socket::CreateSocket (GetNode (), m_tid);
+      if (m_virtual)
+        { // Accepted sockets inherit it from the listening socket
+          m_socket->SetAttributeFailSafe ("VirtualPayload", BooleanValue (true));
+        }
       m_socket->Bind (m_local);
       m_socket->Listen ();
       m_socket->ShutdownSend ();
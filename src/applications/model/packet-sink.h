@@ -108,6 +108,7 @@ private:
   Address         m_local;        // Local address to bind to
   uint32_t        m_totalRx;      // Total bytes received
   TypeId          m_tid;          // Protocol TypeId
+  bool            m_virtual;      // Ask the rx sockets for virtual payload
   TracedCallback<Ptr<const Packet>, const Address &> m_rxTrace;
 
 };
@@ -26,12 +26,17 @@
 #include "ns3/socket.h"
 #include "ns3/simulator.h"
 #include "ns3/socket-factory.h"
+#include "ns3/tcp-socket-base.h"
 #include "ns3/packet.h"
+#include "ns3/boolean.h"
+#include "ns3/enum.h"
 #include "ns3/uinteger.h"
 #include "ns3/trace-source-accessor.h"
 #include "ns3/tcp-socket-factory.h"
 #include "persistent-bulk-send-application.h"
 
+#include <limits>
+
 NS_LOG_COMPONENT_DEFINE ("PersistentBulkSendApplication");
 
 namespace ns3 {
@@ -52,12 +57,40 @@ PersistentBulkSendApplication::GetTypeId (void)
                    TypeIdValue (TcpSocketFactory::GetTypeId ()),
                    MakeTypeIdAccessor (&PersistentBulkSendApplication::m_tid),
                    MakeTypeIdChecker ())
+    .AddAttribute ("VirtualPayload",
+                   "Send zero-filled virtual payload without creating a packet for each send. "
+                   "Only TcpSocketBase sockets support it; other sockets are sent packets. "
+                   "The Tx trace is not fired for virtual payload.",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&PersistentBulkSendApplication::m_virtual),
+                   MakeBooleanChecker ())
+    .AddAttribute ("ReuseConnections",
+                   "Keep one long-lived connection per peer and send consecutive flows "
+                   "over it. A flow completes when all of its bytes are acknowledged.",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&PersistentBulkSendApplication::m_reuse),
+                   MakeBooleanChecker ())
+    .AddAttribute ("Arrivals",
+                   "How flows are started: back to back, as a Poisson process, "
+                   "or only when given to AddFlow",
+                   EnumValue (ARRIVALS_CLOSED_LOOP),
+                   MakeEnumAccessor (&PersistentBulkSendApplication::m_arrivals),
+                   MakeEnumChecker (ARRIVALS_CLOSED_LOOP, "ClosedLoop",
+                                    ARRIVALS_POISSON, "Poisson",
+                                    ARRIVALS_EXTERNAL, "External"))
+    .AddAttribute ("MeanArrivalInterval",
+                   "The mean time between flow arrivals with Poisson arrivals",
+                   TimeValue (MilliSeconds (1)),
+                   MakeTimeAccessor (&PersistentBulkSendApplication::m_arrivalInterval),
+                   MakeTimeChecker ())
     .AddTraceSource ("Tx", "A new packet is created and is sent",
                      MakeTraceSourceAccessor (&PersistentBulkSendApplication::m_txTrace))
     .AddTraceSource ("Start", "The transfer starts",
                      MakeTraceSourceAccessor (&PersistentBulkSendApplication::m_sockStart))
     .AddTraceSource ("Stop", "The transfer stops",
                      MakeTraceSourceAccessor (&PersistentBulkSendApplication::m_sockStop))
+    .AddTraceSource ("FlowComplete", "A transfer completes, with its start time, bytes and number of flows",
+                     MakeTraceSourceAccessor (&PersistentBulkSendApplication::m_flowComplete))
   ;
   return tid;
 }
@@ -65,8 +98,8 @@ PersistentBulkSendApplication::GetTypeId (void)
 
 PersistentBulkSendApplication::PersistentBulkSendApplication ()
   : m_socket (0),
-    m_connected (false),
-    m_totBytes (0)
+    m_virtual (false),
+    m_reuse (false)
 {
   NS_LOG_FUNCTION (this);
 }
@@ -90,6 +123,20 @@ PersistentBulkSendApplication::SetSizes (std::vector<uint64_t> sizes)
   m_sizes = sizes;
 }
 
+void
+PersistentBulkSendApplication::SetSizeDistribution (Ptr<FlowSizeDistribution> sizes)
+{
+  NS_LOG_FUNCTION (this);
+  m_sizeDist = sizes;
+}
+
+void
+PersistentBulkSendApplication::AddFlow (const Address &peer, uint64_t bytes)
+{
+  NS_LOG_FUNCTION (this << peer << bytes);
+  StartFlow (peer, std::max<uint64_t> (bytes, 1), Simulator::Now ());
+}
+
 Ptr<Socket>
 PersistentBulkSendApplication::GetSocket (void) const
 {
@@ -103,6 +150,9 @@ PersistentBulkSendApplication::DoDispose (void)
   NS_LOG_FUNCTION (this);
 
   m_socket = 0;
+  m_sizeDist = 0;
+  m_connections.clear ();
+  m_connState.clear ();
   // chain up
   Application::DoDispose ();
 }
@@ -112,26 +162,51 @@ void PersistentBulkSendApplication::StartApplication (void) // Called at time sp
 {
   NS_LOG_FUNCTION (this);
 
+  if (m_arrivals == ARRIVALS_POISSON)
+    {
+      m_arrivalVar = ExponentialVariable (m_arrivalInterval.GetSeconds ());
+      Simulator::Schedule (Seconds (m_arrivalVar.GetValue ()), &PersistentBulkSendApplication::FlowArrival, this);
+      return;
+    }
+  if (m_arrivals == ARRIVALS_EXTERNAL)
+    {
+      return;
+    }
+
   // Create the socket if not already
   if (!m_socket)
     {
       //StartNewSocket ();
       Simulator::Schedule (Seconds (UniformVariable ().GetValue(0, 1000e-6)), &PersistentBulkSendApplication::StartNewSocket, this);
     }
-  if (m_connected)
-    {
-      SendData ();
-    }
 }
 
 void PersistentBulkSendApplication::StopApplication (void) // Called at time specified by Stop
 {
   NS_LOG_FUNCTION (this);
 
-  if (m_socket != 0)
+  if (m_reuse)
+    {
+      std::map<Address, Ptr<Socket> > connections = m_connections;
+      for (std::map<Address, Ptr<Socket> >::iterator i = connections.begin ();
+           i != connections.end (); ++i)
+        {
+          i->second->Close ();
+        }
+    }
+  else if (m_socket != 0)
     {
+      // Cut short the flows still being given to their sockets
+      std::map<Ptr<Socket>, Connection> connections = m_connState;
+      for (std::map<Ptr<Socket>, Connection>::iterator i = connections.begin ();
+           i != connections.end (); ++i)
+        {
+          if (i->first != m_socket && i->second.sent < i->second.queued)
+            {
+              i->first->Close ();
+            }
+        }
       m_socket->Close ();
-      m_connected = false;
     }
   else
     {
@@ -146,58 +221,193 @@ PersistentBulkSendApplication::StartNewSocket (void)
 {
   NS_LOG_FUNCTION (this);
 
-  /* Set the totBytes and the remote peer */
-  m_totBytes = 0;
-  int bytesI = UniformVariable ().GetInteger (0, m_sizes.size () - 1);
-  m_maxBytes = m_sizes[bytesI];
+  /* Set the flow size and the remote peer */
+  uint64_t bytes;
+  if (m_sizeDist)
+    {
+      bytes = m_sizeDist->Sample ();
+    }
+  else
+    {
+      int bytesI = UniformVariable ().GetInteger (0, m_sizes.size () - 1);
+      bytes = m_sizes[bytesI];
+    }
   int peerI = UniformVariable ().GetInteger (0, m_peers.size () - 1);
-  Address peer = m_peers[peerI];
-  NS_LOG_LOGIC ("Sending " << m_maxBytes << " bytes to remote " << peer);
+  StartFlow (m_peers[peerI], bytes, Simulator::Now ());
+}
+
+void
+PersistentBulkSendApplication::FlowArrival (void)
+{
+  NS_LOG_FUNCTION (this);
+
+  uint64_t bytes;
+  if (m_sizeDist)
+    {
+      bytes = m_sizeDist->Sample ();
+    }
+  else
+    {
+      bytes = m_sizes[UniformVariable ().GetInteger (0, m_sizes.size () - 1)];
+    }
+  Address peer = m_peers[UniformVariable ().GetInteger (0, m_peers.size () - 1)];
+  Simulator::Schedule (Seconds (m_arrivalVar.GetValue ()), &PersistentBulkSendApplication::FlowArrival, this);
+  // Open-loop flows do not wait for each other
+  StartFlow (peer, bytes, Simulator::Now ());
+}
+
+void
+PersistentBulkSendApplication::StartFlow (const Address &peer, uint64_t bytes, Time start)
+{
+  NS_LOG_FUNCTION (this << peer << bytes << start);
+  NS_LOG_LOGIC ("Sending " << bytes << " bytes to remote " << peer);
+
+  // Zero bytes sends until the application stops
+  if (bytes == 0)
+    {
+      bytes = std::numeric_limits<uint64_t>::max ();
+    }
+
+  if (m_reuse)
+    {
+      std::map<Address, Ptr<Socket> >::iterator it = m_connections.find (peer);
+      if (it != m_connections.end ())
+        {
+          m_socket = it->second;
+        }
+      else
+        {
+          m_socket = OpenConnection (peer);
+          m_connections[peer] = m_socket;
+        }
+    }
+  else
+    {
+      m_socket = OpenConnection (peer);
+    }
 
-  m_socket = Socket::CreateSocket (GetNode (), m_tid);
+  // Queue the flow behind whatever the connection still carries
+  Connection &conn = m_connState[m_socket];
+  PendingFlow flow = { start, bytes, conn.queued + bytes };
+  conn.flows.push_back (flow);
+  conn.queued += bytes;
+  if (conn.connected)
+    {
+      SendData (m_socket);
+    }
+}
+
+Ptr<Socket>
+PersistentBulkSendApplication::OpenConnection (const Address &peer)
+{
+  NS_LOG_FUNCTION (this << peer);
+
+  Ptr<Socket> socket = Socket::CreateSocket (GetNode (), m_tid);
 
   // Fatal error if socket type is not NS3_SOCK_STREAM or NS3_SOCK_SEQPACKET
-  if (m_socket->GetSocketType () != Socket::NS3_SOCK_STREAM &&
-      m_socket->GetSocketType () != Socket::NS3_SOCK_SEQPACKET)
+  if (socket->GetSocketType () != Socket::NS3_SOCK_STREAM &&
+      socket->GetSocketType () != Socket::NS3_SOCK_SEQPACKET)
     {
       NS_FATAL_ERROR ("Using PersistentBulkSend with an incompatible socket type. "
                       "PersistentBulkSend requires SOCK_STREAM or SOCK_SEQPACKET. "
                       "In other words, use TCP instead of UDP.");
     }
+  if (m_virtual && socket->GetObject<TcpSocketBase> () == 0)
+    {
+      NS_LOG_WARN ("VirtualPayload needs a TcpSocketBase socket; sending packets instead");
+    }
 
-  m_socket->Bind ();
-  m_sockStart(m_socket);
-  m_socket->Connect (peer);
-  m_socket->ShutdownRecv ();
-  m_socket->SetConnectCallback (
+  socket->Bind ();
+  m_sockStart (socket);
+  socket->Connect (peer);
+  socket->ShutdownRecv ();
+  socket->SetConnectCallback (
     MakeCallback (&PersistentBulkSendApplication::ConnectionSucceeded, this),
     MakeCallback (&PersistentBulkSendApplication::ConnectionFailed, this));
-  m_socket->SetCloseCallbacks (
+  socket->SetCloseCallbacks (
     MakeCallback (&PersistentBulkSendApplication::ConnectionClosed, this),
     MakeCallback (&PersistentBulkSendApplication::ConnectionClosed, this));
-  m_socket->SetSendCallback (
+  socket->SetSendCallback (
     MakeCallback (&PersistentBulkSendApplication::DataSend, this));
+
+  Connection &conn = m_connState[socket];
+  conn.connected = false;
+  conn.bufSize = 0;
+  conn.queued = 0;
+  conn.sent = 0;
+  return socket;
 }
 
-void PersistentBulkSendApplication::SendData (void)
+void
+PersistentBulkSendApplication::CheckCompletions (Ptr<Socket> socket)
 {
-  NS_LOG_FUNCTION (this);
+  NS_LOG_FUNCTION (this << socket);
+
+  std::map<Ptr<Socket>, Connection>::iterator it = m_connState.find (socket);
+  if (it == m_connState.end () || !it->second.connected)
+    {
+      return;
+    }
+  Connection &conn = it->second;
+  uint64_t acked = conn.sent - (conn.bufSize - socket->GetTxAvailable ());
+  while (!conn.flows.empty () && conn.flows.front ().end <= acked)
+    {
+      PendingFlow flow = conn.flows.front ();
+      conn.flows.pop_front ();
+      m_sockStop (socket, flow.bytes);
+      m_flowComplete (flow.start, flow.bytes, 1);
+    }
+}
+
+void
+PersistentBulkSendApplication::PrepareSend (Ptr<Socket> socket, uint64_t end)
+{
+}
+
+void PersistentBulkSendApplication::SendData (Ptr<Socket> socket)
+{
+  NS_LOG_FUNCTION (this << socket);
+
+  std::map<Ptr<Socket>, Connection>::iterator it = m_connState.find (socket);
+  if (it == m_connState.end () || !it->second.connected || it->second.sent == it->second.queued)
+    {
+      return;
+    }
+  Connection &conn = it->second;
 
-  while (m_maxBytes == 0 || m_totBytes < m_maxBytes)
+  // The first flow with bytes not yet given to the socket
+  std::deque<PendingFlow>::const_iterator flow = conn.flows.begin ();
+  while (flow->end <= conn.sent)
+    {
+      ++flow;
+    }
+  PrepareSend (socket, flow->end);
+  // Virtual payloads need a TCP socket; other sockets are sent packets
+  Ptr<TcpSocketBase> tcpSocket = m_virtual ? socket->GetObject<TcpSocketBase> () : 0;
+  while (conn.sent < conn.queued)
     { // Time to send more
-      uint32_t toSend = m_sendSize;
-      // Make sure we don't send too many
-      if (m_maxBytes > 0)
+      if (flow->end <= conn.sent)
         {
-          toSend = std::min (m_sendSize, m_maxBytes - m_totBytes);
+          ++flow;
+          PrepareSend (socket, flow->end);
         }
+      // Make sure we don't send too many
+      uint32_t toSend = std::min (m_sendSize, flow->end - conn.sent);
       NS_LOG_LOGIC ("sending packet at " << Simulator::Now ());
-      Ptr<Packet> packet = Create<Packet> (toSend);
-      m_txTrace (packet);
-      int actual = m_socket->Send (packet);
+      int actual;
+      if (tcpSocket != 0)
+        {
+          actual = tcpSocket->SendVirtual (toSend);
+        }
+      else
+        {
+          Ptr<Packet> packet = Create<Packet> (toSend);
+          m_txTrace (packet);
+          actual = socket->Send (packet);
+        }
       if (actual > 0)
         {
-          m_totBytes += actual;
+          conn.sent += actual;
         }
       // We exit this loop when actual < toSend as the send side
       // buffer is full. The "DataSent" callback will pop when
@@ -208,12 +418,18 @@ void PersistentBulkSendApplication::SendData (void)
         }
     }
   // Check if time to close (all sent)
-  if (m_totBytes == m_maxBytes && m_connected)
+  if (conn.sent == conn.queued)
     {
-      m_socket->Close ();
-      m_connected = false;
-      Simulator::Schedule (Seconds (UniformVariable ().GetValue (0, 1000e-6)), &PersistentBulkSendApplication::StartNewSocket, this);
-      //StartNewSocket ();
+      if (!m_reuse)
+        {
+          // The flow completes when its connection closes
+          socket->Close ();
+        }
+      if (m_arrivals == ARRIVALS_CLOSED_LOOP)
+        {
+          Simulator::Schedule (Seconds (UniformVariable ().GetValue (0, 1000e-6)), &PersistentBulkSendApplication::StartNewSocket, this);
+          //StartNewSocket ();
+        }
     }
 }
 
@@ -221,8 +437,15 @@ void PersistentBulkSendApplication::ConnectionSucceeded (Ptr<Socket> socket)
 {
   NS_LOG_FUNCTION (this << socket);
   NS_LOG_LOGIC ("PersistentBulkSendApplication Connection succeeded");
-  m_connected = true;
-  SendData ();
+  Connection &conn = m_connState[socket];
+  conn.connected = true;
+  if (m_reuse)
+    {
+      UintegerValue bufSize;
+      socket->GetAttribute ("SndBufSize", bufSize);
+      conn.bufSize = bufSize.Get ();
+    }
+  SendData (socket);
 }
 
 void PersistentBulkSendApplication::ConnectionFailed (Ptr<Socket> socket)
@@ -234,16 +457,49 @@ void PersistentBulkSendApplication::ConnectionFailed (Ptr<Socket> socket)
 void PersistentBulkSendApplication::ConnectionClosed (Ptr<Socket> socket)
 {
   NS_LOG_FUNCTION (this << socket);
-  m_sockStop(m_socket, m_totBytes);
+  std::map<Ptr<Socket>, Connection>::iterator it = m_connState.find (socket);
+  if (it == m_connState.end ())
+    {
+      return;
+    }
+  if (m_reuse)
+    {
+      NS_LOG_WARN ("Reused connection " << socket << " closed");
+      for (std::map<Address, Ptr<Socket> >::iterator i = m_connections.begin ();
+           i != m_connections.end (); ++i)
+        {
+          if (i->second == socket)
+            {
+              m_connections.erase (i);
+              break;
+            }
+        }
+    }
+  else if (!it->second.flows.empty ())
+    {
+      // The only flow of the connection, cut short if the application
+      // stopped before it was sent
+      PendingFlow flow = it->second.flows.front ();
+      uint64_t bytes = std::min (flow.bytes, it->second.sent);
+      m_sockStop (socket, bytes);
+      m_flowComplete (flow.start, bytes, 1);
+    }
+  m_connState.erase (it);
 }
 
-void PersistentBulkSendApplication::DataSend (Ptr<Socket>, uint32_t)
+void PersistentBulkSendApplication::DataSend (Ptr<Socket> socket, uint32_t)
 {
   NS_LOG_FUNCTION (this);
 
-  if (m_connected)
+  if (m_reuse)
+    {
+      CheckCompletions (socket);
+    }
+
+  std::map<Ptr<Socket>, Connection>::iterator it = m_connState.find (socket);
+  if (it != m_connState.end () && it->second.connected && it->second.sent < it->second.queued)
     { // Only send new data if the connection has completed
-      Simulator::ScheduleNow (&PersistentBulkSendApplication::SendData, this);
+      Simulator::ScheduleNow (&PersistentBulkSendApplication::SendData, this, socket);
     }
 }
 
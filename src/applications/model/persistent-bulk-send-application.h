@@ -25,7 +25,12 @@
 #include "ns3/application.h"
 #include "ns3/event-id.h"
 #include "ns3/ptr.h"
+#include "ns3/nstime.h"
 #include "ns3/traced-callback.h"
+#include "ns3/flow-workload.h"
+
+#include <deque>
+#include <map>
 
 namespace ns3 {
 
@@ -51,31 +56,38 @@ class Socket;
 class PersistentBulkSendApplication : public Application
 {
 public:
+  /// How the application decides when to start its flows
+  enum Arrivals {
+    ARRIVALS_CLOSED_LOOP,   //< Next flow a random 0-1ms after the previous one is sent
+    ARRIVALS_POISSON,       //< Flows arrive with exponential gaps of MeanArrivalInterval
+    ARRIVALS_EXTERNAL       //< Only flows given to AddFlow
+  };
+
   static TypeId GetTypeId (void);
 
   PersistentBulkSendApplication ();
 
   virtual ~PersistentBulkSendApplication ();
 
+  void SetRemotes (std::vector<Address> remotes);
+  void SetSizes (std::vector<uint64_t> sizes);
+
   /**
-   * \param maxBytes the upper bound of bytes to send
-   *
-   * Set the upper bound for the total number of bytes to send. Once 
-   * this bound is reached, no more application bytes are sent. If the 
-   * application is stopped during the simulation and restarted, the 
-   * total number of bytes sent is not reset; however, the maxBytes 
-   * bound is still effective and the application will continue sending 
-   * up to maxBytes. The value zero for maxBytes means that 
-   * there is no upper bound; i.e. data is sent until the application 
-   * or simulation is stopped.
+   * Draw flow sizes from an empirical distribution instead of picking
+   * uniformly among the sizes given to SetSizes.
    */
-  void SetMaxBytes (uint32_t maxBytes);
+  void SetSizeDistribution (Ptr<FlowSizeDistribution> sizes);
 
-  void SetRemotes (std::vector<Address> remotes);
-  void SetSizes (std::vector<uint64_t> sizes);
+  /**
+   * Start a flow of the given size to the given peer now, on a connection
+   * of its own or, when connections are reused, behind the flows already
+   * queued on the connection to that peer. Its completion time counts
+   * from now.
+   */
+  void AddFlow (const Address &peer, uint64_t bytes);
 
   /**
-   * \return pointer to associated socket
+   * \return pointer to the socket of the latest flow
    */
   Ptr<Socket> GetSocket (void) const;
 
@@ -87,22 +99,58 @@ protected:
   virtual void StartApplication (void);    // Called at time specified by Start
   virtual void StopApplication (void);     // Called at time specified by Stop
 
-  virtual void SendData ();
+  /**
+   * Called before the bytes of a flow are given to the socket, for
+   * subclasses that mark the socket per flow. Does nothing here.
+   *
+   * \param socket the socket carrying the flow
+   * \param end the connection's byte count at the end of the flow
+   */
+  virtual void PrepareSend (Ptr<Socket> socket, uint64_t end);
 
-  Ptr<Socket>     m_socket;       // Associated socket
+  Ptr<Socket>     m_socket;       // Socket of the latest flow
   std::vector<Address> m_peers;         // Peer addresses
-  bool            m_connected;    // True if connected
   uint64_t        m_sendSize;     // Sizes of data to send each time
-  uint64_t        m_maxBytes;     // Limit total number of bytes sent
-  std::vector<uint64_t>        m_sizes;     // Limit total number of bytes sent
-  uint64_t        m_totBytes;     // Total bytes sent so far
+  std::vector<uint64_t>        m_sizes;     // Flow sizes to pick from
+  bool            m_virtual;      // Send virtual payload instead of packets
   TypeId          m_tid;
   TracedCallback<Ptr<const Packet> > m_txTrace;
   TracedCallback<Ptr<Socket> > m_sockStart;
   TracedCallback<Ptr<Socket>, uint32_t> m_sockStop;
+  TracedCallback<Time, uint64_t, uint32_t> m_flowComplete;
+  bool            m_reuse;        // Carry flows over long-lived connections
+  Ptr<FlowSizeDistribution> m_sizeDist;   // Flow sizes, if not from m_sizes
+  Arrivals        m_arrivals;     // How flows are started
+  Time            m_arrivalInterval;  // Mean time between Poisson arrivals
+  ExponentialVariable m_arrivalVar;
+
+  // A flow given to a connection. It completes once acked up to end on a
+  // reused connection, and when its own connection closes otherwise.
+  struct PendingFlow
+  {
+    Time start;
+    uint64_t bytes;
+    uint64_t end;
+  };
+  // A connection and the flows it carries
+  struct Connection
+  {
+    bool connected;
+    uint32_t bufSize;             // Size of the socket's send buffer
+    uint64_t queued;              // Bytes of all flows given to the connection
+    uint64_t sent;                // Bytes the socket has accepted
+    std::deque<PendingFlow> flows;
+  };
+  std::map<Address, Ptr<Socket> > m_connections;  // Reused connections by peer
+  std::map<Ptr<Socket>, Connection> m_connState;  // Every open connection
 
 //private:
   void StartNewSocket (void);
+  void StartFlow (const Address &peer, uint64_t bytes, Time start);
+  void FlowArrival (void);
+  Ptr<Socket> OpenConnection (const Address &peer);
+  void SendData (Ptr<Socket> socket);
+  void CheckCompletions (Ptr<Socket> socket);
   void ConnectionSucceeded (Ptr<Socket> socket);
   void ConnectionFailed (Ptr<Socket> socket);
   void ConnectionClosed (Ptr<Socket> socket);
@@ -21,34 +21,20 @@
 #ifndef PRIORITY_PERSISTENT_BULK_SEND_APPLICATION_H
 #define PRIORITY_PERSISTENT_BULK_SEND_APPLICATION_H
 
-#include "ns3/address.h"
-#include "ns3/application.h"
-#include "ns3/event-id.h"
-#include "ns3/ptr.h"
-#include "ns3/traced-callback.h"
+#include "ns3/persistent-bulk-send-application.h"
 
 namespace ns3 {
 
-class Address;
-class RandomVariable;
-class Socket;
-
 /**
  * \ingroup applications
  * \defgroup bulksend PriorityPersistentBulkSendApplication
  *
- * This traffic generator simply sends data
- * as fast as possible up to MaxBytes or until
- * the appplication is stopped if MaxBytes is
- * zero. Once the lower layer send buffer is
- * filled, it waits until space is free to
- * send more data, essentially keeping a
- * constant flow of data. Only SOCK_STREAM 
- * and SOCK_SEQPACKET sockets are supported. 
- * For example, TCP sockets can be used, but 
- * UDP sockets can not be used.
+ * A PersistentBulkSendApplication that gives the socket of each flow a
+ * pFabric priority, the bytes the connection will have carried once the
+ * flow is sent. The socket lowers it as the bytes are acknowledged.
+ * Requires TCP sockets.
  */
-class PriorityPersistentBulkSendApplication : public Application
+class PriorityPersistentBulkSendApplication : public PersistentBulkSendApplication
 {
 public:
   static TypeId GetTypeId (void);
@@ -57,57 +43,8 @@ public:
 
   virtual ~PriorityPersistentBulkSendApplication ();
 
-  /**
-   * \param maxBytes the upper bound of bytes to send
-   *
-   * Set the upper bound for the total number of bytes to send. Once 
-   * this bound is reached, no more application bytes are sent. If the 
-   * application is stopped during the simulation and restarted, the 
-   * total number of bytes sent is not reset; however, the maxBytes 
-   * bound is still effective and the application will continue sending 
-   * up to maxBytes. The value zero for maxBytes means that 
-   * there is no upper bound; i.e. data is sent until the application 
-   * or simulation is stopped.
-   */
-  void SetMaxBytes (uint32_t maxBytes);
-
-  void SetRemotes (std::vector<Address> remotes);
-  void SetSizes (std::vector<uint64_t> sizes);
-
-  /**
-   * \return pointer to associated socket
-   */
-  Ptr<Socket> GetSocket (void) const;
-
 protected:
-  virtual void DoDispose (void);
-
-//private:
-  // inherited from Application base class.
-  virtual void StartApplication (void);    // Called at time specified by Start
-  virtual void StopApplication (void);     // Called at time specified by Stop
-
-  virtual void SendData ();
-
-  Ptr<Socket>     m_socket;       // Associated socket
-  std::vector<Address> m_peers;         // Peer addresses
-  bool            m_connected;    // True if connected
-  uint64_t        m_sendSize;     // Sizes of data to send each time
-  uint64_t        m_maxBytes;     // Limit total number of bytes sent
-  std::vector<uint64_t>        m_sizes;     // Limit total number of bytes sent
-  uint64_t        m_totBytes;     // Total bytes sent so far
-  TypeId          m_tid;
-  TracedCallback<Ptr<const Packet> > m_txTrace;
-  TracedCallback<Ptr<Socket> > m_sockStart;
-  TracedCallback<Ptr<Socket>, uint32_t> m_sockStop;
-
-//private:
-  void StartNewSocket (void);
-  void ConnectionSucceeded (Ptr<Socket> socket);
-  void ConnectionFailed (Ptr<Socket> socket);
-  void ConnectionClosed (Ptr<Socket> socket);
-  void DataSend (Ptr<Socket>, uint32_t); // for socket's SetSendCallback
-  void Ignore (Ptr<Socket> socket);
+  virtual void PrepareSend (Ptr<Socket> socket, uint64_t end);
 };
 
 } // namespace ns3
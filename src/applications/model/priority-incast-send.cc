@@ -49,8 +49,8 @@ void PriorityIncastSender::HandleSend (Ptr<Socket> socket, uint32_t n)
   NS_LOG_FUNCTION (this);
   NS_ASSERT (m_sockCounts.find (socket) != m_sockCounts.end ());
 
-  uint32_t sru = m_sockSrus[socket];
-  uint32_t sentCount = m_sockCounts[socket];
+  uint64_t sru = m_sockSrus[socket];
+  uint64_t sentCount = m_sockCounts[socket];
   while (sentCount < sru && socket->GetTxAvailable ())
     { 
       //double priority = (double) sru - sentCount;
@@ -62,7 +62,7 @@ void PriorityIncastSender::HandleSend (Ptr<Socket> socket, uint32_t n)
       tcpSock->SetAttribute("Priority", DoubleValue (priority));
     
       // Not yet finish the one SRU data
-      Ptr<Packet> packet = Create<Packet> (std::min(sru - sentCount, n));
+      Ptr<Packet> packet = Create<Packet> (std::min<uint64_t> (sru - sentCount, n));
       int actual = socket->Send (packet);
       if (actual > 0) 
         {
@@ -72,7 +72,7 @@ void PriorityIncastSender::HandleSend (Ptr<Socket> socket, uint32_t n)
       NS_LOG_LOGIC(actual << " bytes sent");
     }
   // If finished, close the socket
-  if (sentCount == sru)
+  if (sentCount == sru && !m_reuse)
     {
       Address sockAddr;
       socket->GetSockName (sockAddr);
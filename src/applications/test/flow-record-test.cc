@@ -0,0 +1,127 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ns3/flow-record.h"
+#include "ns3/simulator.h"
+#include "ns3/test.h"
+
+using namespace ns3;
+
+/**
+ * Records written in several batches are read back in order
+ */
+class FlowRecordTestCase : public TestCase
+{
+public:
+  FlowRecordTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+FlowRecordTestCase::FlowRecordTestCase ()
+  : TestCase ("Read back the flow records of a FlowRecordWriter")
+{
+}
+
+void
+FlowRecordTestCase::DoRun (void)
+{
+  std::string filename = CreateTempDirFilename ("flow-record-test.fctb");
+  {
+    Ptr<FlowRecordWriter> writer = Create<FlowRecordWriter> (filename, 3);
+    for (uint32_t i = 1; i <= 10; ++i)
+      {
+        Simulator::Schedule (MicroSeconds (100 * i), &FlowRecordWriter::Record, writer,
+                             MicroSeconds (100 * i - i), 1000 * i, i);
+      }
+    Simulator::Run ();
+    Simulator::Destroy ();
+  }
+
+  FlowRecordReader reader (filename);
+  NS_TEST_ASSERT_MSG_EQ (reader.IsValid (), true, "Not a flow record file");
+  FlowRecord record;
+  for (uint32_t i = 1; i <= 10; ++i)
+    {
+      NS_TEST_ASSERT_MSG_EQ (reader.Next (record), true, "Missing record " << i);
+      NS_TEST_EXPECT_MSG_EQ (record.stop, int64_t (100000 * i), "Stop time of record " << i);
+      NS_TEST_EXPECT_MSG_EQ (record.duration, int64_t (1000 * i), "Duration of record " << i);
+      NS_TEST_EXPECT_MSG_EQ (record.bytes, uint64_t (1000 * i), "Bytes of record " << i);
+      NS_TEST_EXPECT_MSG_EQ (record.flows, i, "Flows of record " << i);
+    }
+  NS_TEST_EXPECT_MSG_EQ (reader.Next (record), false, "Record past the end");
+}
+
+/**
+ * Records are on disk once the simulator is destroyed, even while the
+ * writer is still referenced
+ */
+class FlowRecordDestroyTestCase : public TestCase
+{
+public:
+  FlowRecordDestroyTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+FlowRecordDestroyTestCase::FlowRecordDestroyTestCase ()
+  : TestCase ("Write out the flow records when the simulator is destroyed")
+{
+}
+
+void
+FlowRecordDestroyTestCase::DoRun (void)
+{
+  std::string filename = CreateTempDirFilename ("flow-record-destroy-test.fctb");
+  Ptr<FlowRecordWriter> writer = Create<FlowRecordWriter> (filename);
+  for (uint32_t i = 1; i <= 5; ++i)
+    {
+      Simulator::Schedule (MicroSeconds (100 * i), &FlowRecordWriter::Record, writer,
+                           MicroSeconds (0), 1000 * i, 1);
+    }
+  Simulator::Run ();
+
+  FlowRecordReader before (filename);
+  FlowRecord record;
+  NS_TEST_EXPECT_MSG_EQ (before.Next (record), false, "Records written before the batch is full");
+
+  Simulator::Destroy ();
+  FlowRecordReader reader (filename);
+  NS_TEST_ASSERT_MSG_EQ (reader.IsValid (), true, "Not a flow record file");
+  for (uint32_t i = 1; i <= 5; ++i)
+    {
+      NS_TEST_ASSERT_MSG_EQ (reader.Next (record), true, "Missing record " << i);
+      NS_TEST_EXPECT_MSG_EQ (record.bytes, uint64_t (1000 * i), "Bytes of record " << i);
+    }
+  NS_TEST_EXPECT_MSG_EQ (reader.Next (record), false, "Record past the end");
+}
+
+class FlowRecordTestSuite : public TestSuite
+{
+public:
+  FlowRecordTestSuite ();
+};
+
+FlowRecordTestSuite::FlowRecordTestSuite ()
+  : TestSuite ("flow-record", UNIT)
+{
+  AddTestCase (new FlowRecordTestCase);
+  AddTestCase (new FlowRecordDestroyTestCase);
+}
+
+static FlowRecordTestSuite flowRecordTestSuite;
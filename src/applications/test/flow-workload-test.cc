@@ -0,0 +1,133 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ns3/flow-workload.h"
+#include "ns3/test.h"
+
+#include <fstream>
+
+using namespace ns3;
+
+/**
+ * Sizes drawn through the alias table follow the CDF
+ */
+class FlowSizeDistributionTestCase : public TestCase
+{
+public:
+  FlowSizeDistributionTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+FlowSizeDistributionTestCase::FlowSizeDistributionTestCase ()
+  : TestCase ("Sample flow sizes from an empirical CDF")
+{
+}
+
+void
+FlowSizeDistributionTestCase::DoRun (void)
+{
+  std::vector<uint64_t> sizes;
+  std::vector<double> cdf;
+  sizes.push_back (100);   cdf.push_back (0.5);
+  sizes.push_back (1000);  cdf.push_back (0.8);
+  sizes.push_back (10000); cdf.push_back (1.0);
+  Ptr<FlowSizeDistribution> dist = Create<FlowSizeDistribution> ();
+  dist->SetCdf (sizes, cdf);
+  // 0.5 * 100 + 0.3 * 550 + 0.2 * 5500
+  NS_TEST_ASSERT_MSG_EQ_TOL (dist->GetMean (), 1315, 1e-9, "Mean of the CDF");
+
+  const uint32_t n = 100000;
+  uint32_t smallest = 0;
+  uint32_t middle = 0;
+  double total = 0;
+  for (uint32_t i = 0; i < n; ++i)
+    {
+      uint64_t size = dist->Sample ();
+      NS_TEST_ASSERT_MSG_EQ ((size >= 100 && size <= 10000), true, "Size " << size << " outside the CDF");
+      smallest += size == 100;
+      middle += size > 100 && size <= 1000;
+      total += size;
+    }
+  NS_TEST_EXPECT_MSG_EQ_TOL (smallest / double (n), 0.5, 0.01, "Point mass at the first size");
+  NS_TEST_EXPECT_MSG_EQ_TOL (middle / double (n), 0.3, 0.01, "Second segment");
+  NS_TEST_EXPECT_MSG_EQ_TOL (total / n, 1315, 30, "Sample mean");
+}
+
+/**
+ * A flow trace file is read back entry by entry
+ */
+class FlowTraceReaderTestCase : public TestCase
+{
+public:
+  FlowTraceReaderTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+FlowTraceReaderTestCase::FlowTraceReaderTestCase ()
+  : TestCase ("Read the entries of a flow trace file")
+{
+}
+
+void
+FlowTraceReaderTestCase::DoRun (void)
+{
+  std::string filename = CreateTempDirFilename ("flow-workload-test.flows");
+  {
+    std::ofstream file (filename.c_str (), std::ios::out | std::ios::binary | std::ios::trunc);
+    file.write ("NS3FLW01", 8);
+    for (uint32_t i = 0; i < 5; ++i)
+      {
+        FlowTraceEntry entry = { 1000 * i, i, i + 1, 1500 * i + 1 };
+        file.write (reinterpret_cast<const char *> (&entry), sizeof (entry));
+      }
+  }
+
+  FlowTraceReader reader (filename);
+  NS_TEST_ASSERT_MSG_EQ (reader.IsValid (), true, "Not a flow trace file");
+  NS_TEST_EXPECT_MSG_EQ (reader.GetN (), uint64_t (5), "Number of entries");
+  FlowTraceEntry entry;
+  for (uint32_t i = 0; i < 5; ++i)
+    {
+      NS_TEST_ASSERT_MSG_EQ (reader.Next (entry), true, "Missing entry " << i);
+      NS_TEST_EXPECT_MSG_EQ (entry.start, int64_t (1000 * i), "Start of entry " << i);
+      NS_TEST_EXPECT_MSG_EQ (entry.src, i, "Source of entry " << i);
+      NS_TEST_EXPECT_MSG_EQ (entry.dst, i + 1, "Destination of entry " << i);
+      NS_TEST_EXPECT_MSG_EQ (entry.bytes, uint64_t (1500 * i + 1), "Size of entry " << i);
+    }
+  NS_TEST_EXPECT_MSG_EQ (reader.Next (entry), false, "Entry past the end");
+
+  FlowTraceReader missing (CreateTempDirFilename ("no-such-file.flows"));
+  NS_TEST_EXPECT_MSG_EQ (missing.IsValid (), false, "Missing file is valid");
+}
+
+class FlowWorkloadTestSuite : public TestSuite
+{
+public:
+  FlowWorkloadTestSuite ();
+};
+
+FlowWorkloadTestSuite::FlowWorkloadTestSuite ()
+  : TestSuite ("flow-workload", UNIT)
+{
+  AddTestCase (new FlowSizeDistributionTestCase);
+  AddTestCase (new FlowTraceReaderTestCase);
+}
+
+static FlowWorkloadTestSuite flowWorkloadTestSuite;
@@ -0,0 +1,231 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ns3/uinteger.h"
+#include "ns3/inet-socket-address.h"
+#include "ns3/internet-stack-helper.h"
+#include "ns3/ipv4-address-helper.h"
+#include "ns3/incast-agg.h"
+#include "ns3/incast-send.h"
+#include "ns3/incast-helper.h"
+#include "ns3/simple-net-device.h"
+#include "ns3/simple-channel.h"
+#include "ns3/tcp-socket-factory.h"
+#include "ns3/test.h"
+#include "ns3/simulator.h"
+
+#include <vector>
+
+using namespace ns3;
+
+/* An aggregator node and a sender node */
+class IncastNetwork
+{
+public:
+  IncastNetwork ()
+  {
+    nodes.Create (2);
+    InternetStackHelper internet;
+    internet.Install (nodes);
+
+    Ptr<SimpleChannel> channel = CreateObject<SimpleChannel> ();
+    NetDeviceContainer d;
+    for (uint32_t i = 0; i < nodes.GetN (); ++i)
+      {
+        Ptr<SimpleNetDevice> dev = CreateObject<SimpleNetDevice> ();
+        nodes.Get (i)->AddDevice (dev);
+        dev->SetChannel (channel);
+        d.Add (dev);
+      }
+
+    Ipv4AddressHelper ipv4;
+    ipv4.SetBase ("10.1.1.0", "255.255.255.0");
+    Ipv4InterfaceContainer i = ipv4.Assign (d);
+    senderNodes.Add (nodes.Get (1));
+    senders.push_back (i.GetAddress (1));
+  }
+
+  NodeContainer nodes;
+  NodeContainer senderNodes;
+  std::vector<Ipv4Address> senders;
+};
+
+/**
+ * An aggregator restarted from its round-finish callback runs another
+ * round with its new SRU and senders
+ */
+class IncastRestartTestCase : public TestCase
+{
+public:
+  IncastRestartTestCase ();
+
+private:
+  virtual void DoRun (void);
+  void RoundFinish (Ptr<IncastAggregator> agg);
+  void IncastComplete (Time start, uint64_t bytes, uint32_t flows);
+
+  Ipv4Address m_sender;
+  std::vector<uint64_t> m_bytes;
+  std::vector<uint32_t> m_flows;
+  std::vector<Time> m_starts;
+};
+
+IncastRestartTestCase::IncastRestartTestCase ()
+  : TestCase ("Restart an incast aggregator for another round")
+{
+}
+
+void
+IncastRestartTestCase::RoundFinish (Ptr<IncastAggregator> agg)
+{
+  if (m_bytes.size () > 1)
+    {
+      return;
+    }
+  // Second round: one flow of a larger SRU, after half a second
+  agg->SetAttribute ("SRU", UintegerValue (3000));
+  agg->SetSenders (std::vector<Ipv4Address> (1, m_sender));
+  agg->SetStartTime (Seconds (0.5));
+  agg->Restart ();
+}
+
+void
+IncastRestartTestCase::IncastComplete (Time start, uint64_t bytes, uint32_t flows)
+{
+  m_bytes.push_back (bytes);
+  m_flows.push_back (flows);
+  m_starts.push_back (start);
+}
+
+void
+IncastRestartTestCase::DoRun (void)
+{
+  IncastNetwork net;
+  m_sender = net.senders[0];
+
+  for (uint32_t i = 0; i < net.senderNodes.GetN (); ++i)
+    {
+      Ptr<IncastSender> sender = CreateObject<IncastSender> ();
+      sender->SetAttribute ("Protocol", TypeIdValue (TcpSocketFactory::GetTypeId ()));
+      net.senderNodes.Get (i)->AddApplication (sender);
+    }
+
+  Ptr<IncastAggregator> agg = CreateObject<IncastAggregator> ();
+  agg->SetAttribute ("Protocol", TypeIdValue (TcpSocketFactory::GetTypeId ()));
+  agg->SetAttribute ("SRU", UintegerValue (2000));
+  agg->SetSenders (std::vector<Ipv4Address> (2, m_sender));
+  agg->SetRoundFinishCallback (MakeCallback (&IncastRestartTestCase::RoundFinish, this));
+  agg->TraceConnectWithoutContext ("IncastComplete", MakeCallback (&IncastRestartTestCase::IncastComplete, this));
+  agg->SetStartTime (Seconds (1.0));
+  net.nodes.Get (0)->AddApplication (agg);
+
+  Simulator::Stop (Seconds (10.0));
+  Simulator::Run ();
+
+  NS_TEST_ASSERT_MSG_EQ (m_bytes.size (), 2, "Both rounds complete");
+  NS_TEST_EXPECT_MSG_EQ (m_bytes[0], 4000, "First round: two flows of 2000 bytes");
+  NS_TEST_EXPECT_MSG_EQ (m_flows[0], 2, "First round: two flows of 2000 bytes");
+  NS_TEST_EXPECT_MSG_EQ (m_bytes[1], 3000, "Second round: one flow of 3000 bytes");
+  NS_TEST_EXPECT_MSG_EQ (m_flows[1], 1, "Second round: one flow of 3000 bytes");
+  NS_TEST_EXPECT_MSG_EQ (m_starts[0], Seconds (1.0), "First round starts at its start time");
+  NS_TEST_EXPECT_MSG_EQ ((m_starts[1] >= Seconds (1.5)), true, "Second round waits for its start time");
+  NS_TEST_EXPECT_MSG_EQ (net.nodes.Get (0)->GetNApplications (), 1, "The aggregator is not added again");
+
+  Simulator::Destroy ();
+}
+
+/**
+ * The helper runs its incasts on aggregators recycled from earlier
+ * rounds, and lists each aggregator it created once
+ */
+class IncastHelperPoolTestCase : public TestCase
+{
+public:
+  IncastHelperPoolTestCase ();
+
+private:
+  virtual void DoRun (void);
+  void IncastComplete (Time start, uint64_t bytes, uint32_t flows);
+
+  std::vector<uint64_t> m_bytes;
+};
+
+IncastHelperPoolTestCase::IncastHelperPoolTestCase ()
+  : TestCase ("Incasts reuse the aggregators of finished rounds")
+{
+}
+
+void
+IncastHelperPoolTestCase::IncastComplete (Time start, uint64_t bytes, uint32_t flows)
+{
+  m_bytes.push_back (bytes);
+}
+
+void
+IncastHelperPoolTestCase::DoRun (void)
+{
+  IncastNetwork net;
+  NodeContainer aggs (net.nodes.Get (0));
+
+  Ptr<IncastHelper> helper = CreateObject<IncastHelper> ();
+  helper->SetAttribute ("IncastsPerSecond", UintegerValue (1));
+  helper->SetAggs (aggs);
+  helper->SetSenders (net.senderNodes, net.senders);
+  helper->SetSruSizes (std::vector<uint32_t> (1, 2000));
+  helper->SetSenderSizes (std::vector<uint32_t> (1, 2));
+  helper->Start (Seconds (0));
+
+  // Aggregators are created as incasts start; watch each new one
+  uint32_t watched = 0;
+  while (Simulator::Now () < Seconds (20.0))
+    {
+      Simulator::Stop (MilliSeconds (1));
+      Simulator::Run ();
+      ApplicationContainer aggApps = helper->GetAggApps ();
+      for (; watched < aggApps.GetN (); ++watched)
+        {
+          aggApps.Get (watched)->TraceConnectWithoutContext ("IncastComplete",
+            MakeCallback (&IncastHelperPoolTestCase::IncastComplete, this));
+        }
+    }
+
+  uint32_t created = helper->GetAggApps ().GetN ();
+  NS_TEST_EXPECT_MSG_EQ (helper->GetSenderApps ().GetN (), 1, "One sender application per sender node");
+  NS_TEST_EXPECT_MSG_EQ (net.nodes.Get (0)->GetNApplications (), created, "Every aggregator is listed once");
+  NS_TEST_ASSERT_MSG_EQ ((m_bytes.size () >= 2), true, "Several incasts complete");
+  NS_TEST_EXPECT_MSG_EQ ((created < m_bytes.size ()), true, "Aggregators run more than one round");
+  for (uint32_t i = 0; i < m_bytes.size (); ++i)
+    {
+      NS_TEST_EXPECT_MSG_EQ (m_bytes[i], 4000, "Incast " << i << " carries two SRUs");
+    }
+
+  Simulator::Destroy ();
+}
+
+class IncastTestSuite : public TestSuite
+{
+public:
+  IncastTestSuite ();
+};
+
+IncastTestSuite::IncastTestSuite ()
+  : TestSuite ("incast", UNIT)
+{
+  AddTestCase (new IncastRestartTestCase);
+  AddTestCase (new IncastHelperPoolTestCase);
+}
+
+static IncastTestSuite incastTestSuite;
@@ -0,0 +1,332 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ns3/boolean.h"
+#include "ns3/double.h"
+#include "ns3/enum.h"
+#include "ns3/uinteger.h"
+#include "ns3/inet-socket-address.h"
+#include "ns3/internet-stack-helper.h"
+#include "ns3/ipv4-address-helper.h"
+#include "ns3/packet-sink.h"
+#include "ns3/packet-sink-helper.h"
+#include "ns3/persistent-bulk-send-application.h"
+#include "ns3/pri-persistent-bulk-send-application.h"
+#include "ns3/simple-net-device.h"
+#include "ns3/simple-channel.h"
+#include "ns3/socket.h"
+#include "ns3/test.h"
+#include "ns3/simulator.h"
+
+#include <vector>
+
+using namespace ns3;
+
+/**
+ * Flows given one after the other to a bulk sender that reuses its
+ * connections are carried over one connection and complete in order
+ */
+class PersistentBulkSendReuseTestCase : public TestCase
+{
+public:
+  PersistentBulkSendReuseTestCase (std::string tid);
+
+private:
+  virtual void DoRun (void);
+  void SocketStart (Ptr<Socket> socket);
+  void FlowComplete (Time start, uint64_t bytes, uint32_t flows);
+
+  std::string m_tid;
+  std::vector<Ptr<Socket> > m_sockets;
+  std::vector<uint64_t> m_completed;
+};
+
+PersistentBulkSendReuseTestCase::PersistentBulkSendReuseTestCase (std::string tid)
+  : TestCase ("Rounds of flows over a reused connection of " + tid),
+    m_tid (tid)
+{
+}
+
+void
+PersistentBulkSendReuseTestCase::SocketStart (Ptr<Socket> socket)
+{
+  m_sockets.push_back (socket);
+}
+
+void
+PersistentBulkSendReuseTestCase::FlowComplete (Time start, uint64_t bytes, uint32_t flows)
+{
+  m_completed.push_back (bytes);
+}
+
+void
+PersistentBulkSendReuseTestCase::DoRun (void)
+{
+  NodeContainer n;
+  n.Create (2);
+
+  InternetStackHelper internet;
+  internet.Install (n);
+
+  Ptr<SimpleNetDevice> txDev = CreateObject<SimpleNetDevice> ();
+  Ptr<SimpleNetDevice> rxDev = CreateObject<SimpleNetDevice> ();
+  n.Get (0)->AddDevice (txDev);
+  n.Get (1)->AddDevice (rxDev);
+  Ptr<SimpleChannel> channel = CreateObject<SimpleChannel> ();
+  rxDev->SetChannel (channel);
+  txDev->SetChannel (channel);
+  NetDeviceContainer d;
+  d.Add (txDev);
+  d.Add (rxDev);
+
+  Ipv4AddressHelper ipv4;
+  ipv4.SetBase ("10.1.1.0", "255.255.255.0");
+  Ipv4InterfaceContainer i = ipv4.Assign (d);
+
+  Address peer = InetSocketAddress (i.GetAddress (1), 9);
+  PacketSinkHelper sinkHelper ("ns3::TcpSocketFactory", InetSocketAddress (Ipv4Address::GetAny (), 9));
+  ApplicationContainer sinks = sinkHelper.Install (n.Get (1));
+  sinks.Start (Seconds (0.5));
+
+  ObjectFactory factory;
+  factory.SetTypeId (m_tid);
+  factory.Set ("SendSize", UintegerValue (1000));
+  factory.Set ("ReuseConnections", BooleanValue (true));
+  factory.Set ("Arrivals", EnumValue (PersistentBulkSendApplication::ARRIVALS_EXTERNAL));
+  Ptr<PersistentBulkSendApplication> app = factory.Create<PersistentBulkSendApplication> ();
+  n.Get (0)->AddApplication (app);
+  app->TraceConnectWithoutContext ("Start", MakeCallback (&PersistentBulkSendReuseTestCase::SocketStart, this));
+  app->TraceConnectWithoutContext ("FlowComplete", MakeCallback (&PersistentBulkSendReuseTestCase::FlowComplete, this));
+  app->SetStartTime (Seconds (1.0));
+  app->SetStopTime (Seconds (5.0));
+
+  // Two flows back to back, then one more round once they are done
+  Simulator::Schedule (Seconds (1.0), &PersistentBulkSendApplication::AddFlow, app, peer, 5000);
+  Simulator::Schedule (Seconds (1.0), &PersistentBulkSendApplication::AddFlow, app, peer, 3000);
+  Simulator::Schedule (Seconds (3.0), &PersistentBulkSendApplication::AddFlow, app, peer, 7000);
+
+  Simulator::Run ();
+
+  NS_TEST_EXPECT_MSG_EQ (m_sockets.size (), 1, "One connection carries every flow");
+  NS_TEST_ASSERT_MSG_EQ (m_completed.size (), 3, "Every flow completes");
+  NS_TEST_EXPECT_MSG_EQ (m_completed[0], 5000, "Flows complete in order");
+  NS_TEST_EXPECT_MSG_EQ (m_completed[1], 3000, "Flows complete in order");
+  NS_TEST_EXPECT_MSG_EQ (m_completed[2], 7000, "Flows complete in order");
+  NS_TEST_EXPECT_MSG_EQ (DynamicCast<PacketSink> (sinks.Get (0))->GetTotalRx (), 15000, "Every byte arrives");
+  if (m_tid == "ns3::PriorityPersistentBulkSendApplication")
+    {
+      // The last flow ends where the connection's bytes end
+      DoubleValue priority;
+      m_sockets[0]->GetAttribute ("Priority", priority);
+      NS_TEST_EXPECT_MSG_EQ (priority.Get (), 15000, "Priority counts from the start of the connection");
+    }
+
+  Simulator::Destroy ();
+}
+
+/**
+ * Flows without a reused connection start on connections of their own
+ * as they arrive, without waiting for the flows before them
+ */
+class PersistentBulkSendConcurrentTestCase : public TestCase
+{
+public:
+  PersistentBulkSendConcurrentTestCase ();
+
+private:
+  virtual void DoRun (void);
+  void SocketStart (Ptr<Socket> socket);
+  void FlowComplete (Time start, uint64_t bytes, uint32_t flows);
+
+  std::vector<Time> m_starts;
+  std::vector<uint64_t> m_completed;
+  std::vector<Time> m_completedAt;
+};
+
+PersistentBulkSendConcurrentTestCase::PersistentBulkSendConcurrentTestCase ()
+  : TestCase ("Flows are sent on concurrent connections")
+{
+}
+
+void
+PersistentBulkSendConcurrentTestCase::SocketStart (Ptr<Socket> socket)
+{
+  m_starts.push_back (Simulator::Now ());
+}
+
+void
+PersistentBulkSendConcurrentTestCase::FlowComplete (Time start, uint64_t bytes, uint32_t flows)
+{
+  m_completed.push_back (bytes);
+  m_completedAt.push_back (Simulator::Now ());
+}
+
+void
+PersistentBulkSendConcurrentTestCase::DoRun (void)
+{
+  NodeContainer n;
+  n.Create (2);
+
+  InternetStackHelper internet;
+  internet.Install (n);
+
+  Ptr<SimpleNetDevice> txDev = CreateObject<SimpleNetDevice> ();
+  Ptr<SimpleNetDevice> rxDev = CreateObject<SimpleNetDevice> ();
+  n.Get (0)->AddDevice (txDev);
+  n.Get (1)->AddDevice (rxDev);
+  Ptr<SimpleChannel> channel = CreateObject<SimpleChannel> ();
+  rxDev->SetChannel (channel);
+  txDev->SetChannel (channel);
+  NetDeviceContainer d;
+  d.Add (txDev);
+  d.Add (rxDev);
+
+  Ipv4AddressHelper ipv4;
+  ipv4.SetBase ("10.1.1.0", "255.255.255.0");
+  Ipv4InterfaceContainer i = ipv4.Assign (d);
+
+  // Nothing answers on the first peer, so its connection never completes
+  Address silent = InetSocketAddress (Ipv4Address ("10.1.1.3"), 9);
+  Address peer = InetSocketAddress (i.GetAddress (1), 9);
+  PacketSinkHelper sinkHelper ("ns3::TcpSocketFactory", InetSocketAddress (Ipv4Address::GetAny (), 9));
+  ApplicationContainer sinks = sinkHelper.Install (n.Get (1));
+  sinks.Start (Seconds (0.5));
+
+  Ptr<PersistentBulkSendApplication> app = CreateObject<PersistentBulkSendApplication> ();
+  app->SetAttribute ("SendSize", UintegerValue (1000));
+  app->SetAttribute ("Arrivals", EnumValue (PersistentBulkSendApplication::ARRIVALS_EXTERNAL));
+  n.Get (0)->AddApplication (app);
+  app->TraceConnectWithoutContext ("Start", MakeCallback (&PersistentBulkSendConcurrentTestCase::SocketStart, this));
+  app->TraceConnectWithoutContext ("FlowComplete", MakeCallback (&PersistentBulkSendConcurrentTestCase::FlowComplete, this));
+  app->SetStartTime (Seconds (1.0));
+  app->SetStopTime (Seconds (5.0));
+
+  Simulator::Schedule (Seconds (1.0), &PersistentBulkSendApplication::AddFlow, app, silent, 5000);
+  Simulator::Schedule (Seconds (2.0), &PersistentBulkSendApplication::AddFlow, app, peer, 3000);
+  Simulator::Run ();
+
+  NS_TEST_ASSERT_MSG_EQ (m_starts.size (), 2, "Each flow has its own connection");
+  NS_TEST_EXPECT_MSG_EQ (m_starts[1], Seconds (2.0), "The second flow starts on arrival");
+  NS_TEST_ASSERT_MSG_EQ ((m_completed.size () >= 1), true, "The second flow completes");
+  NS_TEST_EXPECT_MSG_EQ (m_completed[0], 3000, "The second flow is not held behind the first");
+  NS_TEST_EXPECT_MSG_EQ ((m_completedAt[0] < Seconds (3.0)), true, "The second flow is not held behind the first");
+  NS_TEST_EXPECT_MSG_EQ (DynamicCast<PacketSink> (sinks.Get (0))->GetTotalRx (), 3000, "Every byte of the second flow arrives");
+
+  Simulator::Destroy ();
+}
+
+/**
+ * Virtual payload is buffered by the TCP socket without packets from
+ * the application, and arrives in full
+ */
+class PersistentBulkSendVirtualTestCase : public TestCase
+{
+public:
+  PersistentBulkSendVirtualTestCase ();
+
+private:
+  virtual void DoRun (void);
+  void Tx (Ptr<const Packet> packet);
+  void FlowComplete (Time start, uint64_t bytes, uint32_t flows);
+
+  uint32_t m_tx;
+  std::vector<uint64_t> m_completed;
+};
+
+PersistentBulkSendVirtualTestCase::PersistentBulkSendVirtualTestCase ()
+  : TestCase ("Flows with virtual payload"),
+    m_tx (0)
+{
+}
+
+void
+PersistentBulkSendVirtualTestCase::Tx (Ptr<const Packet> packet)
+{
+  ++m_tx;
+}
+
+void
+PersistentBulkSendVirtualTestCase::FlowComplete (Time start, uint64_t bytes, uint32_t flows)
+{
+  m_completed.push_back (bytes);
+}
+
+void
+PersistentBulkSendVirtualTestCase::DoRun (void)
+{
+  NodeContainer n;
+  n.Create (2);
+
+  InternetStackHelper internet;
+  internet.Install (n);
+
+  Ptr<SimpleNetDevice> txDev = CreateObject<SimpleNetDevice> ();
+  Ptr<SimpleNetDevice> rxDev = CreateObject<SimpleNetDevice> ();
+  n.Get (0)->AddDevice (txDev);
+  n.Get (1)->AddDevice (rxDev);
+  Ptr<SimpleChannel> channel = CreateObject<SimpleChannel> ();
+  rxDev->SetChannel (channel);
+  txDev->SetChannel (channel);
+  NetDeviceContainer d;
+  d.Add (txDev);
+  d.Add (rxDev);
+
+  Ipv4AddressHelper ipv4;
+  ipv4.SetBase ("10.1.1.0", "255.255.255.0");
+  Ipv4InterfaceContainer i = ipv4.Assign (d);
+
+  Address peer = InetSocketAddress (i.GetAddress (1), 9);
+  PacketSinkHelper sinkHelper ("ns3::TcpSocketFactory", InetSocketAddress (Ipv4Address::GetAny (), 9));
+  ApplicationContainer sinks = sinkHelper.Install (n.Get (1));
+  sinks.Start (Seconds (0.5));
+
+  Ptr<PersistentBulkSendApplication> app = CreateObject<PersistentBulkSendApplication> ();
+  app->SetAttribute ("SendSize", UintegerValue (1000));
+  app->SetAttribute ("VirtualPayload", BooleanValue (true));
+  app->SetAttribute ("Arrivals", EnumValue (PersistentBulkSendApplication::ARRIVALS_EXTERNAL));
+  n.Get (0)->AddApplication (app);
+  app->TraceConnectWithoutContext ("Tx", MakeCallback (&PersistentBulkSendVirtualTestCase::Tx, this));
+  app->TraceConnectWithoutContext ("FlowComplete", MakeCallback (&PersistentBulkSendVirtualTestCase::FlowComplete, this));
+  app->SetStartTime (Seconds (1.0));
+  app->SetStopTime (Seconds (5.0));
+
+  Simulator::Schedule (Seconds (1.0), &PersistentBulkSendApplication::AddFlow, app, peer, 25000);
+  Simulator::Run ();
+
+  NS_TEST_ASSERT_MSG_EQ (m_completed.size (), 1, "The flow completes");
+  NS_TEST_EXPECT_MSG_EQ (m_completed[0], 25000, "The flow completes");
+  NS_TEST_EXPECT_MSG_EQ (m_tx, 0, "No packets are made by the application");
+  NS_TEST_EXPECT_MSG_EQ (DynamicCast<PacketSink> (sinks.Get (0))->GetTotalRx (), 25000, "Every byte arrives");
+
+  Simulator::Destroy ();
+}
+
+class PersistentBulkSendTestSuite : public TestSuite
+{
+public:
+  PersistentBulkSendTestSuite ();
+};
+
+PersistentBulkSendTestSuite::PersistentBulkSendTestSuite ()
+  : TestSuite ("persistent-bulk-send", UNIT)
+{
+  AddTestCase (new PersistentBulkSendReuseTestCase ("ns3::PersistentBulkSendApplication"));
+  AddTestCase (new PersistentBulkSendReuseTestCase ("ns3::PriorityPersistentBulkSendApplication"));
+  AddTestCase (new PersistentBulkSendConcurrentTestCase);
+  AddTestCase (new PersistentBulkSendVirtualTestCase);
+}
+
+static PersistentBulkSendTestSuite persistentBulkSendTestSuite;
@@ -20,11 +20,101 @@
 
 #include "event-impl.h"
 #include "log.h"
+#include <new>
 
 NS_LOG_COMPONENT_DEFINE ("EventImpl");
 
 namespace ns3 {
 
+namespace {
+
+enum
+{
+  GRANULE = 16,               // Size class step, and block alignment
+  MAX_POOLED = 256,           // Largest pooled event
+  CLASSES = MAX_POOLED / GRANULE,
+  CHUNK = 64 * 1024           // Bytes taken from the system at a time
+};
+
+struct FreeBlock
+{
+  FreeBlock *next;
+};
+
+/* Events are created by the thread which schedules them but destroyed
+ * by the simulation thread, so each thread frees into its own lists;
+ * blocks migrate to the thread which destroys them. */
+struct EventPool
+{
+  FreeBlock *free[CLASSES];   // Destroyed event blocks, by size class
+  char *chunk;                // Unused end of the current chunk
+  size_t chunkLeft;
+  EventImpl::PoolStats stats;
+};
+
+__thread EventPool g_eventPool;
+
+} // anonymous namespace
+
+void *
+EventImpl::operator new (size_t size)
+{
+  EventPool &pool = g_eventPool;
+  pool.stats.allocated++;
+  if (size > MAX_POOLED)
+    {
+      pool.stats.unpooled++;
+      return ::operator new (size);
+    }
+  uint32_t sizeClass = (size - 1) / GRANULE;
+  FreeBlock *block = pool.free[sizeClass];
+  if (block != 0)
+    {
+      pool.free[sizeClass] = block->next;
+      pool.stats.recycled++;
+      return block;
+    }
+  size_t blockSize = (sizeClass + 1) * GRANULE;
+  if (pool.chunkLeft < blockSize)
+    {
+      // The tail of the old chunk is too small for this class; leave it
+      pool.chunk = static_cast<char *> (::operator new (CHUNK));
+      pool.chunkLeft = CHUNK;
+      pool.stats.chunks++;
+    }
+  void *p = pool.chunk;
+  pool.chunk += blockSize;
+  pool.chunkLeft -= blockSize;
+  return p;
+}
+
+void
+EventImpl::operator delete (void *p, size_t size)
+{
+  if (p == 0)
+    {
+      return;
+    }
+  if (size > MAX_POOLED)
+    {
+      ::operator delete (p);
+      return;
+    }
+  EventPool &pool = g_eventPool;
+  uint32_t sizeClass = (size - 1) / GRANULE;
+  FreeBlock *block = static_cast<FreeBlock *> (p);
+  block->next = pool.free[sizeClass];
+  pool.free[sizeClass] = block;
+}
+
+EventImpl::PoolStats
+EventImpl::GetPoolStats (void)
+{
+  PoolStats stats = g_eventPool.stats;
+  stats.avoided = stats.allocated - stats.chunks - stats.unpooled;
+  return stats;
+}
+
 EventImpl::~EventImpl ()
 {
   NS_LOG_FUNCTION (this);
@@ -21,6 +21,7 @@
 #define EVENT_IMPL_H
 
 #include <stdint.h>
+#include <cstddef>
 #include "simple-ref-count.h"
 
 namespace ns3 {
@@ -35,12 +36,37 @@ namespace ns3 {
  * obviously (there are Ref and Unref methods) reference-counted and
  * most subclasses are usually created by one of the many Simulator::Schedule
  * methods.
+ *
+ * Events, whatever their subclass, are allocated from per-thread free
+ * lists of 16-byte size classes carved out of large chunks, so the
+ * event and its bound arguments cost no call to the system allocator
+ * once the block of an earlier event of the same size class is free.
  */
 class EventImpl : public SimpleRefCount<EventImpl>
 {
 public:
+  /**
+   * Counters of the event allocator of the calling thread
+   */
+  struct PoolStats
+  {
+    uint64_t allocated;   //< Events allocated
+    uint64_t recycled;    //< Events given the block of a destroyed event
+    uint64_t chunks;      //< Chunks taken from the system allocator
+    uint64_t unpooled;    //< Events too large for the pool
+    uint64_t avoided;     //< System allocations avoided, allocated - chunks - unpooled
+  };
+
   EventImpl ();
   virtual ~EventImpl () = 0;
+
+  static void *operator new (size_t size);
+  static void operator delete (void *p, size_t size);
+  /**
+   * \returns the counters of the event allocator of the calling thread
+   */
+  static PoolStats GetPoolStats (void);
+
   /**
    * Called by the simulation engine to notify the event that it has expired.
    */
@@ -0,0 +1,164 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "radix-heap-scheduler.h"
+#include "event-impl.h"
+#include "assert.h"
+#include "log.h"
+
+NS_LOG_COMPONENT_DEFINE ("RadixHeapScheduler");
+
+namespace ns3 {
+
+NS_OBJECT_ENSURE_REGISTERED (RadixHeapScheduler);
+
+TypeId
+RadixHeapScheduler::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::RadixHeapScheduler")
+    .SetParent<Scheduler> ()
+    .AddConstructor<RadixHeapScheduler> ()
+  ;
+  return tid;
+}
+
+RadixHeapScheduler::RadixHeapScheduler ()
+  : m_size (0)
+{
+  NS_LOG_FUNCTION (this);
+  m_last.m_ts = 0;
+  m_last.m_uid = 0;
+  m_last.m_context = 0;
+}
+
+RadixHeapScheduler::~RadixHeapScheduler ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+inline uint32_t
+RadixHeapScheduler::GetBucket (const EventKey &key) const
+{
+  uint64_t ts = key.m_ts ^ m_last.m_ts;
+  if (ts != 0)
+    {
+      return 96 - __builtin_clzll (ts);
+    }
+  uint32_t uid = key.m_uid ^ m_last.m_uid;
+  if (uid != 0)
+    {
+      return 32 - __builtin_clz (uid);
+    }
+  return 0;
+}
+
+uint32_t
+RadixHeapScheduler::FindSmallest (const Bucket &bucket) const
+{
+  uint32_t smallest = 0;
+  for (uint32_t i = 1; i < bucket.size (); i++)
+    {
+      if (bucket[i].key < bucket[smallest].key)
+        {
+          smallest = i;
+        }
+    }
+  return smallest;
+}
+
+void
+RadixHeapScheduler::Insert (const Event &ev)
+{
+  NS_LOG_FUNCTION (this << &ev);
+  NS_ASSERT_MSG (!(ev.key < m_last), "Event inserted before the last one removed");
+  m_buckets[GetBucket (ev.key)].push_back (ev);
+  m_size++;
+}
+
+bool
+RadixHeapScheduler::IsEmpty (void) const
+{
+  return m_size == 0;
+}
+
+Scheduler::Event
+RadixHeapScheduler::PeekNext (void) const
+{
+  NS_LOG_FUNCTION (this);
+  NS_ASSERT (!IsEmpty ());
+  // Spreading the bucket here would move m_last past events that may
+  // still be inserted before the next one
+  uint32_t i = 0;
+  while (m_buckets[i].empty ())
+    {
+      i++;
+    }
+  return m_buckets[i][FindSmallest (m_buckets[i])];
+}
+
+Scheduler::Event
+RadixHeapScheduler::RemoveNext (void)
+{
+  NS_LOG_FUNCTION (this);
+  NS_ASSERT (!IsEmpty ());
+  if (m_buckets[0].empty ())
+    {
+      uint32_t i = 1;
+      while (m_buckets[i].empty ())
+        {
+          i++;
+        }
+      // Every key of bucket i now differs from m_last below bit i, and
+      // the keys of the higher buckets keep their bucket
+      Bucket bucket;
+      bucket.swap (m_buckets[i]);
+      m_last = bucket[FindSmallest (bucket)].key;
+      for (Bucket::const_iterator j = bucket.begin (); j != bucket.end (); j++)
+        {
+          m_buckets[GetBucket (j->key)].push_back (*j);
+        }
+      // Give the storage back to bucket i, which is empty until the
+      // next spread reaches it
+      bucket.clear ();
+      bucket.swap (m_buckets[i]);
+    }
+  // Keys are unique, so bucket 0 holds a single event
+  Event next = m_buckets[0].back ();
+  m_buckets[0].pop_back ();
+  m_size--;
+  return next;
+}
+
+void
+RadixHeapScheduler::Remove (const Event &ev)
+{
+  NS_LOG_FUNCTION (this << &ev);
+  Bucket &bucket = m_buckets[GetBucket (ev.key)];
+  for (Bucket::iterator i = bucket.begin (); i != bucket.end (); i++)
+    {
+      if (i->key.m_uid == ev.key.m_uid)
+        {
+          NS_ASSERT (i->impl == ev.impl);
+          *i = bucket.back ();
+          bucket.pop_back ();
+          m_size--;
+          return;
+        }
+    }
+  NS_ASSERT (false);
+}
+
+} // namespace ns3
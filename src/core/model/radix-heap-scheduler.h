@@ -0,0 +1,75 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef RADIX_HEAP_SCHEDULER_H
+#define RADIX_HEAP_SCHEDULER_H
+
+#include "scheduler.h"
+#include <stdint.h>
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * \ingroup scheduler
+ * \brief a radix heap event scheduler
+ *
+ * Events are kept in unsorted vectors, or buckets, by the highest bit
+ * in which their key differs from that of the last event removed:
+ * bucket 0 holds the key equal to it, buckets 1 to 32 the keys which
+ * differ in the uid alone and buckets 33 to 96 the keys which differ in
+ * the timestamp. An insertion is an append; a removal that finds
+ * bucket 0 empty takes the lowest non-empty bucket, makes its smallest
+ * key the new reference and spreads the bucket over the lower ones.
+ * Each event moves down a few buckets at most, and the near-future
+ * events which dominate data center simulations stay in the small low
+ * buckets, never compared against the far timers.
+ *
+ * This relies on no event being inserted before the last one removed,
+ * which the simulator guarantees: events are never scheduled in the
+ * past and uids grow with each scheduled event.
+ */
+class RadixHeapScheduler : public Scheduler
+{
+public:
+  static TypeId GetTypeId (void);
+
+  RadixHeapScheduler ();
+  virtual ~RadixHeapScheduler ();
+
+  virtual void Insert (const Event &ev);
+  virtual bool IsEmpty (void) const;
+  virtual Event PeekNext (void) const;
+  virtual Event RemoveNext (void);
+  virtual void Remove (const Event &ev);
+
+private:
+  enum { BUCKETS = 97 };
+  typedef std::vector<Scheduler::Event> Bucket;
+
+  /* Index of the bucket of key, relative to m_last. */
+  uint32_t GetBucket (const EventKey &key) const;
+  /* Index of the smallest event of a non-empty bucket. */
+  uint32_t FindSmallest (const Bucket &bucket) const;
+
+  Bucket m_buckets[BUCKETS];
+  EventKey m_last;      // Key of the last event removed
+  uint32_t m_size;      // Number of events in the buckets
+};
+
+} // namespace ns3
+
+#endif /* RADIX_HEAP_SCHEDULER_H */
@@ -0,0 +1,118 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "recording-scheduler.h"
+#include "map-scheduler.h"
+#include "object-factory.h"
+#include "string.h"
+#include "assert.h"
+#include "fatal-error.h"
+#include "log.h"
+
+NS_LOG_COMPONENT_DEFINE ("RecordingScheduler");
+
+namespace ns3 {
+
+NS_OBJECT_ENSURE_REGISTERED (RecordingScheduler);
+
+TypeId
+RecordingScheduler::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::RecordingScheduler")
+    .SetParent<Scheduler> ()
+    .AddConstructor<RecordingScheduler> ()
+    .AddAttribute ("Scheduler", "The type of the scheduler the calls are forwarded to",
+                   TypeIdValue (MapScheduler::GetTypeId ()),
+                   MakeTypeIdAccessor (&RecordingScheduler::m_schedulerType),
+                   MakeTypeIdChecker ())
+    .AddAttribute ("FileName", "The file the calls are recorded in",
+                   StringValue ("scheduler.events"),
+                   MakeStringAccessor (&RecordingScheduler::m_fileName),
+                   MakeStringChecker ())
+  ;
+  return tid;
+}
+
+RecordingScheduler::RecordingScheduler ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+RecordingScheduler::~RecordingScheduler ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+void
+RecordingScheduler::NotifyConstructionCompleted (void)
+{
+  Scheduler::NotifyConstructionCompleted ();
+  ObjectFactory factory;
+  factory.SetTypeId (m_schedulerType);
+  m_scheduler = factory.Create<Scheduler> ();
+  m_file.open (m_fileName.c_str (), std::ios::out | std::ios::binary | std::ios::trunc);
+  if (!m_file)
+    {
+      NS_FATAL_ERROR ("Cannot open scheduler trace file " << m_fileName);
+    }
+  m_file.write ("NS3EVT01", 8);
+}
+
+void
+RecordingScheduler::Record (const Event &ev, SchedulerTraceEntry::Op op)
+{
+  SchedulerTraceEntry entry = { ev.key.m_ts, ev.key.m_uid, op };
+  m_file.write (reinterpret_cast<const char *> (&entry), sizeof (entry));
+}
+
+void
+RecordingScheduler::Insert (const Event &ev)
+{
+  NS_LOG_FUNCTION (this << &ev);
+  Record (ev, SchedulerTraceEntry::INSERT);
+  m_scheduler->Insert (ev);
+}
+
+bool
+RecordingScheduler::IsEmpty (void) const
+{
+  return m_scheduler->IsEmpty ();
+}
+
+Scheduler::Event
+RecordingScheduler::PeekNext (void) const
+{
+  return m_scheduler->PeekNext ();
+}
+
+Scheduler::Event
+RecordingScheduler::RemoveNext (void)
+{
+  NS_LOG_FUNCTION (this);
+  Event next = m_scheduler->RemoveNext ();
+  Record (next, SchedulerTraceEntry::REMOVE_NEXT);
+  return next;
+}
+
+void
+RecordingScheduler::Remove (const Event &ev)
+{
+  NS_LOG_FUNCTION (this << &ev);
+  Record (ev, SchedulerTraceEntry::REMOVE);
+  m_scheduler->Remove (ev);
+}
+
+} // namespace ns3
@@ -0,0 +1,89 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef RECORDING_SCHEDULER_H
+#define RECORDING_SCHEDULER_H
+
+#include "scheduler.h"
+#include "type-id.h"
+#include "ptr.h"
+#include <stdint.h>
+#include <string>
+#include <fstream>
+
+namespace ns3 {
+
+/**
+ * \ingroup scheduler
+ *
+ * One operation of a scheduler trace file. A file is the 8-byte magic
+ * "NS3EVT01" followed by fixed-size entries in the host's byte order,
+ * in the order the simulator made the calls; utils/bench-scheduler
+ * replays it.
+ */
+struct SchedulerTraceEntry
+{
+  enum Op
+  {
+    INSERT = 0,
+    REMOVE_NEXT = 1,
+    REMOVE = 2
+  };
+  uint64_t ts;    //< Timestamp of the event, in time steps
+  uint32_t uid;   //< Uid of the event
+  uint32_t op;    //< One of Op
+};
+
+/**
+ * \ingroup scheduler
+ * \brief a scheduler which records the calls made to another one
+ *
+ * Forwards every call to a scheduler of the type given by the Scheduler
+ * attribute and appends it to the trace file named by FileName, so
+ * the event list of a real simulation can be replayed against each
+ * scheduler. Select it with the SchedulerType global value, e.g.
+ * --SchedulerType=ns3::RecordingScheduler
+ * --ns3::RecordingScheduler::FileName=oldi.events
+ */
+class RecordingScheduler : public Scheduler
+{
+public:
+  static TypeId GetTypeId (void);
+
+  RecordingScheduler ();
+  virtual ~RecordingScheduler ();
+
+  virtual void Insert (const Event &ev);
+  virtual bool IsEmpty (void) const;
+  virtual Event PeekNext (void) const;
+  virtual Event RemoveNext (void);
+  virtual void Remove (const Event &ev);
+
+protected:
+  virtual void NotifyConstructionCompleted (void);
+
+private:
+  void Record (const Event &ev, SchedulerTraceEntry::Op op);
+
+  TypeId m_schedulerType;
+  std::string m_fileName;
+  Ptr<Scheduler> m_scheduler;
+  std::ofstream m_file;
+};
+
+} // namespace ns3
+
+#endif /* RECORDING_SCHEDULER_H */
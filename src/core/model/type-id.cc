@@ -49,6 +49,7 @@ public:
   bool HasConstructor (uint16_t uid) const;
   uint32_t GetRegisteredN (void) const;
   uint16_t GetRegistered (uint32_t i) const;
+  uint32_t GetInitialValueVersion (void) const;
   void AddAttribute (uint16_t uid, 
                      std::string name,
                      std::string help, 
@@ -88,9 +89,11 @@ private:
   struct IidManager::IidInformation *LookupInformation (uint16_t uid) const;
 
   std::vector<struct IidInformation> m_information;
+  uint32_t m_initialValueVersion;
 };
 
 IidManager::IidManager ()
+  : m_initialValueVersion (0)
 {
   NS_LOG_FUNCTION (this);
 }
@@ -299,6 +302,14 @@ IidManager::SetAttributeInitialValue(uint16_t uid,
   struct IidInformation *information = LookupInformation (uid);
   NS_ASSERT (i < information->attributes.size ());
   information->attributes[i].initialValue = initialValue;
+  m_initialValueVersion++;
+}
+
+uint32_t
+IidManager::GetInitialValueVersion (void) const
+{
+  NS_LOG_FUNCTION (this);
+  return m_initialValueVersion;
 }
 
 
@@ -444,6 +455,12 @@ TypeId::GetRegistered (uint32_t i)
   NS_LOG_FUNCTION (i);
   return TypeId (Singleton<IidManager>::Get ()->GetRegistered (i));
 }
+uint32_t
+TypeId::GetInitialValueVersion (void)
+{
+  NS_LOG_FUNCTION_NOARGS ();
+  return Singleton<IidManager>::Get ()->GetInitialValueVersion ();
+}
 
 bool
 TypeId::LookupAttributeByName (std::string name, struct TypeId::AttributeInformation *info) const
@@ -94,6 +94,13 @@ public:
    * \returns the TypeId instance whose index is i.
    */
   static TypeId GetRegistered (uint32_t i);
+  /**
+   * \returns a number which changes whenever the initial value of an
+   *          attribute of any TypeId is set, e.g. by Config::SetDefault.
+   *          Objects built ahead of time from the initial values can
+   *          compare it to tell whether they are out of date.
+   */
+  static uint32_t GetInitialValueVersion (void);
 
   /**
    * \param name the name of the interface to construct.
@@ -19,10 +19,14 @@
  */
 #include "ns3/test.h"
 #include "ns3/simulator.h"
+#include "ns3/event-impl.h"
 #include "ns3/list-scheduler.h"
 #include "ns3/heap-scheduler.h"
 #include "ns3/map-scheduler.h"
 #include "ns3/calendar-scheduler.h"
+#include "ns3/radix-heap-scheduler.h"
+
+#include <vector>
 
 using namespace ns3;
 
@@ -459,6 +463,120 @@ SimulatorTemplateTestCase::DoRun (void)
   Simulator::Destroy ();
 }
 
+class SimulatorEventOrderTestCase : public TestCase
+{
+public:
+  SimulatorEventOrderTestCase (ObjectFactory schedulerFactory);
+private:
+  void Record (uint32_t i);
+  virtual void DoRun (void);
+  std::vector<uint32_t> m_order;
+  ObjectFactory m_schedulerFactory;
+};
+
+SimulatorEventOrderTestCase::SimulatorEventOrderTestCase (ObjectFactory schedulerFactory)
+  : TestCase ("Check that events scheduled out of order run in order with " +
+              schedulerFactory.GetTypeId ().GetName ()),
+    m_schedulerFactory (schedulerFactory)
+{
+}
+
+void
+SimulatorEventOrderTestCase::Record (uint32_t i)
+{
+  m_order.push_back (i);
+}
+
+void
+SimulatorEventOrderTestCase::DoRun (void)
+{
+  Simulator::SetScheduler (m_schedulerFactory);
+
+  // Into an empty event list, latest first
+  Simulator::Schedule (Seconds (2), &SimulatorEventOrderTestCase::Record, this, 2);
+  Simulator::Schedule (Seconds (1), &SimulatorEventOrderTestCase::Record, this, 1);
+  Simulator::Run ();
+  NS_TEST_ASSERT_MSG_EQ (m_order.size (), 2, "Events run");
+  NS_TEST_EXPECT_MSG_EQ (m_order[0], 1, "First event");
+  NS_TEST_EXPECT_MSG_EQ (m_order[1], 2, "Second event");
+
+  // Into the event list drained by the run, at 2s
+  m_order.clear ();
+  Simulator::Schedule (Seconds (3), &SimulatorEventOrderTestCase::Record, this, 5);
+  Simulator::Schedule (Seconds (1), &SimulatorEventOrderTestCase::Record, this, 3);
+  Simulator::Schedule (Seconds (2), &SimulatorEventOrderTestCase::Record, this, 4);
+  Simulator::ScheduleNow (&SimulatorEventOrderTestCase::Record, this, 2);
+  Simulator::Run ();
+  NS_TEST_ASSERT_MSG_EQ (m_order.size (), 4, "Events run");
+  for (uint32_t i = 0; i < 4; i++)
+    {
+      NS_TEST_EXPECT_MSG_EQ (m_order[i], i + 2, "Event " << i);
+    }
+
+  Simulator::Destroy ();
+}
+
+struct LargeEventArgument
+{
+  uint8_t bytes[300];
+};
+
+class SimulatorEventPoolTestCase : public TestCase
+{
+public:
+  SimulatorEventPoolTestCase ();
+private:
+  static void Small (uint32_t i);
+  static void Large (LargeEventArgument argument);
+  virtual void DoRun (void);
+};
+
+SimulatorEventPoolTestCase::SimulatorEventPoolTestCase ()
+  : TestCase ("Check that destroyed events give their blocks to new ones")
+{
+}
+
+void
+SimulatorEventPoolTestCase::Small (uint32_t i)
+{
+}
+
+void
+SimulatorEventPoolTestCase::Large (LargeEventArgument argument)
+{
+}
+
+void
+SimulatorEventPoolTestCase::DoRun (void)
+{
+  for (uint32_t i = 0; i < 1000; i++)
+    {
+      Simulator::Schedule (MicroSeconds (i), &SimulatorEventPoolTestCase::Small, i);
+    }
+  Simulator::Run ();
+
+  // Every event of the second round reuses the block of one of the first
+  EventImpl::PoolStats before = EventImpl::GetPoolStats ();
+  for (uint32_t i = 0; i < 1000; i++)
+    {
+      Simulator::Schedule (MicroSeconds (i), &SimulatorEventPoolTestCase::Small, i);
+    }
+  Simulator::Run ();
+  EventImpl::PoolStats after = EventImpl::GetPoolStats ();
+  NS_TEST_EXPECT_MSG_EQ (after.allocated - before.allocated, 1000, "Events allocated");
+  NS_TEST_EXPECT_MSG_EQ (after.recycled - before.recycled, 1000, "Events given a destroyed event's block");
+  NS_TEST_EXPECT_MSG_EQ (after.chunks, before.chunks, "Chunks taken for recycled events");
+  NS_TEST_EXPECT_MSG_EQ (after.avoided - before.avoided, 1000, "System allocations avoided");
+
+  // Events too large for the pool come from the system allocator
+  LargeEventArgument argument;
+  Simulator::Schedule (Seconds (1), &SimulatorEventPoolTestCase::Large, argument);
+  Simulator::Run ();
+  NS_TEST_EXPECT_MSG_EQ (EventImpl::GetPoolStats ().unpooled - after.unpooled, 1, "Large event pooled");
+
+  Simulator::Destroy ();
+}
+
 class SimulatorTestSuite : public TestSuite
 {
 public:
@@ -475,5 +593,16 @@ public:
     AddTestCase (new SimulatorEventsTestCase (factory));
     factory.SetTypeId (CalendarScheduler::GetTypeId ());
     AddTestCase (new SimulatorEventsTestCase (factory));
+    factory.SetTypeId (RadixHeapScheduler::GetTypeId ());
+    AddTestCase (new SimulatorEventsTestCase (factory));
+    factory.SetTypeId (MapScheduler::GetTypeId ());
+    AddTestCase (new SimulatorEventOrderTestCase (factory));
+    factory.SetTypeId (HeapScheduler::GetTypeId ());
+    AddTestCase (new SimulatorEventOrderTestCase (factory));
+    factory.SetTypeId (CalendarScheduler::GetTypeId ());
+    AddTestCase (new SimulatorEventOrderTestCase (factory));
+    factory.SetTypeId (RadixHeapScheduler::GetTypeId ());
+    AddTestCase (new SimulatorEventOrderTestCase (factory));
+    AddTestCase (new SimulatorEventPoolTestCase ());
   }
 } g_simulatorTestSuite;
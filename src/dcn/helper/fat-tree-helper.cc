@@ -278,6 +278,23 @@ FatTreeHelper::Create()
     };
   };
 
+  /*
+   * The routes above follow the address plan, so let the routing module
+   * decode destinations straight to output ports instead of searching them.
+   */
+  for (unsigned j=0; j<numST; j++) { // For each subtree
+    for(unsigned i=0; i<N; i++) { // For each edge and aggr
+      hashHelper.GetHashRouting(m_edge.Get(j*N+i)->GetObject<Ipv4>())->SetFatTreePosition(HashRouting::FAT_TREE_EDGE, N, j, i);
+      hashHelper.GetHashRouting(m_aggr.Get(j*N+i)->GetObject<Ipv4>())->SetFatTreePosition(HashRouting::FAT_TREE_AGGR, N, j);
+    };
+  };
+  for(unsigned i=0; i<numCore; i++) {
+    hashHelper.GetHashRouting(m_core.Get(i)->GetObject<Ipv4>())->SetFatTreePosition(HashRouting::FAT_TREE_CORE, N);
+  };
+  for(unsigned i=0; i<numHost; i++) {
+    hashHelper.GetHashRouting(m_host.Get(i)->GetObject<Ipv4>())->SetFatTreePosition(HashRouting::FAT_TREE_HOST, N);
+  };
+
 #ifdef NS3_LOG_ENABLE
   if (! g_log.IsEnabled(ns3::LOG_DEBUG)) {
     return;
@@ -0,0 +1,134 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ns3/assert.h"
+#include "ns3/log.h"
+#include "ns3/rng-seed-manager.h"
+#include "ns3/simulator.h"
+#include "sweep-helper.h"
+
+#include <iostream>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <sys/wait.h>
+#include <unistd.h>
+
+NS_LOG_COMPONENT_DEFINE ("SweepHelper");
+
+namespace ns3 {
+
+/* Run the ScheduleDestroy hooks of a worker's simulation, which write out
+ * its buffered results, and its pending output before the worker exits */
+static void
+SweepWorkerExit (void)
+{
+  Simulator::Destroy ();
+  std::cout.flush ();
+  std::clog.flush ();
+  std::fflush (0);
+}
+
+SweepHelper::SweepHelper ()
+  : m_firstRun (SeedManager::GetRun ()),
+    m_runs (1),
+    m_jobs (1),
+    m_failures (0)
+{
+}
+
+void
+SweepHelper::SetRuns (uint32_t firstRun, uint32_t runs)
+{
+  m_firstRun = firstRun;
+  m_runs = runs;
+}
+
+void
+SweepHelper::SetJobs (uint32_t jobs)
+{
+  NS_ASSERT (jobs > 0);
+  m_jobs = jobs;
+}
+
+bool
+SweepHelper::Fork (void)
+{
+  NS_LOG_FUNCTION (this << m_firstRun << m_runs << m_jobs);
+  if (m_runs <= 1)
+    {
+      SeedManager::SetRun (m_firstRun);
+      return m_runs == 1;
+    }
+  // Flush, or every worker writes out the parent's pending output again
+  std::cout.flush ();
+  std::clog.flush ();
+  std::fflush (0);
+
+  m_failures = 0;
+  uint32_t next = 0;
+  while (next < m_runs || !m_workers.empty ())
+    {
+      if (next < m_runs && m_workers.size () < m_jobs)
+        {
+          uint32_t run = m_firstRun + next++;
+          pid_t pid = ::fork ();
+          if (pid == 0)
+            {
+              SeedManager::SetRun (run);
+              std::atexit (&SweepWorkerExit);
+              return true;
+            }
+          if (pid < 0)
+            {
+              NS_LOG_ERROR ("Cannot fork run " << run << ": " << std::strerror (errno));
+              ++m_failures;
+              continue;
+            }
+          NS_LOG_INFO ("Run " << run << " started in process " << pid);
+          m_workers[pid] = run;
+          continue;
+        }
+      int status;
+      pid_t pid = ::wait (&status);
+      if (pid < 0)
+        {
+          NS_LOG_ERROR ("wait() fails: " << std::strerror (errno));
+          break;
+        }
+      std::map<pid_t, uint32_t>::iterator i = m_workers.find (pid);
+      if (i == m_workers.end ())
+        {
+          continue;
+        }
+      if (!WIFEXITED (status) || WEXITSTATUS (status) != 0)
+        {
+          NS_LOG_WARN ("Run " << i->second << " failed with status " << status);
+          ++m_failures;
+        }
+      m_workers.erase (i);
+    }
+  return false;
+}
+
+uint32_t
+SweepHelper::GetFailures (void) const
+{
+  return m_failures;
+}
+
+} // namespace ns3
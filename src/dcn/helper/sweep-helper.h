@@ -0,0 +1,74 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#ifndef SWEEP_HELPER_H
+#define SWEEP_HELPER_H
+
+#include <stdint.h>
+#include <sys/types.h>
+#include <map>
+
+namespace ns3 {
+
+/**
+ * \brief Run the replications of a simulation in a pool of worker processes
+ *
+ * A script parses its command line and sets its defaults once, then calls
+ * Fork() before it builds the network. Every worker is a fork of that
+ * process with its own RngRun, so the program start-up, library loading
+ * and TypeId registration are paid once per sweep instead of per run.
+ * Nothing random may be drawn before Fork(): each worker must produce
+ * the same output as a standalone run with the same RngRun.
+ */
+class SweepHelper
+{
+public:
+  /// A single replication of the current RngRun, with no worker forked
+  SweepHelper ();
+
+  /**
+   * \param firstRun the RngRun of the first replication
+   * \param runs the number of replications, with consecutive RngRun values
+   */
+  void SetRuns (uint32_t firstRun, uint32_t runs);
+
+  /// \param jobs the number of workers running at the same time
+  void SetJobs (uint32_t jobs);
+
+  /**
+   * In the parent, fork a worker for each replication, keeping at most
+   * jobs of them running, and return false once all have exited. In a
+   * worker, set RngRun and return true; the caller then builds and runs
+   * one replication and exits. A worker destroys the simulator when it
+   * exits, so results written by ScheduleDestroy hooks are not lost if
+   * the caller skips Simulator::Destroy(). A sweep of one replication
+   * runs in the calling process.
+   */
+  bool Fork (void);
+
+  /// \return the number of workers that did not exit successfully
+  uint32_t GetFailures (void) const;
+
+private:
+  uint32_t m_firstRun;
+  uint32_t m_runs;
+  uint32_t m_jobs;
+  uint32_t m_failures;
+  std::map<pid_t, uint32_t> m_workers;  // Running workers and their RngRun
+};
+
+} // namespace ns3
+
+#endif /* SWEEP_HELPER_H */
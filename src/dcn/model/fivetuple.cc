@@ -20,35 +20,27 @@
 
 #include "ns3/fivetuple.h"
 #include "ns3/ipv4-header.h"
-#include "ns3/tcp-header.h"
-#include "ns3/udp-header.h"
+#include "ns3/hash-function-impl.h"
 #include "ns3/log.h"
 
 NS_LOG_COMPONENT_DEFINE ("FiveTuple");
 
 namespace ns3 {
 
-// Given a packet, retrieve the flow id
-flowid::flowid(Ptr<Packet> p)
+// Given a packet with an IPv4 header at the given offset, retrieve the flow
+// id by reading the header fields in place, without copying the packet
+flowid::flowid(Ptr<const Packet> p, uint32_t offset)
 {
-	Ipv4Header iph;
-	Ptr<Packet> q = p->Copy();
-	q->RemoveHeader(iph);
-	uint32_t saddr = iph.GetSource().Get();
-	uint32_t daddr = iph.GetDestination().Get();
-	uint8_t  proto = iph.GetProtocol();
+	uint32_t ihl = (p->PeekU8(offset) & 0x0f) * 4;
+	uint8_t  proto = p->PeekU8(offset + 9);
+	uint32_t saddr = p->PeekNtohU32(offset + 12);
+	uint32_t daddr = p->PeekNtohU32(offset + 16);
 	uint16_t sport = 0;
 	uint16_t dport = 0;
-	if (proto == 17) {
-		UdpHeader udph;
-		q->RemoveHeader(udph);
-		sport = udph.GetSourcePort();
-		dport = udph.GetDestinationPort();
-	} else if (proto == 6) {
-		TcpHeader tcph;
-		q->RemoveHeader(tcph);
-		sport = tcph.GetSourcePort();
-		dport = tcph.GetDestinationPort();
+	if (proto == 17 || proto == 6) {
+		// UDP and TCP headers both start with the source and dest ports
+		sport = p->PeekNtohU16(offset + ihl);
+		dport = p->PeekNtohU16(offset + ihl + 2);
 	};
 
 	// Set the bits, note the first 12 bit in lo is always zero
@@ -58,7 +50,7 @@ flowid::flowid(Ptr<Packet> p)
 		| static_cast<uint64_t>(sport)) << 16 )
 		| static_cast<uint64_t>(dport);
 
-	NS_LOG_INFO("(" << iph.GetSource() << ":" << sport << " " << (int)proto << " " << iph.GetDestination() << ":" << dport << ") -> " << (*this));
+	NS_LOG_INFO("(" << Ipv4Address(saddr) << ":" << sport << " " << (int)proto << " " << Ipv4Address(daddr) << ":" << dport << ") -> " << (*this));
 };
 
 // Retrieve the flow id directly from five tuple
@@ -175,4 +167,10 @@ char* flowid::Write(char* s) const
 	return s;
 };
 
+size_t FlowIdHash::operator() (flowid const &x) const
+{
+	HashHsieh hash;
+	return hash(0, x);
+};
+
 }; // namespace ns3
@@ -22,6 +22,7 @@
 #define __FIVETUPLE_H__
 
 #include <iostream>
+#include <functional>
 #include "ns3/ptr.h"
 #include "ns3/packet.h"
 #include "ns3/ipv4-header.h"
@@ -34,7 +35,7 @@ class flowid {
 	friend class CnHeader;
 public:
 	flowid() : hi(0), lo(0) {};
-	flowid(Ptr<Packet> p);	// Set the flow Id from a packet
+	flowid(Ptr<const Packet> p, uint32_t offset = 0);	// Set the flow Id from a packet starting at the IPv4 header
 	flowid(char* id);	// Set the flow Id using a 16-byte char*
 	flowid(const Ipv4Header& iph);	// Set partial flow Id using Ipv4Header
 	flowid(uint32_t _saddr, uint32_t _daddr, uint8_t _proto, uint16_t _sport, uint16_t _dport);
@@ -66,6 +67,12 @@ inline std::ostream& operator<<(std::ostream& os, const flowid& fid)
 	return os;
 };
 
+// Hash functor to key hash tables by flow id
+class FlowIdHash : public std::unary_function<flowid, size_t> {
+public:
+	size_t operator() (flowid const &x) const;
+};
+
 }; // namespace ns3
 
 #endif
@@ -86,7 +86,10 @@ HashRouting::GetTypeId (void)
   return tid;
 }
 
-HashRouting::HashRouting () 
+HashRouting::HashRouting ()
+  : m_ftRole (FAT_TREE_NONE),
+    m_ftSize (0),
+    m_ftPrefix (0)
 {
   NS_LOG_FUNCTION_NOARGS ();
 }
@@ -101,9 +104,29 @@ HashRouting::AddRoute (const Ipv4Address& dest, const Ipv4Mask& mask, uint32_t i
 {
 	Ptr<DestRoute> r = Create<DestRoute>(dest, mask, interface);
 	m_destRouteTable.push_back(r);
+	m_ftRole = FAT_TREE_NONE;
 	NS_LOG_LOGIC("New route for interface "<< interface <<": "<< dest <<"/"<< mask);
 };
 
+void
+HashRouting::SetFatTreePosition (FatTreeRole role, uint32_t size, uint32_t subtree, uint32_t edge)
+{
+	NS_LOG_FUNCTION(this << role << size << subtree << edge);
+	m_ftRole = role;
+	m_ftSize = size;
+	switch (role) {
+	case FAT_TREE_EDGE:  // Host addresses below this edge switch
+		m_ftPrefix = (10U<<24) | (subtree<<17) | (edge<<10);
+		break;
+	case FAT_TREE_AGGR:  // Non-core addresses in this subtree
+		m_ftPrefix = (10U<<24) | (subtree<<17);
+		break;
+	default:
+		m_ftPrefix = (10U<<24);
+		break;
+	};
+};
+
 void
 HashRouting::PrintRoutingTable (Ptr<OutputStreamWrapper> stream) const
 {
@@ -114,18 +137,11 @@ flowid
 HashRouting::GetTuple(Ptr<const Packet> packet, const Ipv4Header& header)
 {
 	flowid tuple = flowid(header);
-	if (header.GetProtocol() == 17) {
-		// UDP packet
-		UdpHeader udph;
-		packet->PeekHeader(udph);
-		tuple.SetSPort(udph.GetSourcePort());
-		tuple.SetDPort(udph.GetDestinationPort());
-	} else if (header.GetProtocol() == 6) {
-		// TCP packet
-		TcpHeader tcph;
-		packet->PeekHeader(tcph);
-		tuple.SetSPort(tcph.GetSourcePort());
-		tuple.SetDPort(tcph.GetDestinationPort());
+	if ((header.GetProtocol() == 17 || header.GetProtocol() == 6) &&
+			packet != 0 && packet->GetSize() >= 4) {
+		// UDP or TCP packet: both start with the source and dest ports
+		tuple.SetSPort(packet->PeekNtohU16(0));
+		tuple.SetDPort(packet->PeekNtohU16(2));
 	};
 	return tuple;
 };
@@ -162,18 +178,7 @@ HashRouting::RouteOutput (Ptr<Packet> p, const Ipv4Header &header, Ptr<NetDevice
 	// Check for a route, and construct the Ipv4Route object
 	sockerr = Socket::ERROR_NOTERROR;
 	uint32_t iface = Lookup(GetTuple(p, header));
-   	Ptr<NetDevice> dev = m_ipv4->GetNetDevice(iface); // Convert output port to device
-   	Ptr<Channel> channel = dev->GetChannel(); // Channel used by the device
-	uint32_t otherEnd = (channel->GetDevice(0)==dev)?1:0; // Which end of the channel?
-	Ptr<Node> nextHop = channel->GetDevice(otherEnd)->GetNode(); // Node at other end
-   	uint32_t nextIf = channel->GetDevice(otherEnd)->GetIfIndex(); // Iface num at other end
-	Ipv4Address nextHopAddr = nextHop->GetObject<Ipv4>()->GetAddress(nextIf,0).GetLocal(); // Addr of other end
-	Ptr<Ipv4Route> r = Create<Ipv4Route> ();
-	r->SetOutputDevice(m_ipv4->GetNetDevice(iface));
-	r->SetGateway(nextHopAddr);
-	r->SetSource(m_ipv4->GetAddress(iface,0).GetLocal());
-	r->SetDestination(a);
-	return r;
+	return GetRoute(iface, a);
 }
 
 bool 
@@ -232,22 +237,37 @@ HashRouting::RouteInput  (Ptr<const Packet> p, const Ipv4Header &header, Ptr<con
 	}
 	// Next, try to find a route
 	outPort = Lookup(GetTuple(p, header));
-   	Ptr<NetDevice> dev = m_ipv4->GetNetDevice(outPort); // Convert output port to device
-   	Ptr<Channel> channel = dev->GetChannel(); // Channel used by the device
-	uint32_t otherEnd = (channel->GetDevice(0)==dev)?1:0; // Which end of the channel?
-	Ptr<Node> nextHop = channel->GetDevice(otherEnd)->GetNode(); // Node at other end
-   	uint32_t nextIf = channel->GetDevice(otherEnd)->GetIfIndex(); // Iface num at other end
-	Ipv4Address nextHopAddr = nextHop->GetObject<Ipv4>()->GetAddress(nextIf,0).GetLocal(); // Addr of other end
-	Ptr<Ipv4Route> r = Create<Ipv4Route> ();
-	r->SetOutputDevice(m_ipv4->GetNetDevice(outPort));
-	r->SetGateway(nextHopAddr);
-	r->SetSource(m_ipv4->GetAddress(outPort,0).GetLocal());
-	r->SetDestination(a);
+	Ptr<Ipv4Route> r = GetRoute(outPort, a);
 	NS_LOG_LOGIC ("Found unicast destination- calling unicast callback");
 	ucb(r, p, header);
 	return true;
 }
 
+Ptr<Ipv4Route>
+HashRouting::GetRoute(uint32_t port, const Ipv4Address& dest)
+{
+	if (m_routeCache.size() != m_ipv4->GetNInterfaces()) {
+		m_routeCache.clear();
+		m_routeCache.resize(m_ipv4->GetNInterfaces());
+	};
+	Ptr<Ipv4Route> r = m_routeCache[port];
+	if (r == 0) {
+		Ptr<NetDevice> dev = m_ipv4->GetNetDevice(port); // Convert output port to device
+		Ptr<Channel> channel = dev->GetChannel(); // Channel used by the device
+		uint32_t otherEnd = (channel->GetDevice(0)==dev)?1:0; // Which end of the channel?
+		Ptr<Node> nextHop = channel->GetDevice(otherEnd)->GetNode(); // Node at other end
+		uint32_t nextIf = channel->GetDevice(otherEnd)->GetIfIndex(); // Iface num at other end
+		Ipv4Address nextHopAddr = nextHop->GetObject<Ipv4>()->GetAddress(nextIf,0).GetLocal(); // Addr of other end
+		r = Create<Ipv4Route> ();
+		r->SetOutputDevice(dev);
+		r->SetGateway(nextHopAddr);
+		r->SetSource(m_ipv4->GetAddress(port,0).GetLocal());
+		m_routeCache[port] = r;
+	};
+	r->SetDestination(dest);
+	return r;
+}
+
 bool
 HashRouting::IsLocal (const Ipv4Address& dest)
 {
@@ -295,15 +315,14 @@ void
 HashRouting::DoDispose (void)
 {
 	m_ipv4 = 0;
-	while (!m_congRecord.empty()) {
-		m_congRecord.pop_back();
-	};
+	m_routeCache.clear();
+	m_congRecord.clear();
+	m_congRecordExpiry.clear();
 	while (!m_destRouteTable.empty()) {
 		m_destRouteTable.pop_back();
 	};
-	while (!m_flowRouteTable.empty()) {
-		m_flowRouteTable.pop_back();
-	};
+	m_flowRouteTable.clear();
+	m_flowRouteExpiry.clear();
 	Ipv4RoutingProtocol::DoDispose ();
 };
 
@@ -311,6 +330,35 @@ bool
 HashRouting::RequestDestRoute(const Ipv4Address& addr, uint32_t& outPort)
 {
 	NS_LOG_LOGIC("Dest IP to route: "<< std::hex << addr << std::dec);
+	if (m_ftRole != FAT_TREE_NONE) {
+		// Decode the fat-tree address plan, see FatTreeHelper::Create()
+		uint32_t a = addr.Get();
+		switch (m_ftRole) {
+		case FAT_TREE_HOST:  // Default route to the edge switch
+			outPort = 1;
+			return true;
+		case FAT_TREE_EDGE:  // Host route: port by host ID
+			if ((a & 0xFFFFFF00U) == m_ftPrefix && HostAddrToPort(a) < m_ftSize) {
+				outPort = HostAddrToPort(a) + 1;
+				return true;
+			};
+			return false;
+		case FAT_TREE_AGGR:  // Edge subnet route: port by edge ID
+			if ((a & 0xFFFF0000U) == m_ftPrefix && HostAddrToEdge(a) < m_ftSize) {
+				outPort = HostAddrToEdge(a) + 1;
+				return true;
+			};
+			return false;
+		case FAT_TREE_CORE:  // Subtree route: port by subtree ID
+			if ((a & 0xFF000000U) == m_ftPrefix && HostAddrToSubtree(a) < 2*m_ftSize) {
+				outPort = HostAddrToSubtree(a) + 1;
+				return true;
+			};
+			return false;
+		default:
+			break;
+		};
+	};
 	// Linear search for matching entry
 	for(DestRouteTable::iterator it = m_destRouteTable.begin(); it != m_destRouteTable.end(); it++) {
 		NS_LOG_LOGIC("Route in table: "<< std::hex << (*it)->dest << "/" << (*it)->mask << std::dec);
@@ -327,57 +375,77 @@ bool
 HashRouting::RequestFlowRoute(const flowid& tuple, uint32_t& outPort)
 {
 	NS_LOG_FUNCTION(this);
-	// Linear search for matching entry
-	FlowRouteTable::iterator it = m_flowRouteTable.begin();
-	while (it != m_flowRouteTable.end()) {
-		if ((*it)->last + m_lifetime < Simulator::Now()) {
-			// Erase expired entry
-			it = m_flowRouteTable.erase(it);
-			continue;
-		};
-		if (tuple == (*it)->fid) {
-			// Entry found: Update timestamp and return
-			outPort = (*it)->outPort;
-			(*it)->last = Simulator::Now();
-			return true;
+	ExpireRecords();
+	FlowRouteTable::iterator it = m_flowRouteTable.find(tuple);
+	if (it == m_flowRouteTable.end() || it->second->last + m_lifetime < Simulator::Now()) {
+		// No entry, or an expired one waiting for ExpireRecords() to drop it
+		return false;
+	};
+	// Entry found: Update timestamp and return
+	outPort = it->second->outPort;
+	it->second->last = Simulator::Now();
+	return true;
+}
+
+// Drop the table entries for the flows at the head of the expiry queue
+// whose lifetime has passed. An entry used since it was queued is queued
+// again instead, so each entry is in the queue exactly once.
+template <class Table>
+static void
+ExpireTable(Table& table, ExpiryQueue& queue, const Time& lifetime)
+{
+	Time now = Simulator::Now();
+	while (!queue.empty() && queue.front().first + lifetime < now) {
+		flowid fid = queue.front().second;
+		queue.pop_front();
+		typename Table::iterator it = table.find(fid);
+		NS_ASSERT(it != table.end());
+		if (it->second->last + lifetime < now) {
+			table.erase(it);
+		} else {
+			queue.push_back(std::make_pair(now, fid));
 		};
-		it++;
 	};
-	return false;
+}
+
+void
+HashRouting::ExpireRecords(void)
+{
+	ExpireTable(m_flowRouteTable, m_flowRouteExpiry, m_lifetime);
+	ExpireTable(m_congRecord, m_congRecordExpiry, m_lifetime);
 }
 
 bool
 HashRouting::NeedReroute(const flowid& fid, uint32_t cp)
 {
-	// Linear search the congestion record table
-	CongRecordTable::iterator i = m_congRecord.begin();
-	while (i != m_congRecord.end()) {
-		if ((*i)->last + m_lifetime < Simulator::Now()) {
-			// Erase expired entry
-			i = m_congRecord.erase(i);
-			continue;
-		};
-		if ((*i)->fid == fid) {
-			// If a record is found increase the count and check if
-			// threshold is met
-			(*i)->count++;
-			(*i)->last = Simulator::Now();
-			if (m_intelRR) (*i)->congPoints.insert(cp);
-			NS_LOG_INFO("Flow "<< fid <<" set with count "<< (*i)->count <<", thresh="<< m_rrThresh << ", CP=" << std::hex << cp << std::dec);
-			if ((*i)->count >= m_rrThresh) {
-				(*i)->count = 0;
-				return true;
-			} else {
-				return false;
-			};
+	ExpireRecords();
+	CongRecordTable::iterator i = m_congRecord.find(fid);
+	if (i != m_congRecord.end() && i->second->last + m_lifetime >= Simulator::Now()) {
+		// If a record is found increase the count and check if
+		// threshold is met
+		Ptr<CongRecord> rec = i->second;
+		rec->count++;
+		rec->last = Simulator::Now();
+		if (m_intelRR) rec->congPoints.insert(cp);
+		NS_LOG_INFO("Flow "<< fid <<" set with count "<< rec->count <<", thresh="<< m_rrThresh << ", CP=" << std::hex << cp << std::dec);
+		if (rec->count >= m_rrThresh) {
+			rec->count = 0;
+			return true;
+		} else {
+			return false;
 		};
-		i++;
 	};
 	NS_LOG_INFO("Flow "<< fid <<" not found. Create new record. CP=" << std::hex << cp << std::dec);
 	// The current flow is not on the congestion record table, add to it
 	Ptr<CongRecord> rec = Create<CongRecord>(fid, Simulator::Now(), 1);
 	if (m_intelRR) rec->congPoints.insert(cp);
-	m_congRecord.push_back(rec);
+	if (i == m_congRecord.end()) {
+		m_congRecord[fid] = rec;
+		m_congRecordExpiry.push_back(std::make_pair(Simulator::Now(), fid));
+	} else {
+		// Replace the expired record, which is already in the expiry queue
+		i->second = rec;
+	};
 	return false;
 }
 
@@ -465,25 +533,23 @@ HashRouting::Reroute(const flowid& fid, uint32_t oldPort)
 		//newPort = IntelRoute(fid, oldPort);
 	};
 
-	// Linear search for matching entry in m_flowRouteTable
-	FlowRouteTable::iterator it = m_flowRouteTable.begin();
-	while (it != m_flowRouteTable.end()) {
-		if ((*it)->last + m_lifetime < Simulator::Now()) {
-			// Erase expired entry
-			it = m_flowRouteTable.erase(it);
-			continue;
-		};
-		if (fid == (*it)->fid) {
-			// Entry found: Change output port
-			NS_LOG_INFO("Reroute flow " << fid << " from port " << oldPort << " to " << newPort);
-			(*it)->outPort = newPort;
-			return newPort;
-		};
-		it++;
+	ExpireRecords();
+	FlowRouteTable::iterator it = m_flowRouteTable.find(fid);
+	if (it != m_flowRouteTable.end() && it->second->last + m_lifetime >= Simulator::Now()) {
+		// Entry found: Change output port
+		NS_LOG_INFO("Reroute flow " << fid << " from port " << oldPort << " to " << newPort);
+		it->second->outPort = newPort;
+		return newPort;
 	};
-	// Linear search failed, the flow is not in the flow table, create new
+	// The flow is not in the flow table, create new
 	Ptr<FlowRoute> f = Create<FlowRoute>(fid, Simulator::Now(), newPort);
-	m_flowRouteTable.push_back(f);
+	if (it == m_flowRouteTable.end()) {
+		m_flowRouteTable[fid] = f;
+		m_flowRouteExpiry.push_back(std::make_pair(Simulator::Now(), fid));
+	} else {
+		// Replace the expired entry, which is already in the expiry queue
+		it->second = f;
+	};
 	NS_LOG_INFO("Reroute flow " << fid << " from port " << oldPort << " to " << newPort);
 	return newPort;
 };
@@ -21,6 +21,9 @@
 #define HASH_ROUTING_H
 
 #include <list>
+#include <vector>
+#include <deque>
+#include <utility>
 #include <set>
 #include <stdint.h>
 #include "ns3/ipv4-address.h"
@@ -29,6 +32,7 @@
 #include "ns3/simulator.h"
 #include "ns3/ipv4-routing-protocol.h"
 #include "ns3/ref-count-base.h"
+#include "ns3/sgi-hashmap.h"
 #include "fivetuple.h"
 #include "hash-function.h"
 
@@ -65,7 +69,7 @@ public:
   uint32_t outPort;
 };
 
-typedef std::list<Ptr<FlowRoute> > FlowRouteTable;
+typedef sgi::hash_map<flowid, Ptr<FlowRoute>, FlowIdHash> FlowRouteTable;
 
 // Congestion signal record
 class CongRecord : public RefCountBase
@@ -78,7 +82,11 @@ public:
   std::set<uint32_t> congPoints;
 };
 
-typedef std::list<Ptr<CongRecord> > CongRecordTable;
+typedef sgi::hash_map<flowid, Ptr<CongRecord>, FlowIdHash> CongRecordTable;
+
+// Flows in the order their table entries were created or last revisited by
+// the expiry sweep, used to drop expired entries without scanning the table
+typedef std::deque<std::pair<Time, flowid> > ExpiryQueue;
 
 // Class for hash-based routing logic
 class HashRouting : public Ipv4RoutingProtocol
@@ -96,10 +104,10 @@ public:
       const Ipv4Header &header, Ptr<const NetDevice> idev,
       UnicastForwardCallback ucb, MulticastForwardCallback mcb,
       LocalDeliverCallback lcb, ErrorCallback ecb);
-  virtual void NotifyInterfaceUp (uint32_t interface) {};
-  virtual void NotifyInterfaceDown (uint32_t interface) {};
-  virtual void NotifyAddAddress (uint32_t interface, Ipv4InterfaceAddress address) {};
-  virtual void NotifyRemoveAddress (uint32_t interface, Ipv4InterfaceAddress address) {};
+  virtual void NotifyInterfaceUp (uint32_t interface) { m_routeCache.clear(); };
+  virtual void NotifyInterfaceDown (uint32_t interface) { m_routeCache.clear(); };
+  virtual void NotifyAddAddress (uint32_t interface, Ipv4InterfaceAddress address) { m_routeCache.clear(); };
+  virtual void NotifyRemoveAddress (uint32_t interface, Ipv4InterfaceAddress address) { m_routeCache.clear(); };
   virtual void SetIpv4 (Ptr<Ipv4> ipv4);
 
   /**
@@ -114,6 +122,26 @@ public:
    */
   void AddRoute (const Ipv4Address& dest, const Ipv4Mask& mask, uint32_t interface);
 
+  // Role of a node in a fat tree addressed by FatTreeHelper::Create()
+  enum FatTreeRole { FAT_TREE_NONE, FAT_TREE_HOST, FAT_TREE_EDGE, FAT_TREE_AGGR, FAT_TREE_CORE };
+
+  /**
+   * \brief Route by decoding the fat-tree address plan instead of searching
+   * the destination-based routing table.
+   *
+   * The destination routes FatTreeHelper installs on a node only depend on
+   * its role, its subtree and its edge index, which are all encoded in the
+   * address bits.  Once set, RequestDestRoute() decodes the destination
+   * address into an output port in constant time.  A later AddRoute() call
+   * switches back to the table search.
+   *
+   * \param role The role of this node in the fat tree
+   * \param size The fat tree parameter N
+   * \param subtree The subtree of an edge or aggregation switch
+   * \param edge The index of an edge switch in its subtree
+   */
+  void SetFatTreePosition (FatTreeRole role, uint32_t size, uint32_t subtree = 0, uint32_t edge = 0);
+
   /**
    * \brief Set the hash function to be used in the hash-based routing
    *
@@ -127,6 +155,18 @@ protected:
   uint32_t Lookup (flowid fid);
   bool IsLocal (const Ipv4Address& dest);
 
+  /*
+   * \brief Get the route to send a packet out of the given port
+   *
+   * The route of each port is built once and reused for every packet, only
+   * its destination is updated, so forwarding does not allocate.
+   *
+   * \param port   Output port number
+   * \param dest   Destination of the packet
+   * \return The route through that port
+   */
+  Ptr<Ipv4Route> GetRoute(uint32_t port, const Ipv4Address& dest);
+
   /*
    * \brief Get the output port for the destination address
    *
@@ -185,6 +225,15 @@ protected:
    */
   uint32_t IntelRoute(const flowid& fid, uint32_t oldPort);
 
+  /*
+   * Remove the flow route and congestion records whose lifetime expired.
+   *
+   * Entries are also checked for expiry when they are looked up, so this
+   * only bounds the size of the tables. Each entry is revisited at most once
+   * per m_lifetime, which keeps the cost amortized O(1) per packet.
+   */
+  void ExpireRecords(void);
+
   /*
    * Clean up everything to make this object virtually dead
    */
@@ -193,8 +242,14 @@ protected:
   Ptr<HashFunction> m_hash;
 
   DestRouteTable m_destRouteTable;
+  FatTreeRole m_ftRole;     // Decode fat-tree addresses unless FAT_TREE_NONE
+  uint32_t m_ftSize;        // Fat tree parameter N
+  uint32_t m_ftPrefix;      // Address bits that must match for a down route
+  std::vector<Ptr<Ipv4Route> > m_routeCache;  // Route per output port
   FlowRouteTable m_flowRouteTable;
   CongRecordTable m_congRecord;
+  ExpiryQueue m_flowRouteExpiry;
+  ExpiryQueue m_congRecordExpiry;
 
   std::set<uint32_t> localAddrCache;
   
@@ -16,16 +16,15 @@
  * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
  */
 
-#include <iostream> //XXX
+#include <cstring>
+#include <limits>
 #include "ns3/log.h"
 #include "ns3/enum.h"
-#include "ns3/hash-function-impl.h"
 #include "ns3/uinteger.h"
 #include "ns3/ipv4-header.h"
 #include "ns3/ppp-header.h"
 #include "priority-queue.h"
 #include "priority-tag.h"
-#include "order-tag.h"
 
 NS_LOG_COMPONENT_DEFINE ("PriorityQueue");
 
@@ -33,96 +32,6 @@ namespace ns3 {
 
 NS_OBJECT_ENSURE_REGISTERED (PriorityQueue);
 
-#if 0
-class CompareIpTos : public Object, public std::less<Ptr<Packet> > {
-   public:
-      bool operator()(Ptr<Packet> x, Ptr<Packet> y) {
-        Ipv4Header xhdr, yhdr;
-        x->PeekHeader(xhdr);
-        y->PeekHeader(yhdr);
-        //if (xhdr.GetProtocol()
-        //XXX: Do better than this....
-#if 0
-        if (xhdr.GetProtocol() != 6 || yhdr.GetProtocol() != 6)
-          {
-            NS_LOG_ERROR("Non-IP traffic in Priority Queue");
-            return true;
-          }
-#endif
-        return xhdr.GetTos () < yhdr.GetTos ();
-      }
-} compareIpTos;
-#endif 
-
-#if 0
-/* Asks the question: "Is x less than y?" */
-bool
-ComparePriorityTag::operator()(Ptr<Packet> x, Ptr<Packet> y) const
-{
-        PriorityTag xtag, ytag;
-        OrderTag xOtag, yOtag;
-        bool xfound = x->PeekPacketTag (xtag);
-        bool yfound = y->PeekPacketTag (ytag);
-        if (xfound == false || yfound == false)
-          {
-            //NS_LOG_UNCOND ("Non-Priority-Tag traffic in ComparePriorityTag");
-            NS_LOG_INFO ("Non-Priority-Tag traffic in ComparePriorityTag");
-          }
-        bool xOfound = x->PeekPacketTag (xOtag);
-        bool yOfound = y->PeekPacketTag (yOtag);
-        NS_ASSERT (xOfound && yOfound);
-#if 0
-        else
-          {
-            NS_LOG_INFO ("Priority-Tags found");
-          }
-#endif
-
-        if (xfound == false && yfound == false) {
-            // Lower order is higher priority, so x is less if the priority is greater
-            return xOtag.GetOrder () > yOtag.GetOrder ();
-        } else if (xfound == false) {
-            return false; //No priority is highest priority so x is greater
-        } else if (yfound == false) {
-            return true; //No priority is highest priority so x is less
-        } else if (xtag.GetPriority () == ytag.GetPriority ()) {
-            // Lower time is higher priority, so x is less if the priority is greater
-            //NS_LOG_UNCOND ("CmpPri: xtime=" << xtag.GetTime () << ", ytime=" << ytag.GetTime ());
-            //if (xtag.GetTime () == ytag.GetTime ())
-                //NS_LOG_UNCOND ("x and y times are the same!");
-            return xOtag.GetOrder () > yOtag.GetOrder ();
-        } else {
-            // Lower number is higher priority, so x is less if the priority is greater
-            return xtag.GetPriority () > ytag.GetPriority ();
-        }
-}
-//ComparePriorityTag comparePriorityTag;
-#endif
-
-/* Asks the question: "Is x less than y?" */
-bool
-ComparePriorityTag::operator()(Ptr<Packet> const x, Ptr<Packet> const y)
-{
-        GetFlowId gettor;
-        flowid xid = gettor (x);
-        flowid yid = gettor (y);
-        double xpri = m_priTable[xid];
-        double ypri = m_priTable[yid];
-
-        OrderTag xOtag, yOtag;
-        bool xOfound = x->PeekPacketTag (xOtag);
-        bool yOfound = y->PeekPacketTag (yOtag);
-        NS_ASSERT (xOfound && yOfound);
-
-        if (xpri == ypri) {
-            // Lower time is higher priority, so x is less if the priority is greater
-            return xOtag.GetOrder () > yOtag.GetOrder ();
-        } else {
-            // Lower number is higher priority, so x is less if the priority is greater
-            return xpri > ypri;
-        }
-}
-
 TypeId PriorityQueue::GetTypeId (void) 
 {
   static TypeId tid = TypeId ("ns3::PriorityQueue")
@@ -140,9 +49,6 @@ TypeId PriorityQueue::GetTypeId (void)
 
 PriorityQueue::PriorityQueue () :
   Queue (),
-  m_container (),
-  m_compare (),
-  m_packets (m_container, m_compare),
   m_bytesInQueue (0),
   m_numPackets (0)
 {
@@ -154,6 +60,134 @@ PriorityQueue::~PriorityQueue ()
   NS_LOG_FUNCTION_NOARGS ();
 }
 
+/*
+ * Map a priority onto an unsigned integer with the same ordering, so that
+ * the heaps only ever compare integers.  Positive doubles already order
+ * like their bit patterns once the sign bit is set; negative ones order in
+ * reverse and are complemented.
+ */
+uint64_t
+PriorityQueue::RankKey (double priority)
+{
+  uint64_t bits;
+  std::memcpy (&bits, &priority, sizeof (bits));
+  const uint64_t sign = static_cast<uint64_t> (1) << 63;
+  return (bits & sign) ? ~bits : (bits | sign);
+}
+
+uint32_t
+PriorityQueue::AllocFlow (const flowid &id)
+{
+  uint32_t f;
+  if (m_freeFlows.empty ())
+    {
+      f = m_flows.size ();
+      m_flows.push_back (FlowQueue ());
+    }
+  else
+    {
+      f = m_freeFlows.back ();
+      m_freeFlows.pop_back ();
+    }
+  m_flows[f].id = id;
+  m_flowIndex[id] = f;
+  return f;
+}
+
+void
+PriorityQueue::ReleaseFlow (uint32_t f)
+{
+  NS_ASSERT (m_flows[f].packets.empty ());
+  HeapRemove (false, f);
+  HeapRemove (true, f);
+  m_flowIndex.erase (m_flows[f].id);
+  m_freeFlows.push_back (f);
+}
+
+/*
+ * The head heap orders flows by (rank, order of the head packet), smallest
+ * first: its root holds the next packet to send.  The tail heap orders flows
+ * by (rank, order of the tail packet), largest first: its root holds the next
+ * packet to drop.
+ */
+bool
+PriorityQueue::Before (bool tail, uint32_t a, uint32_t b) const
+{
+  const FlowQueue &x = m_flows[a];
+  const FlowQueue &y = m_flows[b];
+  if (x.rank != y.rank)
+    {
+      return tail ? x.rank > y.rank : x.rank < y.rank;
+    }
+  if (tail)
+    {
+      return x.packets.back ().order > y.packets.back ().order;
+    }
+  return x.packets.front ().order < y.packets.front ().order;
+}
+
+void
+PriorityQueue::HeapFix (bool tail, uint32_t i)
+{
+  std::vector<uint32_t> &heap = tail ? m_tailHeap : m_headHeap;
+  uint32_t f = heap[i];
+  while (i > 0)
+    {
+      uint32_t parent = (i - 1) / 2;
+      if (!Before (tail, f, heap[parent]))
+        {
+          break;
+        }
+      heap[i] = heap[parent];
+      HeapPos (tail, heap[i]) = i;
+      i = parent;
+    }
+  uint32_t n = heap.size ();
+  while (true)
+    {
+      uint32_t child = 2 * i + 1;
+      if (child >= n)
+        {
+          break;
+        }
+      if (child + 1 < n && Before (tail, heap[child + 1], heap[child]))
+        {
+          child++;
+        }
+      if (!Before (tail, heap[child], f))
+        {
+          break;
+        }
+      heap[i] = heap[child];
+      HeapPos (tail, heap[i]) = i;
+      i = child;
+    }
+  heap[i] = f;
+  HeapPos (tail, f) = i;
+}
+
+void
+PriorityQueue::HeapInsert (bool tail, uint32_t f)
+{
+  std::vector<uint32_t> &heap = tail ? m_tailHeap : m_headHeap;
+  heap.push_back (f);
+  HeapFix (tail, heap.size () - 1);
+}
+
+void
+PriorityQueue::HeapRemove (bool tail, uint32_t f)
+{
+  std::vector<uint32_t> &heap = tail ? m_tailHeap : m_headHeap;
+  uint32_t i = HeapPos (tail, f);
+  uint32_t last = heap.back ();
+  heap.pop_back ();
+  if (last != f)
+    {
+      heap[i] = last;
+      HeapFix (tail, i);
+    }
+}
+
 //TODO: Data with no priority (ACKs) should be still transmitted in FIFO order
 bool 
 PriorityQueue::DoEnqueue (Ptr<Packet> p)
@@ -164,31 +198,54 @@ PriorityQueue::DoEnqueue (Ptr<Packet> p)
   m_numPackets++;
   NS_ASSERT (m_numPackets != std::numeric_limits<uint64_t>::max ());
 
-  /* Assign an order to the packet */
-  OrderTag otag;
-  bool found = p->PeekPacketTag (otag);
-  NS_ASSERT (!found);
-  otag.SetOrder (m_numPackets);
-  p->AddPacketTag (otag);
-
-  /* Update the priority for the flow */
+  /* Find the flow and update its priority */
   PriorityTag ptag;
-  found = p->PeekPacketTag (ptag);
+  bool found = p->PeekPacketTag (ptag);
   double priority = (found) ? ptag.GetPriority () : 0;
   GetFlowId gettor;
   flowid tuple = gettor (p);
-  m_flowPri[tuple] = priority;
-  m_compare.SetPriTable (m_flowPri);
+
+  Entry e;
+  e.packet = p;
+  e.order = m_numPackets;
+
+  FlowIndex::iterator it = m_flowIndex.find (tuple);
+  if (it == m_flowIndex.end ())
+    {
+      uint32_t f = AllocFlow (tuple);
+      m_flows[f].rank = RankKey (priority);
+      m_flows[f].packets.push_back (e);
+      HeapInsert (false, f);
+      HeapInsert (true, f);
+    }
+  else
+    {
+      FlowQueue &flow = m_flows[it->second];
+      flow.rank = RankKey (priority);
+      flow.packets.push_back (e);
+      HeapFix (false, flow.headPos);
+      HeapFix (true, flow.tailPos);
+    }
 
   /* Enqueue the packet */
   m_bytesInQueue += p->GetSize ();
-  m_packets.push(p);
 
   /* Drop packets until we are at the max size */
   while (m_bytesInQueue > m_maxBytes)
     {
       NS_LOG_LOGIC ("Queue full (packet exceeded max bytes) -- droppping pkt");
-      Ptr<Packet> toDrop = m_packets.popMin ();
+      uint32_t f = m_tailHeap.front ();
+      FlowQueue &flow = m_flows[f];
+      Ptr<Packet> toDrop = flow.packets.back ().packet;
+      flow.packets.pop_back ();
+      if (flow.packets.empty ())
+        {
+          ReleaseFlow (f);
+        }
+      else
+        {
+          HeapFix (true, 0);
+        }
       uint32_t size = toDrop->GetSize ();
       Drop (toDrop);
       m_bytesInQueue -= size;
@@ -201,10 +258,6 @@ PriorityQueue::DoEnqueue (Ptr<Packet> p)
        */
       m_nBytes -= size;
       m_nPackets--;
-
-      //XXX: Debugging
-      PriorityTag priTag;
-
     }
 
   NS_LOG_LOGIC ("Number bytes " << m_bytesInQueue);
@@ -221,53 +274,30 @@ PriorityQueue::DoDequeue (void)
 {
   NS_LOG_FUNCTION (this);
 
-  if (m_packets.empty ())
+  if (m_headHeap.empty ())
     {
       NS_LOG_LOGIC ("Queue empty");
       return 0;
     }
 
-  //XXX
-  std::ostringstream oss;
-  Ptr<Packet> min = m_packets.findMin ();
-  PriorityTag minTag;
-  if (min->PeekPacketTag (minTag))
+  uint32_t f = m_headHeap.front ();
+  FlowQueue &flow = m_flows[f];
+  Ptr<Packet> p = flow.packets.front ().packet;
+  NS_LOG_LOGIC ("dequeue flow " << flow.id << " order: " << flow.packets.front ().order);
+  flow.packets.pop_front ();
+  if (flow.packets.empty ())
     {
-      oss << "Min pri: " << minTag.GetPriority ();
+      ReleaseFlow (f);
     }
   else
     {
-      oss << "Min packet with no priority: ";
+      HeapFix (false, 0);
     }
-  NS_LOG_LOGIC (oss.str ());
-
-  Ptr<Packet> p = m_packets.pop ();
   m_bytesInQueue -= p->GetSize ();
 
-  OrderTag otag;
-  p->RemovePacketTag (otag);
-  NS_LOG_LOGIC ("dequeue order: " << otag.GetOrder ());
-
-  //XXX
-  PriorityTag tag;
-  oss.str ("");
-  if (p->PeekPacketTag (tag))
-    {
-      oss << "dequeue pri: " << tag.GetPriority ();
-    }
-  else
-    {
-      oss << "Packet with no priority: ";
-    }
-  NS_LOG_LOGIC (oss.str ());
-
-  //GetFlowId gettor;
-  //flowid fid = gettor (p);
-  //NS_LOG_UNCOND (this << "Dequeued packet w/ pri: " << tag.GetPriority () << " (real pri: " << m_flowPri[fid] << ") and order: " << otag.GetOrder ());
-
   NS_LOG_LOGIC ("Popped " << p);
 
-  NS_LOG_LOGIC ("Number packets " << m_packets.size ());
+  NS_LOG_LOGIC ("Number flows " << m_headHeap.size ());
   NS_LOG_LOGIC ("Number bytes " << m_bytesInQueue);
 
   return p;
@@ -278,15 +308,15 @@ PriorityQueue::DoPeek (void) const
 {
   NS_LOG_FUNCTION (this);
 
-  if (m_packets.empty ())
+  if (m_headHeap.empty ())
     {
       NS_LOG_LOGIC ("Queue empty");
       return 0;
     }
 
-  Ptr<Packet> p = m_packets.findMax ();
+  Ptr<Packet> p = m_flows[m_headHeap.front ()].packets.front ().packet;
 
-  NS_LOG_LOGIC ("Number packets " << m_packets.size ());
+  NS_LOG_LOGIC ("Number flows " << m_headHeap.size ());
   NS_LOG_LOGIC ("Number bytes " << m_bytesInQueue);
 
   return p;
@@ -295,16 +325,8 @@ PriorityQueue::DoPeek (void) const
 flowid GetFlowId::operator() (Ptr<Packet> const &p)
 {
   //XXX: assumes that the first header is always a point-to-point header
-  PppHeader ppph;
-  Ptr<Packet> q = p->Copy();
-  q->RemoveHeader (ppph);
-  return flowid (q);
-}
-
-size_t FlowIdHash::operator() (flowid const &x) const
-{ 
-  HashHsieh hash;
-  return hash (0, x);
+  static const uint32_t pppHeaderSize = PppHeader ().GetSerializedSize ();
+  return flowid (p, pppHeaderSize);
 }
 
 } // namespace ns3
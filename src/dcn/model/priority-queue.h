@@ -20,11 +20,11 @@
 #define PRIORITY_QUEUE_H
 
 #include <string>
-#include <queue>
+#include <deque>
+#include <vector>
 #include "ns3/fivetuple.h"
 #include "ns3/packet.h"
 #include "ns3/queue.h"
-#include "ns3/MinMaxHeap.h"
 #include "ns3/sgi-hashmap.h"
 
 namespace ns3 {
@@ -35,25 +35,23 @@ public:
   flowid operator() (Ptr<Packet> const &p);
 };
 
-class FlowIdHash : public std::unary_function<flowid, size_t> {
-public:
-  size_t operator() (flowid const &x) const;
-};
-
 class TraceContainer;
 
-class ComparePriorityTag : public Object {
-   public:
-      bool operator()(Ptr<Packet> const x, Ptr<Packet> const y);
-      void SetPriTable (sgi::hash_map<flowid, double, FlowIdHash>& priTable) { m_priTable = priTable; };
-    private:
-      sgi::hash_map<flowid, double, FlowIdHash> m_priTable;
-};
-
 /**
  * \ingroup queue
  *
- * \brief A FIFO packet queue that drops tail-end packets on overflow
+ * \brief A pFabric-style priority queue.
+ *
+ * Every packet takes the most recent priority seen for its flow, lower
+ * values being served first; ties are broken by arrival order.  When the
+ * queue overflows, the packet with the worst (rank, order) key is dropped.
+ *
+ * Queued packets are kept per flow in FIFO order.  Each flow with queued
+ * packets sits in two indexed heaps: one keyed by (rank, order of the head
+ * packet) to select the next packet to send, and one keyed by (rank, order
+ * of the tail packet) to select the next packet to drop.  A flow rank update
+ * only re-sifts that flow, so the cost of every operation depends on the
+ * number of queued flows and never on the number of flows ever seen.
  */
 class PriorityQueue : public Queue {
 public:
@@ -68,16 +66,46 @@ private:
   virtual Ptr<Packet> DoDequeue (void);
   virtual Ptr<const Packet> DoPeek (void) const;
 
-  //TODO: Specify the Compare function
-  std::vector<Ptr<Packet> > m_container;
-  ComparePriorityTag m_compare;
-  MinMaxHeap<Ptr<Packet>, std::vector<Ptr<Packet> >, ComparePriorityTag> m_packets;
+  struct Entry
+  {
+    Ptr<Packet> packet;
+    uint64_t order;
+  };
+
+  struct FlowQueue
+  {
+    flowid id;
+    uint64_t rank;            //!< Order-preserving integer image of the flow priority
+    std::deque<Entry> packets;
+    uint32_t headPos;         //!< Position in m_headHeap
+    uint32_t tailPos;         //!< Position in m_tailHeap
+  };
+
+  static uint64_t RankKey (double priority);
+
+  uint32_t AllocFlow (const flowid &id);
+  void ReleaseFlow (uint32_t f);
+
+  bool Before (bool tail, uint32_t a, uint32_t b) const;
+  uint32_t &HeapPos (bool tail, uint32_t f)
+  {
+    return tail ? m_flows[f].tailPos : m_flows[f].headPos;
+  }
+  void HeapFix (bool tail, uint32_t pos);
+  void HeapInsert (bool tail, uint32_t f);
+  void HeapRemove (bool tail, uint32_t f);
+
   uint32_t m_maxBytes;
   uint32_t m_bytesInQueue;
   uint64_t m_numPackets;
 
-  typedef sgi::hash_map<flowid, double, FlowIdHash> FlowPriorities;
-  FlowPriorities m_flowPri;
+  std::vector<FlowQueue> m_flows;     //!< Flow slots, reused through m_freeFlows
+  std::vector<uint32_t> m_freeFlows;
+  std::vector<uint32_t> m_headHeap;   //!< Min-heap of flow slots on (rank, head order)
+  std::vector<uint32_t> m_tailHeap;   //!< Max-heap of flow slots on (rank, tail order)
+
+  typedef sgi::hash_map<flowid, uint32_t, FlowIdHash> FlowIndex;
+  FlowIndex m_flowIndex;              //!< Flows with queued packets -> slot in m_flows
 };
 
 } // namespace ns3
@@ -21,6 +21,7 @@
 
 #define __STDC_LIMIT_MACROS 1
 #include <stdint.h>
+#include <algorithm>
 #include "ns3/qbb-net-device.h"
 //#include "md5sum.h"
 extern "C" {
@@ -30,22 +31,46 @@ extern "C" {
 #include "ns3/abort.h"
 #include "ns3/boolean.h"
 #include "ns3/uinteger.h"
+#include "ns3/double.h"
+#include "ns3/enum.h"
 #include "ns3/object-vector.h"
-#include "ns3/pause-header.h"
 #include "ns3/infinite-queue.h"
 #include "ns3/infinite-simple-red-ecn-queue.h"
 #include "ns3/drop-tail-queue.h"
 #include "ns3/assert.h"
-#include "ns3/ipv4.h"
 #include "ns3/simulator.h"
 #include "ns3/point-to-point-channel.h"
-#include "ns3/random-variable.h"
 #include "ns3/flow-id-tag.h"
+#include "ns3/priority-tag.h"
 
 NS_LOG_COMPONENT_DEFINE ("QbbNetDevice");
 
 namespace ns3 {
 
+// An 802.1Qbb PAUSE is a minimum size Ethernet MAC control frame
+static const uint32_t pauseFrameSize = 64;
+
+/*
+ * The bytes of a PAUSE frame for the trace sources: the PFC opcode, one
+ * class enabled, and its pause time. The time is in microseconds rather
+ * than in quanta, and the FCS is left blank.
+ */
+static Ptr<Packet>
+PauseFrame (Mac48Address src, unsigned qIndex, uint32_t time)
+{
+	uint8_t frame[pauseFrameSize] = { 0x01, 0x80, 0xc2, 0x00, 0x00, 0x01 };
+	src.CopyTo (frame + 6);
+	frame[12] = 0x88;	// MAC control EtherType
+	frame[13] = 0x08;
+	frame[14] = 0x01;	// PFC opcode
+	frame[15] = 0x01;
+	frame[17] = 1u << qIndex;	// Class-enable vector
+	uint16_t quanta = std::min<uint32_t> (time, 0xffff);
+	frame[18 + 2 * qIndex] = quanta >> 8;
+	frame[19 + 2 * qIndex] = quanta & 0xff;
+	return Create<Packet> (frame, pauseFrameSize);
+}
+
 NS_OBJECT_ENSURE_REGISTERED (QbbNetDevice);
 
 TypeId 
@@ -60,10 +85,50 @@ QbbNetDevice::GetTypeId (void)
 			MakeBooleanAccessor (&QbbNetDevice::m_qbbEnabled),
 			MakeBooleanChecker ())
 	 .AddAttribute ("QbbThreshold",
-			"Threshold of number of bytes in queue to send PAUSE.",
+			"Bytes received on a port in a class, and still queued in the node, above which the class is paused.",
 			UintegerValue (1e6),
 			MakeUintegerAccessor (&QbbNetDevice::m_threshold),
 			MakeUintegerChecker<uint32_t> ())
+	 .AddAttribute ("QbbResumeOffset",
+			"Bytes below the PAUSE threshold at which a paused class is resumed with XON.",
+			UintegerValue (3000),
+			MakeUintegerAccessor (&QbbNetDevice::m_resumeOffset),
+			MakeUintegerChecker<uint32_t> ())
+	 .AddAttribute ("QbbHeadroom",
+			"Bytes a class may receive on a port above its QbbThreshold before dropping. Zero disables the limit.",
+			UintegerValue (0),
+			MakeUintegerAccessor (&QbbNetDevice::m_headroom),
+			MakeUintegerChecker<uint32_t> ())
+	 .AddAttribute ("Classifier",
+			"How packets are mapped to priority classes.",
+			EnumValue (CLASSIFY_NONE),
+			MakeEnumAccessor (&QbbNetDevice::m_classifier),
+			MakeEnumChecker (CLASSIFY_NONE, "None",
+					 CLASSIFY_TOS, "Tos",
+					 CLASSIFY_PRIORITY_TAG, "PriorityTag"))
+	 .AddAttribute ("PriorityTagBase",
+			"Remaining bytes mapped to the highest class by the PriorityTag classifier. Each lower class covers twice the range.",
+			DoubleValue (10240),
+			MakeDoubleAccessor (&QbbNetDevice::m_priorityBase),
+			MakeDoubleChecker<double> (1))
+	 .AddAttribute ("Scheduler",
+			"Scheduler across priority classes.",
+			EnumValue (SCHED_ROUND_ROBIN),
+			MakeEnumAccessor (&QbbNetDevice::m_scheduler),
+			MakeEnumChecker (SCHED_ROUND_ROBIN, "RoundRobin",
+					 SCHED_STRICT, "StrictPriority",
+					 SCHED_DWRR, "Dwrr"))
+	 .AddAttribute ("DwrrQuantum",
+			"Bytes credited to a class on each DWRR round.",
+			UintegerValue (1500),
+			MakeUintegerAccessor (&QbbNetDevice::m_quantum),
+			MakeUintegerChecker<uint32_t> (1))
+	 .AddAttribute ("TxWakeup",
+			"Order in which senders blocked on the Tx buffer are woken.",
+			EnumValue (TX_WAKEUP_FIFO),
+			MakeEnumAccessor (&QbbNetDevice::m_txWakeup),
+			MakeEnumChecker (TX_WAKEUP_FIFO, "Fifo",
+					 TX_WAKEUP_WEIGHTED, "Weighted"))
 	 .AddAttribute ("PauseTime",
 			"Number of microseconds to pause upon congestion",
 			UintegerValue (100),
@@ -79,7 +144,7 @@ QbbNetDevice::GetTypeId (void)
 }
 
 
-QbbNetDevice::QbbNetDevice () : m_bufferUsage(0), m_lastQ(qCnt-1)
+QbbNetDevice::QbbNetDevice () : m_bufferUsage(0), m_pausedMask(0), m_nonEmptyMask(0), m_lastQ(qCnt-1), m_pauseSentMask(0), m_txWaitClock(0), m_txWaitMask(0)
 {
 	NS_LOG_FUNCTION (this);
 
@@ -87,8 +152,14 @@ QbbNetDevice::QbbNetDevice () : m_bufferUsage(0), m_lastQ(qCnt-1)
 	for (unsigned i=0; i<qCnt; i++) {
 		m_queues.push_back( CreateObject<InfiniteQueue>() );
 //		m_queues.push_back( CreateObject<DropTailQueue>() );
-		m_paused[i] = false;
+		m_classThreshold[i] = 0;
+		m_classHeadroom[i] = 0;
+		m_classQuantum[i] = 0;
+		m_deficit[i] = 0;
+		m_ingressBytes[i] = 0;
+		m_txWaitCount[i] = 0;
 	};
+	m_earliestResume = Simulator::GetMaximumSimulationTime ();
 }
 
 QbbNetDevice::~QbbNetDevice ()
@@ -122,11 +193,18 @@ QbbNetDevice::DoDispose()
 {
 	NS_LOG_FUNCTION(this);
 	// Cancel all the Qbb events
+	Simulator::Cancel(m_resumeEvt);
+	Simulator::Cancel(m_refreshEvt);
 	for (unsigned i=0; i<qCnt; i++) {
-		Simulator::Cancel(m_resumeEvt[i]);
-		Simulator::Cancel(m_recheckEvt[i]);
+		m_ingress[i].clear();
 	};
 	m_queues.clear();
+	m_sharedBuffer = 0;
+	m_txWaiters.clear();
+	for (unsigned i=0; i<qCnt; i++) {
+		m_txWaitCount[i] = 0;
+	};
+	m_txWaitMask = 0;
 	PointToPointNetDevice::DoDispose ();
 }
 
@@ -149,11 +227,134 @@ uint32_t
 QbbNetDevice::GetTxAvailable () const
 {
 	//return (m_bufferUsage > m_buffersize) ? 0 : (m_buffersize - m_bufferUsage);
-        unsigned qIndex = 0; //XXX: Hack
-        uint32_t nbytes = m_queues[qIndex]->GetNBytes ();
-        return (nbytes > m_threshold) ? 0 : (m_threshold - nbytes);
+	// Unclassified traffic is carried in class 0
+	return GetTxAvailable (0u);
 };
 
+uint32_t
+QbbNetDevice::GetTxAvailable (Ptr<const Packet> probe) const
+{
+	return GetTxAvailable (Classify (probe));
+};
+
+uint32_t
+QbbNetDevice::GetTxAvailable (unsigned qIndex) const
+{
+	NS_ASSERT (qIndex < qCnt);
+	uint32_t nbytes = m_queues[qIndex]->GetNBytes ();
+	uint32_t threshold = GetClassThreshold (qIndex);
+	return (nbytes > threshold) ? 0 : (threshold - nbytes);
+};
+
+void
+QbbNetDevice::SetClassThreshold (unsigned qIndex, uint32_t bytes)
+{
+	NS_ASSERT (qIndex < qCnt);
+	m_classThreshold[qIndex] = bytes;
+}
+
+void
+QbbNetDevice::SetClassHeadroom (unsigned qIndex, uint32_t bytes)
+{
+	NS_ASSERT (qIndex < qCnt);
+	m_classHeadroom[qIndex] = bytes;
+}
+
+void
+QbbNetDevice::SetClassQuantum (unsigned qIndex, uint32_t bytes)
+{
+	NS_ASSERT (qIndex < qCnt);
+	m_classQuantum[qIndex] = bytes;
+}
+
+uint32_t
+QbbNetDevice::GetClassThreshold (unsigned qIndex) const
+{
+	return m_classThreshold[qIndex] ? m_classThreshold[qIndex] : m_threshold;
+}
+
+uint32_t
+QbbNetDevice::GetClassHeadroom (unsigned qIndex) const
+{
+	return m_classHeadroom[qIndex] ? m_classHeadroom[qIndex] : m_headroom;
+}
+
+uint32_t
+QbbNetDevice::GetClassQuantum (unsigned qIndex) const
+{
+	return m_classQuantum[qIndex] ? m_classQuantum[qIndex] : m_quantum;
+}
+
+unsigned
+QbbNetDevice::Classify (Ptr<const Packet> p) const
+{
+	switch (m_classifier) {
+	case CLASSIFY_TOS:
+		// IP precedence maps one-to-one onto the 802.1p priority code point.
+		// The TOS is the second byte of the IPv4 header.
+		return (p->GetSize () < 2) ? 0 : p->PeekU8 (1) >> 5;
+	case CLASSIFY_PRIORITY_TAG:
+		{
+			PriorityTag t;
+			if (!p->PeekPacketTag (t) || t.GetPriority () < 0) return 0;
+			// Halve the urgency for every doubling of the remaining bytes
+			unsigned qIndex = qCnt - 1;
+			double limit = m_priorityBase;
+			while (qIndex > 0 && t.GetPriority () >= limit) {
+				--qIndex;
+				limit *= 2;
+			};
+			return qIndex;
+		}
+	default:
+		return 0;
+	};
+}
+
+uint32_t
+QbbNetDevice::GetEligibleMask (void) const
+{
+	return m_qbbEnabled ? (m_nonEmptyMask & ~m_pausedMask) : m_nonEmptyMask;
+}
+
+unsigned
+QbbNetDevice::NextSet (uint32_t mask, unsigned qIndex)
+{
+	// Rotate so that bit qIndex lands on bit 0, then find the first set bit
+	NS_ASSERT (mask != 0 && qIndex < qCnt);
+	uint32_t rotated = ((mask >> qIndex) | (mask << (qCnt - qIndex))) & ((1u << qCnt) - 1);
+	qIndex += __builtin_ctz (rotated);
+	return (qIndex >= qCnt) ? qIndex - qCnt : qIndex;
+}
+
+unsigned
+QbbNetDevice::SelectQueue (void)
+{
+	uint32_t eligible = GetEligibleMask ();
+	if (eligible == 0) return qCnt;
+
+	unsigned qIndex = m_lastQ;
+	switch (m_scheduler) {
+	case SCHED_STRICT:
+		return 31 - __builtin_clz (eligible);
+	case SCHED_DWRR:
+		// Keep serving the current class while its deficit covers the head
+		// packet, otherwise credit the next active class with its quantum.
+		// This terminates because every active class gains a non-zero
+		// quantum per round.
+		if ((eligible & (1u << qIndex)) && m_deficit[qIndex] >= m_queues[qIndex]->Peek ()->GetSize ()) {
+			return qIndex;
+		};
+		for (;;) {
+			qIndex = NextSet (eligible, (qIndex + 1) % qCnt);
+			m_deficit[qIndex] += GetClassQuantum (qIndex);
+			if (m_deficit[qIndex] >= m_queues[qIndex]->Peek ()->GetSize ()) return qIndex;
+		};
+	default:
+		return NextSet (eligible, (qIndex + 1) % qCnt);
+	};
+}
+
 void
 QbbNetDevice::DequeueAndTransmit (void)
 {
@@ -162,94 +363,117 @@ QbbNetDevice::DequeueAndTransmit (void)
 	// Quit if channel busy
 	if (m_txMachineState == BUSY) return;
 
-	bool empty = true;
-
-	// Look for a packet in a round robin
-	unsigned qIndex = m_lastQ;
-	for (unsigned i=0; i<qCnt; i++) {
-		if (++qIndex >= qCnt) qIndex = 0;
-		if (m_queues[qIndex]->GetNPackets()) empty = false;
-		if (m_paused[qIndex] && m_qbbEnabled) continue;
+	if (m_pausedMask && Simulator::Now() >= m_earliestResume) ExpirePauses();
+	unsigned qIndex = SelectQueue ();
+	if (qIndex < qCnt) {
 		Ptr<Packet> p = m_queues[qIndex]->Dequeue();
-		if (p != 0) {
-			NS_LOG_INFO("Dequeue from queue " << qIndex << ", now has len=" << m_queues[qIndex]->GetNPackets());
-			m_snifferTrace (p);
-			m_promiscSnifferTrace (p);
-			TransmitStart(p);
-			m_lastQ = qIndex;
-			m_bufferUsage -= p->GetSize();
-                        uint32_t avail = GetTxAvailable ();
-			NS_LOG_INFO("Current TxAvailable=" << avail);
-			if (avail) m_sendCb(this, avail);
-			return;
+		Ptr<QbbNetDevice> ingress = m_ingress[qIndex].front();
+		m_ingress[qIndex].pop_front();
+		NS_LOG_INFO("Dequeue from queue " << qIndex << ", now has len=" << m_queues[qIndex]->GetNPackets());
+		if (m_queues[qIndex]->IsEmpty ()) {
+			m_nonEmptyMask &= ~(1u << qIndex);
+			m_deficit[qIndex] = 0;
+		} else if (m_scheduler == SCHED_DWRR) {
+			m_deficit[qIndex] -= p->GetSize();
 		};
+		m_snifferTrace (p);
+		m_promiscSnifferTrace (p);
+		TransmitStart(p);
+		m_lastQ = qIndex;
+		m_bufferUsage -= p->GetSize();
+		if (ingress != 0) ingress->IngressRemove(qIndex, p->GetSize());
+		if (!m_txWaiters.empty()) WakeTxWaiters();
+		return;
 	};
 
-	// No queue can deliver any packet, so we just exit
-	if (! empty) {
+	// No queue can deliver any packet, so wake up when the earliest pause
+	// on a backlogged queue runs out
+	uint32_t blocked = m_nonEmptyMask & m_pausedMask;
+	if (blocked && m_qbbEnabled) {
 		NS_LOG_INFO("PAUSE prohibits send at node " << m_node->GetId());
 		//PrintStatus(std::clog);
+		Time wake = m_pausedUntil[NextSet (blocked, 0)];
+		for (unsigned i=0; i<qCnt; i++) {
+			if ((blocked & (1u << i)) && m_pausedUntil[i] < wake) wake = m_pausedUntil[i];
+		};
+		// A pending wake-up that is not later is good enough; one that
+		// turns out early finds the queue still paused and comes back here
+		if (!m_resumeEvt.IsRunning() || m_resumeAt > wake) {
+			Simulator::Cancel(m_resumeEvt);
+			m_resumeAt = wake;
+			m_resumeEvt = Simulator::Schedule(wake - Simulator::Now(),
+					&QbbNetDevice::PauseFinish, this);
+		};
 	};
 	return;
 }
 
+void
+QbbNetDevice::ExpirePauses (void)
+{
+	Time now = Simulator::Now();
+	m_earliestResume = Simulator::GetMaximumSimulationTime ();
+	for (unsigned i=0; i<qCnt; i++) {
+		if (!(m_pausedMask & (1u << i))) continue;
+		if (m_pausedUntil[i] <= now) {
+			m_pausedMask &= ~(1u << i);
+			NS_LOG_INFO("Node "<< m_node->GetId() <<" dev "<< m_ifIndex <<" queue "<< i <<
+					" resumed at "<< now.GetSeconds());
+		} else if (m_pausedUntil[i] < m_earliestResume) {
+			m_earliestResume = m_pausedUntil[i];
+		};
+	};
+}
+
 void
 QbbNetDevice::Resume (unsigned qIndex)
 {
 	NS_LOG_FUNCTION(this << qIndex);
-	NS_ASSERT_MSG(m_paused[qIndex], "Must be PAUSEd");
-	m_paused[qIndex] = false;
+	NS_ASSERT_MSG(m_pausedMask & (1u << qIndex), "Must be PAUSEd");
+	m_pausedMask &= ~(1u << qIndex);
+	m_pausedUntil[qIndex] = Simulator::Now();
 	NS_LOG_INFO("Node "<< m_node->GetId() <<" dev "<< m_ifIndex <<" queue "<< qIndex <<
 			" resumed at "<< Simulator::Now().GetSeconds());
 	DequeueAndTransmit();
 }
 
 void
-QbbNetDevice::PauseFinish(unsigned qIndex)
+QbbNetDevice::PauseFinish(void)
 {
-	// Wrapper to Resume() so that it can be overloaded without
-	// interfering with the Scheduler hook
-	Resume(qIndex);
+	// Expired pauses are cleared lazily by DequeueAndTransmit()
+	DequeueAndTransmit();
 }
 
 void
 QbbNetDevice::Receive (Ptr<Packet> packet)
 {
 	NS_LOG_FUNCTION (this << packet);
-	uint16_t protocol = 0;
-
-	Ptr<Packet> p = packet->Copy();
-	ProcessHeader(p, protocol);
-	Ipv4Header ipv4h;
-	p->PeekHeader(ipv4h);
-
-	// If this is a Pause, stop the corresponding queue
-	if (ipv4h.GetProtocol() != 0xFE) {
-                //XXX: Ugly hack. Not a FlowIdTag
-		packet->AddPacketTag(FlowIdTag(m_ifIndex));
-	        NS_LOG_DEBUG ("Node "<< m_node->GetId() <<" dev "<< m_ifIndex << " received packet");
-	        //NS_LOG_UNCOND ("Node "<< m_node->GetId() <<" dev "<< m_ifIndex << " received packet");
-	        //NS_LOG_UNCOND ("Node "<< m_node->GetId() <<" dev "<< m_ifIndex << " type=" << this->GetInstanceTypeId ().GetName ());
-		PointToPointNetDevice::Receive(packet);
-	} else {
-		// Hit trace hooks
-		m_snifferTrace (packet);
-		m_promiscSnifferTrace (packet);
-		m_phyRxEndTrace (packet);
-		m_macRxTrace(packet);
-		if (!m_qbbEnabled) return;
-		// Read the pause headers
-		PauseHeader pauseh;
-		p->RemoveHeader(ipv4h);
-		p->RemoveHeader(pauseh);
-		unsigned qIndex = pauseh.GetQIndex();
-                NS_LOG_LOGIC ("Node "<< m_node->GetId() <<" dev "<< m_ifIndex << "received PAUSE. Pausing queue " << qIndex);
-		// Pause and schedule the resume event
-		m_paused[qIndex] = true;
-		Simulator::Cancel(m_resumeEvt[qIndex]);
-		m_resumeEvt[qIndex] = Simulator::Schedule(MicroSeconds(pauseh.GetTime()),
-						&QbbNetDevice::PauseFinish, this, qIndex);
+	// PAUSE frames come through ReceivePause(), so every packet here is
+	// data. Remember the ingress port for the buffer accounting.
+	//XXX: Ugly hack. Not a FlowIdTag
+	packet->AddPacketTag(FlowIdTag(m_ifIndex));
+	NS_LOG_DEBUG ("Node "<< m_node->GetId() <<" dev "<< m_ifIndex << " received packet");
+	PointToPointNetDevice::Receive(packet);
+}
+
+void
+QbbNetDevice::ReceivePause (uint8_t qIndex, uint32_t time)
+{
+	NS_LOG_FUNCTION (this << (uint32_t) qIndex << time);
+	if (!m_qbbEnabled || qIndex >= qCnt) return;
+	NS_LOG_LOGIC ("Node "<< m_node->GetId() <<" dev "<< m_ifIndex << " received PAUSE for queue " << (uint32_t) qIndex << " time " << time);
+	if (time == 0) {
+		// XON: resume now if still paused
+		if (m_pausedMask & (1u << qIndex)) {
+			Resume(qIndex);
+		};
+		return;
 	};
+	// Pause until the given time. No event is needed here: the queue
+	// is checked for expiry when the device next looks for a packet.
+	m_pausedMask |= 1u << qIndex;
+	m_pausedUntil[qIndex] = Simulator::Now() + MicroSeconds(time);
+	if (m_pausedUntil[qIndex] < m_earliestResume) m_earliestResume = m_pausedUntil[qIndex];
 }
 
 bool
@@ -264,192 +488,217 @@ QbbNetDevice::Send(Ptr<Packet> packet, const Address &dest, uint16_t protocolNum
 		return false;
 	}
 
-	// If this packet is a PAUSE, preempt everything and send, as if
-	// it is sent out-of-band
-	Ipv4Header h;
-	packet->PeekHeader(h);
-	if (h.GetProtocol() == 0xFE) {
-		if (!m_qbbEnabled) return true;
-		NS_LOG_INFO("Node "<< m_node->GetId() <<" dev "<< m_ifIndex <<" deliver PAUSE. Current Qsize ");
-		//NS_LOG_UNCOND ("Node "<< m_node->GetId() <<" dev "<< m_ifIndex <<" deliver PAUSE. Current Qsize ");
-		AddHeader(packet, protocolNumber);
-		m_snifferTrace (packet);
-		m_promiscSnifferTrace (packet);
-		m_phyTxBeginTrace (packet);
-		Time txTime = Seconds(m_bps.CalculateTxTime(packet->GetSize()));
-		bool result = m_channel->TransmitStart(packet, this, txTime);
-		if (result == false) {
-			m_phyTxDropTrace(packet);
-		}
-		return result;
-	};
+	// Get the priority class of the packet
+	unsigned qIndex = Classify (packet);
 
-	// Get the flow id of the packet
-	unsigned qIndex = 0; //XXX: This should be decided by TOS, like normal Qbb
-	
-	// Gather statistics on the input port number
+	// A forwarded packet is charged to the port it came in from until it
+	// leaves the queue
+	Ptr<QbbNetDevice> ingress;
 	FlowIdTag t;
-	packet->RemovePacketTag(t);
-	uint32_t inDev = t.GetFlowId();
-        //XXX: Brent: This doesn't make sense to me. Why the limit?
-	if (inDev < 1000 && inDev >= 0) {
-		if ( true || m_recheckEvt[qIndex].IsExpired()) {
-#if 0
-			for (unsigned i = 0; i < m_arrival[qIndex].size(); ++i) {
-				m_arrival[qIndex][i] *= 0.75;
-			};
-			while (m_arrival[qIndex].size() <= inDev) {
-				m_arrival[qIndex].push_back(0);
-			};
-			m_arrival[qIndex][inDev] += 1;
-#endif
-#if 0
-			for (std::list<uint32_t>::iterator i = m_arrival[qIndex].begin(); i != m_arrival[qIndex].end(); ++i) {
-				if (*i == inDev) {
-					m_arrival[qIndex].erase(i);
-					break;
-				};
-			};
-#endif
-                        m_arrival[qIndex].clear (); //XXX: Brent: only remember the most recent inDev to PAUSE
-			m_arrival[qIndex].push_front(inDev);
-	                NS_LOG_INFO("Node "<< m_node->GetId() <<" dev "<< m_ifIndex <<" received a packet from dev " << inDev);
-	                //NS_LOG_UNCOND("Node "<< m_node->GetId() <<" dev "<< m_ifIndex <<" received a packet from dev " << inDev);
-		} else {
-			std::list<uint32_t>::iterator i = m_arrival[qIndex].begin();
-			for (; i != m_arrival[qIndex].end(); ++i) {
-				if (*i == inDev) break;
-			};
-			if (i == m_arrival[qIndex].end()) {
-				m_arrival[qIndex].push_back(inDev);
-			};
-		};
+	if (packet->RemovePacketTag(t)) {
+		ingress = DynamicCast<QbbNetDevice> (m_node->GetDevice(t.GetFlowId()));
+		NS_LOG_INFO("Node "<< m_node->GetId() <<" dev "<< m_ifIndex <<" received a packet from dev " << t.GetFlowId());
 	};
 
-	// Enqueue, call DequeueAndTransmit(), and check for queue overflow
+	// Enqueue, call DequeueAndTransmit(), and account for the ingress port
 	AddHeader(packet, protocolNumber);
+	if (ingress != 0 && !ingress->IngressAdmit(qIndex, packet->GetSize())) {
+		NS_LOG_LOGIC ("Queue " << qIndex << " of dev " << t.GetFlowId() << " out of headroom, dropping");
+		m_macTxDropTrace (packet);
+		return false;
+	};
 	m_macTxTrace (packet);
-	m_queues[qIndex]->Enqueue(packet);
-	m_bufferUsage += packet->GetSize();
+	if (m_queues[qIndex]->Enqueue(packet)) {
+		m_nonEmptyMask |= 1u << qIndex;
+		m_ingress[qIndex].push_back(ingress);
+		m_bufferUsage += packet->GetSize();
+		if (ingress != 0) ingress->IngressAdd(qIndex, packet->GetSize());
+	};
 	NS_LOG_INFO("Queue "<< qIndex <<" length " << m_queues[qIndex]->GetNPackets());
 	DequeueAndTransmit();
-	if (m_qbbEnabled && IsLocal(h.GetSource())==false) {
-		CheckQueueFull(qIndex);
-	}
 	return true;
 }
 
-void
-QbbNetDevice::CheckQueueFull(unsigned qIndex)
+uint32_t
+QbbNetDevice::GetIngressBytes (unsigned qIndex) const
 {
-	NS_LOG_FUNCTION(this);
-	NS_LOG_INFO("Node "<< m_node->GetId() <<" dev "<< m_ifIndex << "Queue "<< qIndex <<" length " << m_queues[qIndex]->GetNPackets());
-  
-	if (m_queues[qIndex]->GetNBytes() > m_threshold) {
-		// Create the PAUSE packet
-		Ptr<Packet> p = Create<Packet>(0);
-		PauseHeader pauseh(m_pausetime /* in usec */, m_queues[qIndex]->GetNPackets(), qIndex);
-		p->AddHeader(pauseh);
-		Ipv4Header ipv4h;  // Prepare IPv4 header
-		ipv4h.SetProtocol(0xFE);
-		ipv4h.SetSource(m_node->GetObject<Ipv4>()->GetAddress(m_ifIndex,0).GetLocal());
-		ipv4h.SetDestination(Ipv4Address("255.255.255.255"));
-  		ipv4h.SetPayloadSize (p->GetSize());
-		ipv4h.SetTtl(1); 
-		ipv4h.SetIdentification(UniformVariable(0,65536).GetValue());
-		p->AddHeader(ipv4h);
-		// Loop through every net device and send
-		NS_LOG_INFO("Node "<< m_node->GetId() <<" device "<< m_ifIndex <<" queue "<< qIndex << " bytes " << m_queues[qIndex]->GetNBytes() <<
-				" send PAUSE at "<< Simulator::Now().GetSeconds());
+	NS_ASSERT (qIndex < qCnt);
+	return m_ingressBytes[qIndex];
+}
 
-#if 1
-		std::list<uint32_t>::iterator i = m_arrival[qIndex].begin();
-		//for(uint32_t j = m_queues[qIndex]->GetNPackets(); j > m_threshold; j-=2) {
-                //XXX: Brent: I have no clue what this is for...
-		for(uint32_t j = m_queues[qIndex]->GetNBytes(); j > m_threshold; j-=3000) {
-                        NS_LOG_INFO("Node "<< m_node->GetId() <<" dev "<< m_ifIndex << " sending pause to interface "<< *i);
-                        //NS_LOG_UNCOND("Node "<< m_node->GetId() <<" dev "<< m_ifIndex << " sending pause to interface "<< *i);
-			//Ptr<NetDevice> device = m_ipv4->GetNetDevice(*i); XXX: Broken, returns a loopback DEV for id 0.
-                        Ptr<NetDevice> device = m_node->GetDevice (*i);
-			Ptr<Packet> pCopy = p->Copy();
-			device->Send(pCopy, GetBroadcast(), 0x0800);
-			if (++i == m_arrival[qIndex].end()) {
-				break;
-			};
-		};
-#endif
-#if 0
-		for(uint32_t i=m_node->GetNDevices()-1; i>0; i--) {
-			Ptr<NetDevice> device = m_ipv4->GetNetDevice(i);
-			if (device == this) {
-				continue;
-			};
-			Ptr<Packet> pCopy = p->Copy();
-			device->Send(pCopy, Mac48Bcast, 0x0800);
-		};
-#endif
-#if 0
-		std::list<uint32_t> sortedDev;
-		std::list<uint32_t>::iterator j;
-		for (unsigned i = 0; i < m_arrival[qIndex].size(); ++i) {
-			j = sortedDev.begin();
-			while(j != sortedDev.end()) {
-				if (m_arrival[qIndex][*j] > m_arrival[qIndex][i]) {
-					break;
-				} else {
-					++j;
-				};
-			};
-			sortedDev.insert(j, i);
+Ptr<QbbSharedBuffer>
+QbbNetDevice::GetSharedBuffer (void)
+{
+	if (m_sharedBuffer == 0) {
+		m_sharedBuffer = m_node->GetObject<QbbSharedBuffer> ();
+		if (m_sharedBuffer == 0) {
+			m_sharedBuffer = CreateObject<QbbSharedBuffer> ();
+			m_node->AggregateObject (m_sharedBuffer);
 		};
-		j = sortedDev.begin();
-		for(uint32_t k = m_queues[qIndex]->GetNPackets(); k > m_threshold; k-=2) {
-			if (j == sortedDev.end()) {
-				break;
-			};
-			Ptr<NetDevice> device = m_ipv4->GetNetDevice(*j);
-			Ptr<Packet> pCopy = p->Copy();
-			device->Send(pCopy, Mac48Bcast, 0x0800);
-			++j;
+	};
+	return m_sharedBuffer;
+}
+
+uint32_t
+QbbNetDevice::GetPauseThreshold (unsigned qIndex) const
+{
+	uint32_t threshold = GetClassThreshold (qIndex);
+	return (m_sharedBuffer != 0) ? m_sharedBuffer->GetPauseThreshold (threshold) : threshold;
+}
+
+bool
+QbbNetDevice::IngressAdmit (unsigned qIndex, uint32_t size)
+{
+	if (!GetSharedBuffer ()->CanAdmit (size)) return false;
+	// Headroom absorbs what the peer sends before our PAUSE takes effect
+	uint32_t headroom = GetClassHeadroom (qIndex);
+	return headroom == 0 || m_ingressBytes[qIndex] + size <= GetClassThreshold (qIndex) + headroom;
+}
+
+void
+QbbNetDevice::IngressAdd (unsigned qIndex, uint32_t size)
+{
+	m_ingressBytes[qIndex] += size;
+	m_sharedBuffer->Add (size);
+	if (m_qbbEnabled && !(m_pauseSentMask & (1u << qIndex))
+			&& m_ingressBytes[qIndex] > GetPauseThreshold (qIndex)) {
+		NS_LOG_INFO("Node "<< m_node->GetId() <<" dev "<< m_ifIndex <<" queue "<< qIndex << " ingress bytes " << m_ingressBytes[qIndex] <<
+				" send PAUSE at "<< Simulator::Now().GetSeconds());
+		m_pauseSentMask |= 1u << qIndex;
+		SendPause (qIndex, m_pausetime);
+		m_pauseSentAt[qIndex] = Simulator::Now();
+		if (!m_refreshEvt.IsRunning()) {
+			m_refreshEvt = Simulator::Schedule(MicroSeconds(m_pausetime/2),
+					&QbbNetDevice::RefreshPause, this);
 		};
-#endif
+	};
+}
 
-		Simulator::Cancel(m_recheckEvt[qIndex]);
-		m_recheckEvt[qIndex] = Simulator::Schedule(MicroSeconds(m_pausetime/2),
-				&QbbNetDevice::CheckQueueFull, this, qIndex);
+void
+QbbNetDevice::IngressRemove (unsigned qIndex, uint32_t size)
+{
+	NS_ASSERT (m_ingressBytes[qIndex] >= size);
+	m_ingressBytes[qIndex] -= size;
+	m_sharedBuffer->Remove (size);
+	if (m_pauseSentMask & (1u << qIndex)) {
+		uint32_t threshold = GetPauseThreshold (qIndex);
+		uint32_t resume = (threshold > m_resumeOffset) ? threshold - m_resumeOffset : 0;
+		if (m_ingressBytes[qIndex] <= resume) {
+			NS_LOG_INFO("Node "<< m_node->GetId() <<" dev "<< m_ifIndex <<" queue "<< qIndex << " ingress bytes " << m_ingressBytes[qIndex] <<
+					" send XON at "<< Simulator::Now().GetSeconds());
+			m_pauseSentMask &= ~(1u << qIndex);
+			SendPause (qIndex, 0);
+		};
 	};
-};
+}
 
-bool
-QbbNetDevice::IsLocal(const Ipv4Address& addr) const
+void
+QbbNetDevice::RefreshPause (void)
 {
-	Ptr<Ipv4> ipv4 = m_node->GetObject<Ipv4>();
-	for (unsigned i=0; i < ipv4->GetNInterfaces(); i++) {
-		for (unsigned j=0; j < ipv4->GetNAddresses(i); j++) {
-			if (ipv4->GetAddress(i,j).GetLocal() == addr) {
-				return true;
-			};
+	NS_LOG_FUNCTION(this);
+	// One timer serves all classes. Classes resumed with XON since are
+	// simply skipped, so XON never has to cancel it.
+	Time now = Simulator::Now();
+	Time interval = MicroSeconds(m_pausetime/2);
+	Time next = Simulator::GetMaximumSimulationTime ();
+	for (unsigned i=0; i<qCnt; i++) {
+		if (!(m_pauseSentMask & (1u << i))) continue;
+		if (m_pauseSentAt[i] + interval <= now) {
+			SendPause (i, m_pausetime);
+			m_pauseSentAt[i] = now;
 		};
+		if (m_pauseSentAt[i] + interval < next) next = m_pauseSentAt[i] + interval;
+	};
+	if (m_pauseSentMask) {
+		m_refreshEvt = Simulator::Schedule(next - now, &QbbNetDevice::RefreshPause, this);
 	};
-	return false;
+}
+
+void
+QbbNetDevice::SendPause (unsigned qIndex, uint32_t time)
+{
+	// Preempt everything and send, as if it is sent out-of-band
+	if (!m_qbbEnabled || IsLinkUp () == false) return;
+	NS_LOG_INFO("Node "<< m_node->GetId() <<" dev "<< m_ifIndex <<" deliver PAUSE for queue " << qIndex << " time " << time);
+	Time txTime = GetTxTime(pauseFrameSize);
+	Ptr<Packet> frame = PauseFrame (Mac48Address::ConvertFrom (GetAddress ()), qIndex, time);
+	m_snifferTrace (frame);
+	m_promiscSnifferTrace (frame);
+	m_phyTxBeginTrace (frame);
+	Simulator::Schedule(txTime, &QbbNetDevice::PauseTransmitComplete, this, frame);
+	m_channel->TransmitPause(frame, this, qIndex, time, txTime);
+}
+
+void
+QbbNetDevice::PauseTransmitComplete (Ptr<Packet> frame)
+{
+	m_phyTxEndTrace (frame);
+}
+
+void
+QbbNetDevice::WaitTxAvailable(TxAvailableCallback cb, uint32_t bytes, double weight, Ptr<const Packet> probe)
+{
+	NS_LOG_FUNCTION(this << bytes << weight);
+	TxWaiter w;
+	w.cb = cb;
+	w.bytes = bytes;
+	w.qIndex = (probe != 0) ? Classify (probe) : 0;
+	++m_txWaitCount[w.qIndex];
+	m_txWaitMask |= 1u << w.qIndex;
+	double key;
+	if (m_txWakeup == TX_WAKEUP_WEIGHTED && weight > 0) {
+		// Virtual finish time of the request, as in weighted fair queueing
+		key = m_txWaitClock + bytes / weight;
+	} else {
+		key = ++m_txWaitClock;
+	};
+	m_txWaiters.insert(std::make_pair(key, w));
 };
 
 void
-QbbNetDevice::ConnectWithoutContext(const CallbackBase& callback)
+QbbNetDevice::CancelTxWait(TxAvailableCallback cb)
 {
 	NS_LOG_FUNCTION(this);
-	//NS_LOG_LOGIC("callback list of size " << m_sendCb.size());
-	m_sendCb.ConnectWithoutContext(callback);
-	//NS_LOG_LOGIC("callback list size is now " << m_sendCb.size());
+	for (TxWaitQueue::iterator i = m_txWaiters.begin(); i != m_txWaiters.end(); ++i) {
+		if (i->second.cb.IsEqual(cb)) {
+			unsigned qIndex = i->second.qIndex;
+			if (--m_txWaitCount[qIndex] == 0) m_txWaitMask &= ~(1u << qIndex);
+			m_txWaiters.erase(i);
+			return;
+		};
+	};
 };
 
 void
-QbbNetDevice::DisconnectWithoutContext(const CallbackBase& callback)
+QbbNetDevice::WakeTxWaiters(void)
 {
-	NS_LOG_FUNCTION(this);
-	//NS_LOG_LOGIC("callback list of size " << m_sendCb.size());
-	m_sendCb.DisconnectWithoutContext(callback);
-	//NS_LOG_LOGIC("callback list size is now " << m_sendCb.size());
+	// A woken sender usually fills the buffer again, so look at what is
+	// available before each wake-up. The first waiter of a class that does
+	// not fit keeps the rest of its class waiting, and the scan stops once
+	// every class with waiters is held back.
+	uint32_t full = 0;
+	TxWaitQueue::iterator i = m_txWaiters.begin();
+	while (i != m_txWaiters.end() && (m_txWaitMask & ~full)) {
+		unsigned qIndex = i->second.qIndex;
+		if (full & (1u << qIndex)) {
+			++i;
+			continue;
+		};
+		uint32_t avail = GetTxAvailable (qIndex);
+		if (i->second.bytes > avail) {
+			full |= 1u << qIndex;
+			++i;
+			continue;
+		};
+		NS_LOG_INFO("Queue " << qIndex << " TxAvailable=" << avail);
+		TxAvailableCallback cb = i->second.cb;
+		if (m_txWakeup == TX_WAKEUP_WEIGHTED) m_txWaitClock = std::max (m_txWaitClock, i->first);
+		if (--m_txWaitCount[qIndex] == 0) m_txWaitMask &= ~(1u << qIndex);
+		m_txWaiters.erase(i);
+		cb(this, avail);
+		// The callback may have queued or cancelled waiters
+		i = m_txWaiters.begin();
+	};
 };
 
 int32_t
@@ -457,30 +706,34 @@ QbbNetDevice::PrintStatus(std::ostream& os)
 {
 	os << "lastQ=" << m_lastQ;
 	for (unsigned i=0; i<qCnt; ++i) {
-		os << " " << (m_paused[i]?"q":"Q") << "[" << i << "]=" << m_queues[i]->GetNPackets();
+		os << " " << ((m_pausedMask & (1u << i))?"q":"Q") << "[" << i << "]=" << m_queues[i]->GetNPackets();
 	};
 	os << std::endl << "Size:";
 	uint32_t sum = 0;
 	for (unsigned i=0; i<qCnt; ++i) {
-		os << " " << (m_paused[i]?"q":"Q") << "[" << i << "]=" << m_queues[i]->GetNBytes();
+		os << " " << ((m_pausedMask & (1u << i))?"q":"Q") << "[" << i << "]=" << m_queues[i]->GetNBytes();
 		sum += m_queues[i]->GetNBytes();
 	};
 #if 0
 	os << " sum=" << sum << std::endl << "RxStat:";
 	sum = 0;
 	for (unsigned i=0; i<qCnt; ++i) {
-		os << " " << (m_paused[i]?"q":"Q") << "[" << i << "]=" << m_queues[i]->GetTotalReceivedBytes();
+		os << " " << ((m_pausedMask & (1u << i))?"q":"Q") << "[" << i << "]=" << m_queues[i]->GetTotalReceivedBytes();
 		sum += m_queues[i]->GetTotalReceivedBytes();
 	};
 	os << " sum=" << sum << std::endl << "TxStat:";
 	sum = 0;
 	for (unsigned i=0; i<qCnt; ++i) {
-		os << " " << (m_paused[i]?"q":"Q") << "[" << i << "]=" << m_queues[i]->GetTotalSentBytes();
+		os << " " << ((m_pausedMask & (1u << i))?"q":"Q") << "[" << i << "]=" << m_queues[i]->GetTotalSentBytes();
 		sum += m_queues[i]->GetTotalSentBytes();
 		m_queues[i]->ResetStatistics();
 	};
 #endif
-	os << " sum=" << sum << std::endl;
+	os << " sum=" << sum << std::endl << "Ingress:";
+	for (unsigned i=0; i<qCnt; ++i) {
+		os << " " << ((m_pauseSentMask & (1u << i))?"p":"P") << "[" << i << "]=" << m_ingressBytes[i];
+	};
+	os << std::endl;
 	return sum;
 };
 
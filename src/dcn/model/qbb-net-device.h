@@ -22,6 +22,9 @@
 #include "ns3/point-to-point-net-device.h"
 #include "ns3/fivetuple.h"
 #include "ns3/event-id.h"
+#include "ns3/qbb-shared-buffer.h"
+#include <deque>
+#include <map>
 
 namespace ns3 {
 
@@ -32,9 +35,22 @@ namespace ns3 {
 class QbbNetDevice : public PointToPointNetDevice 
 {
 public:
-  //TODO: Lets cut out multiple queues for now
   static const unsigned qCnt = 8;	// Number of queues/priorities used
 
+  /// How a packet is mapped to one of the qCnt priority classes
+  enum Classifier {
+    CLASSIFY_NONE,		//< Every packet goes to class 0
+    CLASSIFY_TOS,		//< IP precedence (top three TOS bits), as the 802.1p PCP
+    CLASSIFY_PRIORITY_TAG	//< Remaining bytes carried in PriorityTag, shortest in the highest class
+  };
+
+  /// How the device picks the next class to transmit from
+  enum Scheduler {
+    SCHED_ROUND_ROBIN,	//< One packet per class in turn
+    SCHED_STRICT,	//< Highest non-paused class index first
+    SCHED_DWRR		//< Deficit weighted round robin on per-class quanta
+  };
+
   static TypeId GetTypeId (void);
 
   QbbNetDevice ();
@@ -56,14 +72,23 @@ public:
    * Receive a packet from a connected PointToPointChannel.
    *
    * This is to intercept the same call from the PointToPointNetDevice
-   * so that the pause messages are honoured without letting
-   * PointToPointNetDevice::Receive(p) know
+   * so that the ingress port of the packet is recorded before it is
+   * passed to PointToPointNetDevice::Receive(p)
    *
    * @see PointToPointNetDevice
    * @param p Ptr to the received packet.
    */
   virtual void Receive (Ptr<Packet> p);
 
+  /**
+   * Receive a PAUSE from a connected PointToPointChannel and pause or,
+   * for a zero pause time, resume the queue of the given class
+   *
+   * @param qIndex The priority class
+   * @param time The pause time in microseconds
+   */
+  virtual void ReceivePause (uint8_t qIndex, uint32_t time);
+
   /**
    * Send a packet to the channel by putting it to the queue
    * of the corresponding priority class
@@ -75,17 +100,58 @@ public:
   virtual bool Send(Ptr<Packet> packet, const Address &dest, uint16_t protocolNumber);
 
   /**
-   * Get the size of Tx buffer available in the device
+   * Get the size of Tx buffer available to unclassified packets, which
+   * are carried in class 0
    *
    * @return buffer available in bytes
    */
   virtual uint32_t GetTxAvailable() const;
 
   /**
-   * TracedCallback hooks
+   * Get the size of Tx buffer available to the class a packet maps to
+   *
+   * @param probe A packet classified like the sender's
+   * @return buffer available in bytes
+   */
+  virtual uint32_t GetTxAvailable(Ptr<const Packet> probe) const;
+
+  /**
+   * Get the size of Tx buffer available to a priority class
+   *
+   * @param qIndex The priority class
+   * @return bytes below the PAUSE threshold of the class
+   */
+  uint32_t GetTxAvailable(unsigned qIndex) const;
+
+  /**
+   * Bytes received on this port in a priority class that are still queued
+   * at the egress ports of the node
+   *
+   * @param qIndex The priority class
+   */
+  uint32_t GetIngressBytes(unsigned qIndex) const;
+
+  /**
+   * Per-class overrides of the QbbThreshold, QbbHeadroom and DwrrQuantum
+   * attributes. A value of zero makes the class use the attribute again.
+   *
+   * @param qIndex The priority class
+   * @param bytes The new value in bytes
    */
-  virtual void ConnectWithoutContext(const CallbackBase& callback);
-  virtual void DisconnectWithoutContext(const CallbackBase& callback);
+  void SetClassThreshold(unsigned qIndex, uint32_t bytes);
+  void SetClassHeadroom(unsigned qIndex, uint32_t bytes);
+  void SetClassQuantum(unsigned qIndex, uint32_t bytes);
+
+  /**
+   * Queue a wake-up for when the Tx buffer has room again. Waiters are
+   * woken one at a time after each transmission, in FIFO or weighted fair
+   * order, for as long as the bytes they asked for are available in the
+   * class the probe maps to. A waiter that does not fit holds back the
+   * later waiters of its class only.
+   */
+  virtual void WaitTxAvailable(TxAvailableCallback cb, uint32_t bytes, double weight = 1.0,
+                               Ptr<const Packet> probe = 0);
+  virtual void CancelTxWait(TxAvailableCallback cb);
 
   virtual int32_t PrintStatus(std::ostream& os);
 
@@ -98,21 +164,68 @@ protected:
   /// Look for an available packet and send it using TransmitStart(p)
   virtual void DequeueAndTransmit(void);
 
+  /// Map a data packet to its priority class
+  unsigned Classify(Ptr<const Packet> p) const;
+
+  /// Pick the class to transmit from next, or qCnt if none can send
+  unsigned SelectQueue(void);
+
+  /// Bitmask of the classes that have packets and are not paused
+  uint32_t GetEligibleMask(void) const;
+
+  /// First set bit of mask at or after qIndex, wrapping around qCnt
+  static unsigned NextSet(uint32_t mask, unsigned qIndex);
+
+  /// Wake the Tx waiters that fit in the buffer available
+  void WakeTxWaiters(void);
+
+  /// Effective per-class settings
+  uint32_t GetClassThreshold(unsigned qIndex) const;
+  uint32_t GetClassHeadroom(unsigned qIndex) const;
+  uint32_t GetClassQuantum(unsigned qIndex) const;
+
   /// Resume a paused queue and call DequeueAndTransmit()
   virtual void Resume(unsigned qIndex);
 
-  /// Wrapper to Resume() as an schedulable function
-  void PauseFinish(unsigned qIndex);
+  /// Wake up after the earliest pause of a backlogged queue runs out
+  void PauseFinish(void);
+
+  /// Clear the pauses that have run out
+  void ExpirePauses(void);
+
+  /// Ingress PAUSE threshold of a class after the shared buffer is applied
+  uint32_t GetPauseThreshold(unsigned qIndex) const;
+
+  /// The shared buffer of the node, aggregated on first use
+  Ptr<QbbSharedBuffer> GetSharedBuffer(void);
 
   /**
-   * Function to generate PAUSE message if necessary
+   * Ingress side accounting, called by the egress device of the same node
+   * on a packet received by this device. IngressAdmit tells whether the
+   * headroom and the shared buffer can take the packet, IngressAdd and
+   * IngressRemove track it while it is queued and send PAUSE or XON when
+   * the class crosses its thresholds.
    *
-   * @param qIndex The queue index to check
+   * @param qIndex The priority class
+   * @param size The packet size in bytes
    */
-  void CheckQueueFull(unsigned qIndex);
+  bool IngressAdmit(unsigned qIndex, uint32_t size);
+  void IngressAdd(unsigned qIndex, uint32_t size);
+  void IngressRemove(unsigned qIndex, uint32_t size);
 
-  /// Tell if an address is local to this node
-  bool IsLocal(const Ipv4Address& addr) const;
+  /// Repeat a PAUSE while the class stays above its resume threshold
+  void RefreshPause(void);
+
+  /**
+   * Send a PAUSE frame for a class to the peer of this device
+   *
+   * @param qIndex The priority class
+   * @param time The pause time in microseconds, zero to resume (XON)
+   */
+  void SendPause(unsigned qIndex, uint32_t time);
+
+  /// Hit the Tx end trace once a PAUSE frame has left the device
+  void PauseTransmitComplete(Ptr<Packet> frame);
 
   /**
    * The queues for each priority class.
@@ -121,22 +234,53 @@ protected:
    */
   std::vector<Ptr<Queue> > m_queues;
 
-  TracedCallback<Ptr<NetDevice>, uint32_t> m_sendCb;	//< Callback chain for notifying Tx buffer available
+  /// Order of the wake-ups of the senders waiting for Tx buffer
+  enum TxWakeup {
+    TX_WAKEUP_FIFO,	//< In the order the senders blocked
+    TX_WAKEUP_WEIGHTED	//< Weighted fair on the bytes requested
+  };
+
+  struct TxWaiter {
+    TxAvailableCallback cb;	//< Wake-up to invoke
+    uint32_t bytes;	//< Bytes the waiter needs
+    unsigned qIndex;	//< Class the waiter sends in
+  };
+  typedef std::multimap<double, TxWaiter> TxWaitQueue;
+
+  TxWakeup m_txWakeup;	//< Order of the wake-ups
+  TxWaitQueue m_txWaiters;	//< Waiters keyed by arrival or virtual finish time
+  double m_txWaitClock;	//< Arrival count or virtual time of the wait queue
+  uint32_t m_txWaitCount[qCnt];	//< Waiters of each class
+  uint32_t m_txWaitMask;	//< Bit i set when class i has waiters
 
   bool m_qbbEnabled;	//< Qbb behaviour enabled
-  uint32_t m_threshold;	//< Threshold for generating Pause
+  uint32_t m_threshold;	//< Ingress bytes of a class to send PAUSE
+  uint32_t m_resumeOffset;	//< Bytes below the PAUSE threshold to send XON
+  uint32_t m_headroom;	//< Ingress bytes a class may hold above its threshold, 0 for no limit
+  uint32_t m_quantum;	//< DWRR quantum in bytes
+  double m_priorityBase;	//< Remaining bytes covered by the highest PriorityTag class
+  Classifier m_classifier;	//< Packet to class mapping
+  Scheduler m_scheduler;	//< Scheduler across classes
+  uint32_t m_classThreshold[qCnt];	//< Per-class threshold override
+  uint32_t m_classHeadroom[qCnt];	//< Per-class headroom override
+  uint32_t m_classQuantum[qCnt];	//< Per-class DWRR quantum override
+  uint32_t m_deficit[qCnt];	//< DWRR deficit counters
   uint32_t m_pausetime;	//< Time for each Pause
   uint32_t m_buffersize;//< Total size of Tx buffer
   uint32_t m_bufferUsage;	//< Occupancy at the buffer
-  bool m_paused[qCnt];	//< Whether a queue paused
+  uint32_t m_pausedMask;	//< Bit i set when queue i is paused
+  uint32_t m_nonEmptyMask;	//< Bit i set when queue i has packets
   unsigned m_lastQ;	//< Last accessed queue
-  EventId m_resumeEvt[qCnt];  //< Keeping the next resume event
-  EventId m_recheckEvt[qCnt]; //< Keeping the next recheck queue full event
-#if 1
-  std::list<uint32_t> m_arrival[qCnt];
-#else
-  std::vector<double> m_arrival[qCnt];
-#endif
+  Time m_pausedUntil[qCnt];	//< End of the PAUSE received for each queue
+  Time m_earliestResume;	//< No paused queue resumes before this time
+  Time m_resumeAt;	//< Time of the pending wake-up
+  EventId m_resumeEvt;  //< Wake-up for the earliest blocked queue
+  Time m_pauseSentAt[qCnt];	//< Last PAUSE sent for each ingress class
+  EventId m_refreshEvt; //< Next PAUSE refresh for all ingress classes
+  std::deque<Ptr<QbbNetDevice> > m_ingress[qCnt];	//< Ingress device of each queued packet
+  uint32_t m_ingressBytes[qCnt];	//< Queued bytes received on this port
+  uint32_t m_pauseSentMask;	//< Bit i set when class i of the peer is paused
+  Ptr<QbbSharedBuffer> m_sharedBuffer;	//< Buffer shared by the node's ports
 
 };
 
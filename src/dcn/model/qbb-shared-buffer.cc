@@ -0,0 +1,93 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ns3/log.h"
+#include "ns3/assert.h"
+#include "ns3/uinteger.h"
+#include "ns3/double.h"
+#include "qbb-shared-buffer.h"
+
+NS_LOG_COMPONENT_DEFINE ("QbbSharedBuffer");
+
+namespace ns3 {
+
+NS_OBJECT_ENSURE_REGISTERED (QbbSharedBuffer);
+
+TypeId
+QbbSharedBuffer::GetTypeId (void)
+{
+	static TypeId tid = TypeId ("ns3::QbbSharedBuffer")
+	 .SetParent<Object> ()
+	 .AddConstructor<QbbSharedBuffer> ()
+	 .AddAttribute ("BufferSize",
+			"Bytes of packet memory shared by the ports of a switch. Zero means unlimited.",
+			UintegerValue (0),
+			MakeUintegerAccessor (&QbbSharedBuffer::m_size),
+			MakeUintegerChecker<uint32_t> ())
+	 .AddAttribute ("Alpha",
+			"An ingress class is paused above this fraction of the free buffer, if lower than its QbbThreshold.",
+			DoubleValue (1.0),
+			MakeDoubleAccessor (&QbbSharedBuffer::m_alpha),
+			MakeDoubleChecker<double> (0))
+	;
+	return tid;
+}
+
+QbbSharedBuffer::QbbSharedBuffer () : m_used (0)
+{
+	NS_LOG_FUNCTION (this);
+}
+
+QbbSharedBuffer::~QbbSharedBuffer ()
+{
+	NS_LOG_FUNCTION (this);
+}
+
+uint32_t
+QbbSharedBuffer::GetPauseThreshold (uint32_t threshold) const
+{
+	if (m_size == 0) return threshold;
+	uint32_t free = (m_used < m_size) ? m_size - m_used : 0;
+	double dynamic = m_alpha * free;
+	return (dynamic < threshold) ? static_cast<uint32_t> (dynamic) : threshold;
+}
+
+bool
+QbbSharedBuffer::CanAdmit (uint32_t size) const
+{
+	return m_size == 0 || m_used + size <= m_size;
+}
+
+void
+QbbSharedBuffer::Add (uint32_t size)
+{
+	m_used += size;
+}
+
+void
+QbbSharedBuffer::Remove (uint32_t size)
+{
+	NS_ASSERT (m_used >= size);
+	m_used -= size;
+}
+
+uint32_t
+QbbSharedBuffer::GetUsed (void) const
+{
+	return m_used;
+}
+
+} // namespace ns3
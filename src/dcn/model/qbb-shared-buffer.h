@@ -0,0 +1,66 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef QBB_SHARED_BUFFER_H
+#define QBB_SHARED_BUFFER_H
+
+#include <stdint.h>
+#include "ns3/object.h"
+
+namespace ns3 {
+
+/**
+ * \class QbbSharedBuffer
+ * \brief Packet memory shared by all QbbNetDevices of a switch
+ *
+ * Every packet forwarded by a QbbNetDevice is charged to the node's shared
+ * buffer until it leaves the egress queue. The buffer shrinks the PAUSE
+ * threshold of each ingress port and class as it fills up (dynamic
+ * threshold), and refuses packets once it is full. It is aggregated to the
+ * node the first time a device needs it.
+ */
+class QbbSharedBuffer : public Object
+{
+public:
+  static TypeId GetTypeId (void);
+
+  QbbSharedBuffer ();
+  virtual ~QbbSharedBuffer ();
+
+  /**
+   * \param threshold The configured PAUSE threshold of an ingress class
+   * \return The threshold after applying the dynamic threshold
+   */
+  uint32_t GetPauseThreshold (uint32_t threshold) const;
+
+  /// Whether size more bytes fit in the buffer
+  bool CanAdmit (uint32_t size) const;
+
+  void Add (uint32_t size);
+  void Remove (uint32_t size);
+
+  /// Bytes currently held
+  uint32_t GetUsed (void) const;
+
+private:
+  uint32_t m_size;	//< Total buffer in bytes, zero for unlimited
+  double m_alpha;	//< Dynamic threshold factor on the free buffer
+  uint32_t m_used;	//< Bytes currently held
+};
+
+} // namespace ns3
+
+#endif // QBB_SHARED_BUFFER_H
@@ -0,0 +1,271 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ns3/test.h"
+#include "ns3/simulator.h"
+#include "ns3/node.h"
+#include "ns3/enum.h"
+#include "ns3/uinteger.h"
+#include "ns3/data-rate.h"
+#include "ns3/point-to-point-channel.h"
+#include "ns3/ipv4-header.h"
+#include "ns3/qbb-net-device.h"
+#include "ns3/priority-tag.h"
+
+#include <vector>
+
+using namespace ns3;
+
+// PriorityTag values the default PriorityTagBase maps to classes 7 and 3
+static const double highPriority = 1000;
+static const double lowPriority = 100000;
+
+/* A PriorityTag classifying link between two QbbNetDevices */
+class QbbLink
+{
+public:
+  QbbLink ()
+  {
+    for (int i = 0; i < 2; ++i)
+      {
+        node[i] = CreateObject<Node> ();
+        dev[i] = CreateObject<QbbNetDevice> ();
+        dev[i]->SetAttribute ("Classifier", EnumValue (QbbNetDevice::CLASSIFY_PRIORITY_TAG));
+        dev[i]->SetAttribute ("DataRate", DataRateValue (DataRate ("1Gbps")));
+        dev[i]->SetAddress (Mac48Address::Allocate ());
+        node[i]->AddDevice (dev[i]);
+      }
+    Ptr<PointToPointChannel> channel = CreateObject<PointToPointChannel> ();
+    dev[0]->Attach (channel);
+    dev[1]->Attach (channel);
+    dev[1]->SetReceiveCallback (MakeCallback (&QbbLink::Discard));
+  }
+
+  static bool Discard (Ptr<NetDevice> dev, Ptr<const Packet> p, uint16_t protocol, const Address &from)
+  {
+    return true;
+  }
+
+  static Ptr<Packet> Tagged (double priority, uint32_t size)
+  {
+    Ptr<Packet> p = Create<Packet> (size);
+    p->AddPacketTag (PriorityTag (priority));
+    return p;
+  }
+
+  void Send (double priority, uint32_t size)
+  {
+    dev[0]->Send (Tagged (priority, size), dev[1]->GetAddress (), 0x800);
+  }
+
+  Ptr<Node> node[2];
+  Ptr<QbbNetDevice> dev[2];
+};
+
+class QbbPauseTestCase : public TestCase
+{
+public:
+  QbbPauseTestCase ();
+private:
+  virtual void DoRun (void);
+  bool Receive (Ptr<NetDevice> dev, Ptr<const Packet> p, uint16_t protocol, const Address &from);
+  std::vector<double> m_priorities;
+  std::vector<Time> m_times;
+};
+
+QbbPauseTestCase::QbbPauseTestCase ()
+  : TestCase ("A PAUSE holds back its class only, until XON or expiry")
+{
+}
+
+bool
+QbbPauseTestCase::Receive (Ptr<NetDevice> dev, Ptr<const Packet> p, uint16_t protocol, const Address &from)
+{
+  PriorityTag tag;
+  p->PeekPacketTag (tag);
+  m_priorities.push_back (tag.GetPriority ());
+  m_times.push_back (Simulator::Now ());
+  return true;
+}
+
+void
+QbbPauseTestCase::DoRun (void)
+{
+  QbbLink link;
+  link.dev[1]->SetReceiveCallback (MakeCallback (&QbbPauseTestCase::Receive, this));
+
+  // Class 3 is paused for 1ms, class 7 is not
+  link.dev[0]->ReceivePause (3, 1000);
+  link.Send (lowPriority, 1000);
+  link.Send (highPriority, 1000);
+  Simulator::Run ();
+  NS_TEST_ASSERT_MSG_EQ (m_priorities.size (), 2, "Both packets arrive");
+  NS_TEST_EXPECT_MSG_EQ (m_priorities[0], highPriority, "The unpaused class goes first");
+  NS_TEST_EXPECT_MSG_EQ ((m_times[0] < MicroSeconds (100)), true, "The unpaused class is not held back");
+  NS_TEST_EXPECT_MSG_EQ (m_priorities[1], lowPriority, "The paused class waits");
+  NS_TEST_EXPECT_MSG_EQ ((m_times[1] >= MilliSeconds (1)), true, "The paused class waits for the PAUSE to run out");
+
+  // XON resumes a paused class before its PAUSE runs out
+  m_priorities.clear ();
+  m_times.clear ();
+  Time start = Simulator::Now ();
+  link.dev[0]->ReceivePause (3, 1000);
+  link.Send (lowPriority, 1000);
+  Simulator::Schedule (MicroSeconds (200), &QbbNetDevice::ReceivePause, link.dev[0], 3, 0);
+  Simulator::Run ();
+  NS_TEST_ASSERT_MSG_EQ (m_priorities.size (), 1, "The packet arrives");
+  NS_TEST_EXPECT_MSG_EQ ((m_times[0] >= start + MicroSeconds (200)), true, "Held back until XON");
+  NS_TEST_EXPECT_MSG_EQ ((m_times[0] < start + MicroSeconds (300)), true, "Sent on XON");
+
+  Simulator::Destroy ();
+}
+
+class QbbTxWaitTestCase : public TestCase
+{
+public:
+  QbbTxWaitTestCase ();
+private:
+  virtual void DoRun (void);
+  void WakeLow (Ptr<NetDevice> dev, uint32_t avail);
+  void WakeHigh (Ptr<NetDevice> dev, uint32_t avail);
+  std::vector<double> m_woken;
+  std::vector<Time> m_times;
+};
+
+QbbTxWaitTestCase::QbbTxWaitTestCase ()
+  : TestCase ("Tx buffer availability and wake-ups are per class")
+{
+}
+
+void
+QbbTxWaitTestCase::WakeLow (Ptr<NetDevice> dev, uint32_t avail)
+{
+  NS_TEST_EXPECT_MSG_EQ ((avail >= 1000), true, "Woken with room");
+  m_woken.push_back (lowPriority);
+  m_times.push_back (Simulator::Now ());
+}
+
+void
+QbbTxWaitTestCase::WakeHigh (Ptr<NetDevice> dev, uint32_t avail)
+{
+  NS_TEST_EXPECT_MSG_EQ ((avail >= 1000), true, "Woken with room");
+  m_woken.push_back (highPriority);
+  m_times.push_back (Simulator::Now ());
+}
+
+void
+QbbTxWaitTestCase::DoRun (void)
+{
+  QbbLink link;
+  Ptr<QbbNetDevice> dev = link.dev[0];
+  dev->SetAttribute ("QbbThreshold", UintegerValue (3000));
+  Ptr<Packet> low = QbbLink::Tagged (lowPriority, 0);
+  Ptr<Packet> high = QbbLink::Tagged (highPriority, 0);
+
+  // Fill the paused class 3; the other classes keep their room
+  dev->ReceivePause (3, 1000);
+  for (int i = 0; i < 3; ++i)
+    {
+      link.Send (lowPriority, 1000);
+    }
+  NS_TEST_EXPECT_MSG_EQ (dev->GetTxAvailable (low), 0, "Class 3 is full");
+  NS_TEST_EXPECT_MSG_EQ (dev->GetTxAvailable (3u), 0, "Class 3 is full");
+  NS_TEST_EXPECT_MSG_EQ (dev->GetTxAvailable (high), 3000, "Class 7 is empty");
+  NS_TEST_EXPECT_MSG_EQ (dev->GetTxAvailable (), 3000, "Unclassified traffic is in class 0");
+
+  // The class 3 waiter blocked first but must not hold back class 7
+  dev->WaitTxAvailable (MakeCallback (&QbbTxWaitTestCase::WakeLow, this), 1000, 1.0, low);
+  dev->WaitTxAvailable (MakeCallback (&QbbTxWaitTestCase::WakeHigh, this), 1000, 1.0, high);
+  link.Send (highPriority, 1000);
+  Simulator::Stop (MicroSeconds (500));
+  Simulator::Run ();
+  NS_TEST_ASSERT_MSG_EQ (m_woken.size (), 1, "Only the class 7 waiter is woken");
+  NS_TEST_EXPECT_MSG_EQ (m_woken[0], highPriority, "Only the class 7 waiter is woken");
+
+  // Once class 3 resumes and drains below its threshold, its waiter wakes
+  dev->ReceivePause (3, 0);
+  Simulator::Run ();
+  NS_TEST_ASSERT_MSG_EQ (m_woken.size (), 2, "The class 3 waiter is woken");
+  NS_TEST_EXPECT_MSG_EQ (m_woken[1], lowPriority, "The class 3 waiter is woken");
+  NS_TEST_EXPECT_MSG_EQ ((m_times[1] >= MicroSeconds (500)), true, "Not before class 3 resumes");
+
+  // A cancelled waiter is forgotten
+  dev->ReceivePause (3, 1000);
+  for (int i = 0; i < 3; ++i)
+    {
+      link.Send (lowPriority, 1000);
+    }
+  dev->WaitTxAvailable (MakeCallback (&QbbTxWaitTestCase::WakeLow, this), 1000, 1.0, low);
+  dev->CancelTxWait (MakeCallback (&QbbTxWaitTestCase::WakeLow, this));
+  Simulator::Run ();
+  NS_TEST_EXPECT_MSG_EQ (m_woken.size (), 2, "A cancelled waiter is not woken");
+
+  Simulator::Destroy ();
+}
+
+class QbbTosClassifierTestCase : public TestCase
+{
+public:
+  QbbTosClassifierTestCase ();
+private:
+  virtual void DoRun (void);
+};
+
+QbbTosClassifierTestCase::QbbTosClassifierTestCase ()
+  : TestCase ("A probe with an IPv4 header is classified by its TOS")
+{
+}
+
+void
+QbbTosClassifierTestCase::DoRun (void)
+{
+  QbbLink link;
+  Ptr<QbbNetDevice> dev = link.dev[0];
+  dev->SetAttribute ("Classifier", EnumValue (QbbNetDevice::CLASSIFY_TOS));
+  dev->SetAttribute ("QbbThreshold", UintegerValue (3000));
+
+  // Precedence 5 is class 5
+  Ipv4Header header;
+  header.SetTos (5 << 5);
+  Ptr<Packet> probe = Create<Packet> ();
+  probe->AddHeader (header);
+  Ptr<Packet> data = Create<Packet> (1000);
+  data->AddHeader (header);
+
+  dev->ReceivePause (5, 1000);
+  dev->Send (data, link.dev[1]->GetAddress (), 0x800);
+  NS_TEST_EXPECT_MSG_EQ (dev->GetTxAvailable (probe), dev->GetTxAvailable (5u), "Probe maps to class 5");
+  NS_TEST_EXPECT_MSG_EQ ((dev->GetTxAvailable (probe) < 3000), true, "Class 5 holds the packet");
+  NS_TEST_EXPECT_MSG_EQ (dev->GetTxAvailable (Create<Packet> ()), 3000, "No header is class 0");
+
+  Simulator::Destroy ();
+}
+
+class QbbNetDeviceTestSuite : public TestSuite
+{
+public:
+  QbbNetDeviceTestSuite ();
+};
+
+QbbNetDeviceTestSuite::QbbNetDeviceTestSuite ()
+  : TestSuite ("qbb-net-device", UNIT)
+{
+  AddTestCase (new QbbPauseTestCase);
+  AddTestCase (new QbbTxWaitTestCase);
+  AddTestCase (new QbbTosClassifierTestCase);
+}
+
+static QbbNetDeviceTestSuite g_qbbNetDeviceTestSuite;
@@ -0,0 +1,277 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <cmath>
+#include <algorithm>
+#include "dctcp-control.h"
+#include "ns3/log.h"
+#include "ns3/simulator.h"
+#include "ns3/unused.h"
+#include "ns3/uinteger.h"
+
+NS_LOG_COMPONENT_DEFINE ("DctcpControl");
+
+namespace ns3 {
+
+NS_OBJECT_ENSURE_REGISTERED (DctcpControl);
+
+TypeId
+DctcpControl::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::DctcpControl")
+    .SetParent<Object> ()
+    .AddConstructor<DctcpControl> ()
+    .AddAttribute ("ShiftG", "Exponential weight factor for alpha, the loss rate",
+                   UintegerValue (2), /* g=1/2^2 */
+                   MakeUintegerAccessor (&DctcpControl::m_shiftG),
+                   MakeUintegerChecker<uint32_t> (0, 10))
+  ;
+  return tid;
+}
+
+DctcpControl::DctcpControl ()
+  : m_ackedBytesEcn (0),
+    m_ackedBytesTotal (0),
+    m_alpha (0),
+    m_shiftG (2)
+{
+  NS_LOG_FUNCTION (this);
+}
+
+DctcpControl::DctcpControl (const DctcpControl &c)
+  : Object (c),
+    m_ackedBytesEcn (0),
+    m_ackedBytesTotal (0),
+    m_alpha (0),
+    m_shiftG (c.m_shiftG)
+{
+  NS_LOG_FUNCTION (this);
+}
+
+DctcpControl::~DctcpControl ()
+{
+}
+
+Ptr<DctcpControl>
+DctcpControl::Copy (void) const
+{
+  NS_LOG_FUNCTION (this);
+  return CopyObject<DctcpControl> (this);
+}
+
+void
+DctcpControl::Update (uint32_t cWnd, uint32_t segmentSize, const Time &deadline, const Time &rtt)
+{
+  NS_LOG_FUNCTION (this << cWnd << segmentSize);
+
+  /* For avoiding denominator == 1 */
+  if (m_ackedBytesTotal == 0) m_ackedBytesTotal = 1;
+
+  uint32_t alphaOld = m_alpha;
+
+  /* alpha = (1-g) * alpha + g * F */
+  m_alpha = alphaOld - (alphaOld >> m_shiftG)
+    + (m_ackedBytesEcn << (10 - m_shiftG)) / m_ackedBytesTotal;
+
+  if (m_alpha > 1024) m_alpha = 1024; /* round to 0-1024 */
+
+  NS_LOG_INFO ("bytesEcn=" << m_ackedBytesEcn << ", bytesTotal=" <<
+               m_ackedBytesTotal << ", alpha: old=" << alphaOld << ", new=" << m_alpha);
+
+  m_ackedBytesEcn = 0;
+  m_ackedBytesTotal = 0;
+}
+
+uint32_t
+DctcpControl::GetPenalty (void) const
+{
+  return m_alpha;
+}
+
+uint32_t
+DctcpControl::GetAlpha (void) const
+{
+  return m_alpha;
+}
+
+/* -log2 (a / 1024) for a in [1, 1024], with 16 fractional bits, and
+ * 2^(-f / 1024) for f in [0, 1024], with 20 fractional bits */
+static struct PenaltyTables
+{
+  PenaltyTables ()
+  {
+    log2[0] = 0;
+    for (uint32_t a = 1; a <= 1024; ++a)
+      {
+        log2[a] = static_cast<uint32_t> (-std::log (a / 1024.0) / std::log (2.0) * 65536 + 0.5);
+      }
+    for (uint32_t f = 0; f <= 1024; ++f)
+      {
+        exp2[f] = static_cast<uint32_t> (std::pow (2.0, -(f / 1024.0)) * (1 << 20) + 0.5);
+      }
+  }
+  uint32_t log2[1025];
+  uint32_t exp2[1025];
+} g_penaltyTables;
+
+/* Integer square root, rounded down */
+static uint64_t
+SquareRoot (uint64_t x)
+{
+  uint64_t root = 0;
+  uint64_t bit = uint64_t (1) << 62;
+  while (bit > x)
+    {
+      bit >>= 2;
+    }
+  while (bit != 0)
+    {
+      if (x >= root + bit)
+        {
+          x -= root + bit;
+          root = (root >> 1) + bit;
+        }
+      else
+        {
+          root >>= 1;
+        }
+      bit >>= 2;
+    }
+  return root;
+}
+
+NS_OBJECT_ENSURE_REGISTERED (D2tcpControl);
+
+TypeId
+D2tcpControl::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::D2tcpControl")
+    .SetParent<DctcpControl> ()
+    .AddConstructor<D2tcpControl> ()
+    .AddAttribute ("ShiftGamma", "Exponential weight factor for gamma",
+                   UintegerValue (2), /* g=1/2^2 */
+                   MakeUintegerAccessor (&D2tcpControl::m_shiftGamma),
+                   MakeUintegerChecker<uint32_t> (0, 10))
+  ;
+  return tid;
+}
+
+D2tcpControl::D2tcpControl ()
+  : m_gamma (1024),
+    m_shiftGamma (2)
+{
+  NS_LOG_FUNCTION (this);
+}
+
+D2tcpControl::D2tcpControl (const D2tcpControl &c)
+  : DctcpControl (c),
+    m_gamma (1024),
+    m_shiftGamma (c.m_shiftGamma)
+{
+  NS_LOG_FUNCTION (this);
+}
+
+D2tcpControl::~D2tcpControl ()
+{
+}
+
+Ptr<DctcpControl>
+D2tcpControl::Copy (void) const
+{
+  NS_LOG_FUNCTION (this);
+  return CopyObject<D2tcpControl> (this);
+}
+
+void
+D2tcpControl::Update (uint32_t cWnd, uint32_t segmentSize, const Time &deadline, const Time &rtt)
+{
+  NS_LOG_FUNCTION (this << cWnd << segmentSize);
+
+  DctcpControl::Update (cWnd, segmentSize, deadline, rtt);
+  if (!deadline.IsPositive ())
+    {
+      NS_ASSERT (m_gamma == 1024);
+      return;
+    }
+
+  // Round trips left before the deadline
+  int64_t remaining = 0;
+  if (rtt.IsStrictlyPositive ())
+    {
+      remaining = (deadline - Simulator::Now ()).GetInteger () / rtt.GetInteger () - 1;
+    }
+
+  uint64_t newGamma = 0;
+  if (remaining > 0)
+    {
+      // Round trips needed to finish, with 10 fractional bits:
+      // tc1 = sqrt (((w + 1) / 2)^2 + 2 * mss) - (w + 1) / 2
+      // tc2 = mss / (3 * w / 4 + 1 / 2)
+      uint64_t w = cWnd / segmentSize;
+      uint64_t tc1 = (SquareRoot (((w + 1) * (w + 1) + 8 * segmentSize) << 20) - ((w + 1) << 10)) / 2;
+      uint64_t tc2 = (uint64_t (segmentSize) << 12) / (3 * w + 2);
+      newGamma = std::min<uint64_t> (std::max (tc1, tc2) / remaining, 1 << 20);
+    }
+
+  uint32_t gammaOld = m_gamma;
+  m_gamma = m_gamma - (m_gamma >> m_shiftGamma) + (static_cast<uint32_t> (newGamma) >> m_shiftGamma);
+  // Cap gamma to [0.4, 2]
+  m_gamma = std::min<uint32_t> (std::max<uint32_t> (m_gamma, 410), 2048);
+
+  NS_LOG_INFO ("Time remaining: " << (deadline - Simulator::Now ()) <<
+               ", gammaOld: " << gammaOld << ", m_gamma: " << m_gamma);
+  NS_UNUSED (gammaOld);
+}
+
+uint32_t
+D2tcpControl::GetPenalty (void) const
+{
+  return Power (m_alpha, m_gamma);
+}
+
+uint32_t
+D2tcpControl::GetGamma (void) const
+{
+  return m_gamma;
+}
+
+uint32_t
+D2tcpControl::Power (uint32_t alpha, uint32_t gamma)
+{
+  if (gamma == 1024 || alpha >= 1024)
+    {
+      return std::min<uint32_t> (alpha, 1024);
+    }
+  if (alpha == 0)
+    {
+      return 0;
+    }
+  // -log2 (alpha^gamma) = gamma * -log2 (alpha), with 16 fractional bits
+  uint64_t exponent = (uint64_t (g_penaltyTables.log2[alpha]) * gamma) >> 10;
+  uint32_t shift = static_cast<uint32_t> (exponent >> 16) + 10;
+  if (shift > 30)
+    {
+      return 0;
+    }
+  // Interpolate 2^-frac between the two closest entries
+  uint32_t frac = exponent & 0xffff;
+  uint32_t low = g_penaltyTables.exp2[frac >> 6];
+  uint32_t high = g_penaltyTables.exp2[(frac >> 6) + 1];
+  uint32_t power = low - (((low - high) * (frac & 0x3f)) >> 6);
+  return (power + (1 << (shift - 1))) >> shift;
+}
+
+} // namespace ns3
@@ -0,0 +1,136 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef DCTCP_CONTROL_H
+#define DCTCP_CONTROL_H
+
+#include <stdint.h>
+#include "ns3/nstime.h"
+#include "ns3/object.h"
+
+namespace ns3 {
+
+/**
+ * \ingroup tcp
+ *
+ * \brief Congestion estimator of a DCTCP sender.
+ *
+ * Keeps alpha, the running fraction of acked bytes that echoed a CE
+ * mark, and turns it into the penalty applied to the window on each
+ * congestion signal. Both are fixed-point fractions with 10 bits after
+ * the point (1024 is 1.0) and are updated with integer arithmetic only,
+ * so the per-ACK work neither allocates nor touches floating point.
+ *
+ * Dctcp creates one per socket from its ControlType attribute, and a
+ * forked socket gets a Copy with the same parameters and a fresh estimate.
+ */
+class DctcpControl : public Object
+{
+public:
+  static TypeId GetTypeId (void);
+
+  DctcpControl ();
+  DctcpControl (const DctcpControl &c);
+  virtual ~DctcpControl ();
+
+  virtual Ptr<DctcpControl> Copy (void) const;
+
+  /**
+   * \brief Account for the bytes acknowledged by one ACK
+   * \param bytes the number of bytes acked
+   * \param ece true if the ACK echoed congestion
+   */
+  void Acked (uint32_t bytes, bool ece)
+  {
+    m_ackedBytesTotal += bytes;
+    if (ece)
+      {
+        m_ackedBytesEcn += bytes;
+      }
+  }
+
+  /**
+   * \brief Fold the bytes acked over the last window into alpha
+   *
+   * Called once per round trip.
+   *
+   * \param cWnd the congestion window, in bytes
+   * \param segmentSize the segment size, in bytes
+   * \param deadline the time the flow should complete by, negative if none
+   * \param rtt the current RTT estimate
+   */
+  virtual void Update (uint32_t cWnd, uint32_t segmentSize, const Time &deadline, const Time &rtt);
+
+  /**
+   * \return the fraction of the window to shed on a congestion signal,
+   *         halved by the caller, with 1024 being the whole window
+   */
+  virtual uint32_t GetPenalty (void) const;
+
+  /// \return alpha, with 1024 being every byte marked
+  uint32_t GetAlpha (void) const;
+
+protected:
+  uint32_t m_ackedBytesEcn;     //< Bytes acked with ECE in this window
+  uint32_t m_ackedBytesTotal;   //< Bytes acked in this window
+  uint32_t m_alpha;             //< Fraction of marked bytes, 10 fractional bits
+  uint32_t m_shiftG;            //< alpha's EWMA weight is 1/2^m_shiftG
+};
+
+/**
+ * \ingroup tcp
+ *
+ * \brief Deadline-aware congestion estimator (D2TCP).
+ *
+ * The penalty is alpha^gamma, where gamma, the deadline imminence
+ * factor, grows as the time needed to finish the flow catches up with
+ * the time left before its deadline. Flows with no deadline keep
+ * gamma at 1 and behave exactly like DCTCP.
+ *
+ * alpha^gamma is computed as 2^(gamma * log2 (alpha)) from two small
+ * tables of fixed-point logarithms and powers of two, built once.
+ */
+class D2tcpControl : public DctcpControl
+{
+public:
+  static TypeId GetTypeId (void);
+
+  D2tcpControl ();
+  D2tcpControl (const D2tcpControl &c);
+  virtual ~D2tcpControl ();
+
+  virtual Ptr<DctcpControl> Copy (void) const;
+  virtual void Update (uint32_t cWnd, uint32_t segmentSize, const Time &deadline, const Time &rtt);
+  virtual uint32_t GetPenalty (void) const;
+
+  /// \return gamma, with 10 fractional bits
+  uint32_t GetGamma (void) const;
+
+  /**
+   * \param alpha a fraction with 10 fractional bits, at most 1024
+   * \param gamma an exponent with 10 fractional bits
+   * \return alpha^gamma, with 10 fractional bits
+   */
+  static uint32_t Power (uint32_t alpha, uint32_t gamma);
+
+private:
+  uint32_t m_gamma;             //< Deadline imminence, 10 fractional bits
+  uint32_t m_shiftGamma;        //< gamma's EWMA weight is 1/2^m_shiftGamma
+};
+
+} // namespace ns3
+
+#endif /* DCTCP_CONTROL_H */
@@ -26,6 +26,7 @@
 #include "ns3/simulator.h"
 #include "ns3/node.h"
 #include "ns3/packet.h"
+#include "ns3/object-factory.h"
 #include "tcp-option-ts.h"
 #include "ipv4-l3-protocol.h"
 
@@ -41,14 +42,10 @@ Dctcp::GetTypeId (void)
   static TypeId tid = TypeId ("ns3::Dctcp")
     .SetParent<TcpNewReno> ()
     .AddConstructor<Dctcp> ()
-    .AddAttribute ("ShiftG", "Exponential weight factor for alpha, the loss rate",
-                   UintegerValue (4), /* g=1/2^4 */
-                   MakeUintegerAccessor (&Dctcp::m_shiftG),
-                   MakeUintegerChecker<uint32_t> ())
-    .AddAttribute ("ShiftGamma", "Exponential weight factor for gamma",
-                   UintegerValue (2), /* g=1/2^2 */
-                   MakeUintegerAccessor (&Dctcp::m_shiftG),
-                   MakeUintegerChecker<uint32_t> ())
+    .AddAttribute ("ControlType", "Type of the congestion estimator: ns3::DctcpControl or ns3::D2tcpControl",
+                   TypeIdValue (DctcpControl::GetTypeId ()),
+                   MakeTypeIdAccessor (&Dctcp::m_controlType),
+                   MakeTypeIdChecker ())
     .AddAttribute ("Deadline", "Time at which the flow should complete",
                    TimeValue (Seconds (-1)), /* Negative deadline means no deadline */
                    MakeTimeAccessor (&Dctcp::m_deadline),
@@ -60,10 +57,6 @@ Dctcp::GetTypeId (void)
 Dctcp::Dctcp (void)
   : m_ece (false),
     m_cwr (false),
-    m_ackedBytesEcn (0),
-    m_ackedBytesTotal (0),
-    m_alpha (0),
-    m_gamma (1),
     m_nextSeq (0),
     m_ceState (false),
     m_deadline (Seconds (-1))
@@ -80,13 +73,11 @@ Dctcp::Dctcp (const Dctcp& sock)
   : TcpNewReno (sock),
     m_ece (false),
     m_cwr (false),
-    m_ackedBytesEcn (0),
-    m_ackedBytesTotal (0),
-    m_alpha (0),
-    m_gamma (1),
+    m_controlType (sock.m_controlType),
+    m_control (sock.m_control->Copy ()),
     m_nextSeq (sock.m_nextTxSequence),
     m_ceState (false),
-    m_deadline (Seconds (-1))
+    m_deadline (sock.m_deadline)
 {
   NS_LOG_FUNCTION (this);
   NS_LOG_LOGIC ("Invoked the copy constructor");
@@ -101,6 +92,15 @@ Dctcp::~Dctcp (void)
 {
 }
 
+void
+Dctcp::NotifyConstructionCompleted (void)
+{
+  TcpNewReno::NotifyConstructionCompleted ();
+  ObjectFactory factory;
+  factory.SetTypeId (m_controlType);
+  m_control = factory.Create<DctcpControl> ();
+}
+
 Ptr<TcpSocketBase>
 Dctcp::Fork (void)
 {
@@ -118,37 +118,24 @@ Dctcp::DoForwardUp (Ptr<Packet> packet, Ipv4Header header, uint16_t port,
   /* Check if the IP Header encountered congestion */
   CheckCe (header);
 
-  /* Check for ECE, which signals congestions */
-  TcpHeader tcpHeader;
-  packet->PeekHeader (tcpHeader);
-  if ((tcpHeader.GetFlags () & TcpHeader::ECE) || tcpHeader.GetEce ())
+  /* Check for ECE, which signals congestions.  The flags are the 14th
+   * byte of the TCP header, so there is no need to deserialize it. */
+  if (packet->PeekU8 (13) & TcpHeader::ECE)
     {
       // Peer echoed ECN. Reduce window
       NS_LOG_LOGIC ("Received a peer echoed ECN. Reducing window.");
 
-      uint32_t scale;
+      uint32_t scale = m_control->GetPenalty ();
       uint32_t ssThreshOld;
       uint32_t cWndOld;
 
-      if (m_deadline.IsPositive ())
-        {
-          scale = static_cast<uint32_t> (std::pow((double)m_alpha, m_gamma));
-          NS_LOG_LOGIC ("Gamma scaling alpha from " << m_alpha << " to " << scale);
-        }
-      else
-        {
-          scale = m_alpha;
-        }
-      if (scale > 1024)
-        scale = 1024;
-
       cWndOld = m_cWnd;
       m_cWnd = std::max (2 * m_segmentSize, cWndOld - ((cWndOld * scale)>>11));
       ssThreshOld = m_ssThresh;
       ssThreshOld = ssThreshOld; //XXX: Damn compilers not caring about log info
       m_ssThresh = m_cWnd;
 
-      NS_LOG_INFO ("Updated cwnd and ssthresh.  alpha=" << m_alpha <<
+      NS_LOG_INFO ("Updated cwnd and ssthresh.  alpha=" << m_control->GetAlpha () << ", scale=" << scale <<
         ", cwnd old=" << cWndOld << ", cwnd new=" << m_cWnd <<
         ", ssthresh old=" << ssThreshOld << ", ssthresh new=" << m_ssThresh);
     }
@@ -183,70 +170,12 @@ Dctcp::ReceivedAck (Ptr<Packet> packet, const TcpHeader& t)
       NS_LOG_LOGIC ("New Ack of " << ackedBytes << " bytes");
     }
 
-  /* Update byte counts */
-  if ((t.GetFlags () & TcpHeader::ECE) || t.GetEce ())
-    {
-      m_ackedBytesEcn += ackedBytes;
-    }
-  m_ackedBytesTotal += ackedBytes;
-  NS_LOG_DEBUG("bytesEcn=" << m_ackedBytesEcn << ", bytesTotal=" << m_ackedBytesTotal);
+  m_control->Acked (ackedBytes, (t.GetFlags () & TcpHeader::ECE) || t.GetEce ());
 
   /* Expired RTT */
   if (!(t.GetAckNumber () < m_nextSeq))
     {
-      /* For avoiding denominator == 1 */
-      if (m_ackedBytesTotal == 0) m_ackedBytesTotal = 1;
-
-      uint32_t alphaOld = m_alpha; 
-
-      /* alpha = (1-g) * alpha + g * F */
-      m_alpha = alphaOld - (alphaOld >> m_shiftG)
-        + (m_ackedBytesEcn << (10 - m_shiftG)) / m_ackedBytesTotal;  
-      
-      if (m_alpha > 1024) m_alpha = 1024; /* round to 0-1024 */
-
-      NS_LOG_INFO("bytesEcn=" << m_ackedBytesEcn << ", bytesTotal=" <<
-        m_ackedBytesTotal << ", alpha: old=" << alphaOld << ", new=" << m_alpha);
-
-      if (m_deadline.IsPositive ())
-        {
-          double gammaOld = m_gamma;
-          double m_tc1, m_tc2;
-          double newgamma, gamma1, gamma2;
-          uint32_t cWnd_mss = m_cWnd / m_segmentSize;
-          int64_t remaining = ((m_deadline - Simulator::Now ()).GetInteger ()/m_rtt->GetCurrentEstimate ().GetInteger ()) - 1;
-          
-          m_tc1 = std::sqrt( std::pow(((double)cWnd_mss + 1.0)/2.0,2.0) + 2.0 * (double)m_segmentSize) - ((double)cWnd_mss + 1.0)/2.0;
-          if (remaining > 0 && m_tc1 > 0.0)
-            gamma1 = m_tc1 / (double) remaining;
-          else
-            gamma1 = 0.0;
-          
-          m_tc2 = (double)m_segmentSize / (3.0 * (double)cWnd_mss / 4.0 + 0.5);
-          if (remaining > 0 && m_tc2 > 0.0)
-            gamma2 = m_tc2 / (double) remaining;
-          else
-            gamma2 = 0.0;
-          
-          newgamma = std::max(gamma1, gamma2);
-          m_gamma = ((1 - 1/(1<<m_shiftGamma)) * m_gamma) + (1/(1<<m_shiftGamma) * newgamma);
-          // Cap m_gamma
-          if (m_gamma <= 0.4)
-            m_gamma = 0.4;
-          else if (m_gamma >= 2.0)
-            m_gamma = 2.0;
-
-          NS_LOG_INFO("Time remaining: " << (m_deadline - Simulator::Now ()) <<
-            ", gammaOld: " << gammaOld << ", m_gamma: " << m_gamma);
-          gammaOld = gammaOld;
-        }
-      else
-        {
-          NS_ASSERT (m_gamma == 1);
-        }
-      
-      m_ackedBytesEcn = 0;
-      m_ackedBytesTotal = 0;
+      m_control->Update (m_cWnd, m_segmentSize, m_deadline, m_rtt->GetCurrentEstimate ());
       m_nextSeq = m_nextTxSequence;
     }
 
@@ -22,6 +22,7 @@
 #define DCTCP_H
 
 #include "tcp-newreno.h"
+#include "dctcp-control.h"
 
 namespace ns3 {
 
@@ -31,7 +32,11 @@ namespace ns3 {
  *
  * \brief An implementation of a stream socket using TCP.
  *
- * This class contains the NewReno implementation of TCP, as of RFC2582.
+ * This class contains the DCTCP extensions to NewReno: the receiver
+ * echoes CE marks with ECE, and the sender cuts its window in
+ * proportion to the fraction of marked bytes. The estimate and the
+ * size of the cut come from a DctcpControl, picked by ControlType;
+ * D2tcpControl makes the cut depend on the flow's Deadline.
  */
 class Dctcp : public TcpNewReno
 {
@@ -49,6 +54,7 @@ protected:
   virtual void DoForwardUp (Ptr<Packet> packet, Ipv4Header header, uint16_t port, Ptr<Ipv4Interface> incomingInterface);
   virtual void ReceivedAck (Ptr<Packet> packet, const TcpHeader& t); // Received an ACK packet
   virtual void AddOptions (TcpHeader& h);
+  virtual void NotifyConstructionCompleted (void);
 
 private:
   void CheckCe (Ipv4Header header);
@@ -56,15 +62,10 @@ private:
   bool               m_ece; // Should send ECE flag
   bool               m_cwr; // Should send CWR flag
 
-  /* DCTCP Specific Parameters from the linux patch */
-  uint32_t           m_ackedBytesEcn;
-  uint32_t           m_ackedBytesTotal;
-  uint32_t           m_alpha;
-  double             m_gamma;
+  TypeId             m_controlType;
+  Ptr<DctcpControl>  m_control; // alpha and the window penalty
   SequenceNumber32   m_nextSeq;
   bool               m_ceState; /* false: last pkt was non-ce , true: last pkt was ce */
-  uint32_t           m_shiftG;
-  uint32_t           m_shiftGamma;
   Time               m_deadline;
 };
 
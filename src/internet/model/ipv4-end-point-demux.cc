@@ -18,6 +18,7 @@
  * Author: Mathieu Lacage <mathieu.lacage@sophia.inria.fr>
  */
 
+#include <algorithm>
 #include "ipv4-end-point-demux.h"
 #include "ipv4-end-point.h"
 #include "ns3/log.h"
@@ -26,8 +27,41 @@ namespace ns3 {
 
 NS_LOG_COMPONENT_DEFINE ("Ipv4EndPointDemux");
 
+Ipv4EndPointDemux::FourTuple::FourTuple (Ipv4Address localAddr, uint16_t localPort,
+                                         Ipv4Address peerAddr, uint16_t peerPort)
+  : localAddr (localAddr),
+    peerAddr (peerAddr),
+    localPort (localPort),
+    peerPort (peerPort)
+{
+}
+
+bool
+Ipv4EndPointDemux::FourTuple::operator == (const FourTuple &o) const
+{
+  return localPort == o.localPort && peerPort == o.peerPort &&
+         localAddr == o.localAddr && peerAddr == o.peerAddr;
+}
+
+size_t
+Ipv4EndPointDemux::FourTupleHash::operator() (const FourTuple &t) const
+{
+  uint32_t h = t.peerAddr.Get () * 2654435761U;
+  h ^= t.localAddr.Get () + 0x9e3779b9 + (h << 6) + (h >> 2);
+  h ^= (uint32_t (t.localPort) << 16 | t.peerPort) + 0x9e3779b9 + (h << 6) + (h >> 2);
+  return h;
+}
+
+bool
+Ipv4EndPointDemux::AllocatedBefore (Ipv4EndPoint *a, Ipv4EndPoint *b)
+{
+  return a->m_allocation < b->m_allocation;
+}
+
 Ipv4EndPointDemux::Ipv4EndPointDemux ()
-  : m_ephemeral (49152), m_portLast (65535), m_portFirst (49152)
+  : m_ephemeral (49152), m_portLast (65535), m_portFirst (49152),
+    m_allocations (0),
+    m_ephemeralInUse ((m_portLast - m_portFirst + 64) / 64, 0)
 {
   NS_LOG_FUNCTION_NOARGS ();
 }
@@ -35,36 +69,36 @@ Ipv4EndPointDemux::Ipv4EndPointDemux ()
 Ipv4EndPointDemux::~Ipv4EndPointDemux ()
 {
   NS_LOG_FUNCTION_NOARGS ();
-  for (EndPointsI i = m_endPoints.begin (); i != m_endPoints.end (); i++) 
+  for (Allocations::iterator i = m_endPoints.begin (); i != m_endPoints.end (); i++) 
     {
-      Ipv4EndPoint *endPoint = *i;
+      Ipv4EndPoint *endPoint = i->second;
+      endPoint->m_demux = 0;
       delete endPoint;
     }
   m_endPoints.clear ();
+  m_tuples.clear ();
+  m_ports.clear ();
 }
 
 bool
 Ipv4EndPointDemux::LookupPortLocal (uint16_t port)
 {
   NS_LOG_FUNCTION_NOARGS ();
-  for (EndPointsI i = m_endPoints.begin (); i != m_endPoints.end (); i++) 
-    {
-      if ((*i)->GetLocalPort  () == port) 
-        {
-          return true;
-        }
-    }
-  return false;
+  return m_ports.find (port) != m_ports.end ();
 }
 
 bool
 Ipv4EndPointDemux::LookupLocal (Ipv4Address addr, uint16_t port)
 {
   NS_LOG_FUNCTION_NOARGS ();
-  for (EndPointsI i = m_endPoints.begin (); i != m_endPoints.end (); i++) 
+  PortIndex::iterator endPoints = m_ports.find (port);
+  if (endPoints == m_ports.end ())
     {
-      if ((*i)->GetLocalPort () == port &&
-          (*i)->GetLocalAddress () == addr) 
+      return false;
+    }
+  for (Allocations::iterator i = endPoints->second.begin (); i != endPoints->second.end (); i++) 
+    {
+      if (i->second->GetLocalAddress () == addr) 
         {
           return true;
         }
@@ -82,10 +116,7 @@ Ipv4EndPointDemux::Allocate (void)
       NS_LOG_WARN ("Ephemeral port allocation failed.");
       return 0;
     }
-  Ipv4EndPoint *endPoint = new Ipv4EndPoint (Ipv4Address::GetAny (), port);
-  m_endPoints.push_back (endPoint);
-  NS_LOG_DEBUG ("Now have >>" << m_endPoints.size () << "<< endpoints.");
-  return endPoint;
+  return Insert (new Ipv4EndPoint (Ipv4Address::GetAny (), port));
 }
 
 Ipv4EndPoint *
@@ -98,10 +129,7 @@ Ipv4EndPointDemux::Allocate (Ipv4Address address)
       NS_LOG_WARN ("Ephemeral port allocation failed.");
       return 0;
     }
-  Ipv4EndPoint *endPoint = new Ipv4EndPoint (address, port);
-  m_endPoints.push_back (endPoint);
-  NS_LOG_DEBUG ("Now have >>" << m_endPoints.size () << "<< endpoints.");
-  return endPoint;
+  return Insert (new Ipv4EndPoint (address, port));
 }
 
 Ipv4EndPoint *
@@ -121,10 +149,7 @@ Ipv4EndPointDemux::Allocate (Ipv4Address address, uint16_t port)
       NS_LOG_WARN ("Duplicate address/port; failing.");
       return 0;
     }
-  Ipv4EndPoint *endPoint = new Ipv4EndPoint (address, port);
-  m_endPoints.push_back (endPoint);
-  NS_LOG_DEBUG ("Now have >>" << m_endPoints.size () << "<< endpoints.");
-  return endPoint;
+  return Insert (new Ipv4EndPoint (address, port));
 }
 
 Ipv4EndPoint *
@@ -132,24 +157,32 @@ Ipv4EndPointDemux::Allocate (Ipv4Address localAddress, uint16_t localPort,
                              Ipv4Address peerAddress, uint16_t peerPort)
 {
   NS_LOG_FUNCTION (this << localAddress << localPort << peerAddress << peerPort);
-  for (EndPointsI i = m_endPoints.begin (); i != m_endPoints.end (); i++) 
+  if (m_tuples.find (FourTuple (localAddress, localPort, peerAddress, peerPort)) != m_tuples.end ())
     {
-      if ((*i)->GetLocalPort () == localPort &&
-          (*i)->GetLocalAddress () == localAddress &&
-          (*i)->GetPeerPort () == peerPort &&
-          (*i)->GetPeerAddress () == peerAddress) 
-        {
-          NS_LOG_WARN ("No way we can allocate this end-point.");
-          /* no way we can allocate this end-point. */
-          return 0;
-        }
+      NS_LOG_WARN ("No way we can allocate this end-point.");
+      /* no way we can allocate this end-point. */
+      return 0;
     }
   Ipv4EndPoint *endPoint = new Ipv4EndPoint (localAddress, localPort);
   endPoint->SetPeer (peerAddress, peerPort);
-  m_endPoints.push_back (endPoint);
+  return Insert (endPoint);
+}
 
+Ipv4EndPoint *
+Ipv4EndPointDemux::Insert (Ipv4EndPoint *endPoint)
+{
+  NS_LOG_FUNCTION (this << endPoint);
+  endPoint->m_demux = this;
+  endPoint->m_allocation = m_allocations++;
+  m_endPoints[endPoint->m_allocation] = endPoint;
+  Allocations &port = m_ports[endPoint->GetLocalPort ()];
+  if (port.empty ())
+    {
+      MarkPort (endPoint->GetLocalPort (), true);
+    }
+  port[endPoint->m_allocation] = endPoint;
+  Index (endPoint);
   NS_LOG_DEBUG ("Now have >>" << m_endPoints.size () << "<< endpoints.");
-
   return endPoint;
 }
 
@@ -157,14 +190,59 @@ void
 Ipv4EndPointDemux::DeAllocate (Ipv4EndPoint *endPoint)
 {
   NS_LOG_FUNCTION_NOARGS ();
-  for (EndPointsI i = m_endPoints.begin (); i != m_endPoints.end (); i++) 
+  if (endPoint->m_demux != this)
     {
-      if (*i == endPoint)
-        {
-          delete endPoint;
-          m_endPoints.erase (i);
-          break;
-        }
+      return;
+    }
+  Unindex (endPoint);
+  PortIndex::iterator port = m_ports.find (endPoint->GetLocalPort ());
+  port->second.erase (endPoint->m_allocation);
+  if (port->second.empty ())
+    {
+      m_ports.erase (port);
+      MarkPort (endPoint->GetLocalPort (), false);
+    }
+  m_endPoints.erase (endPoint->m_allocation);
+  endPoint->m_demux = 0;
+  delete endPoint;
+}
+
+void
+Ipv4EndPointDemux::Index (Ipv4EndPoint *endPoint)
+{
+  Bucket &bucket = m_tuples[FourTuple (endPoint->GetLocalAddress (), endPoint->GetLocalPort (),
+                                       endPoint->GetPeerAddress (), endPoint->GetPeerPort ())];
+  bucket.insert (std::upper_bound (bucket.begin (), bucket.end (), endPoint, AllocatedBefore), endPoint);
+}
+
+void
+Ipv4EndPointDemux::Unindex (Ipv4EndPoint *endPoint)
+{
+  TupleIndex::iterator i = m_tuples.find (FourTuple (endPoint->GetLocalAddress (), endPoint->GetLocalPort (),
+                                                     endPoint->GetPeerAddress (), endPoint->GetPeerPort ()));
+  NS_ASSERT (i != m_tuples.end ());
+  i->second.erase (std::find (i->second.begin (), i->second.end (), endPoint));
+  if (i->second.empty ())
+    {
+      m_tuples.erase (i);
+    }
+}
+
+void
+Ipv4EndPointDemux::MarkPort (uint16_t port, bool inUse)
+{
+  if (port < m_portFirst || port > m_portLast)
+    {
+      return;
+    }
+  uint32_t bit = port - m_portFirst;
+  if (inUse)
+    {
+      m_ephemeralInUse[bit / 64] |= uint64_t (1) << (bit % 64);
+    }
+  else
+    {
+      m_ephemeralInUse[bit / 64] &= ~(uint64_t (1) << (bit % 64));
     }
 }
 
@@ -177,14 +255,39 @@ Ipv4EndPointDemux::GetAllEndPoints (void)
   NS_LOG_FUNCTION_NOARGS ();
   EndPoints ret;
 
-  for (EndPointsI i = m_endPoints.begin (); i != m_endPoints.end (); i++)
+  for (Allocations::iterator i = m_endPoints.begin (); i != m_endPoints.end (); i++)
     {
-      Ipv4EndPoint* endP = *i;
+      Ipv4EndPoint* endP = i->second;
       ret.push_back (endP);
     }
   return ret;
 }
 
+bool
+Ipv4EndPointDemux::AddMatches (const FourTuple &tuple, Ptr<NetDevice> device, EndPoints &endPoints)
+{
+  TupleIndex::iterator bucket = m_tuples.find (tuple);
+  if (bucket == m_tuples.end ())
+    {
+      return false;
+    }
+  bool added = false;
+  for (Bucket::iterator i = bucket->second.begin (); i != bucket->second.end (); i++)
+    {
+      Ipv4EndPoint* endP = *i;
+      if (endP->GetBoundNetDevice () && endP->GetBoundNetDevice () != device)
+        {
+          NS_LOG_LOGIC ("Skipping endpoint " << &endP
+                                             << " because endpoint is bound to specific device and"
+                                             << endP->GetBoundNetDevice ()
+                                             << " does not match packet device " << device);
+          continue;
+        }
+      endPoints.push_back (endP);
+      added = true;
+    }
+  return added;
+}
 
 /*
  * If we have an exact match, we return it.
@@ -204,21 +307,48 @@ Ipv4EndPointDemux::Lookup (Ipv4Address daddr, uint16_t dport,
 
   NS_LOG_FUNCTION (this << daddr << dport << saddr << sport << incomingInterface);
   NS_LOG_DEBUG ("Looking up endpoint for destination address " << daddr);
-  for (EndPointsI i = m_endPoints.begin (); i != m_endPoints.end (); i++) 
+  PortIndex::iterator port = m_ports.find (dport);
+  if (port == m_ports.end ())
     {
-      Ipv4EndPoint* endP = *i;
+      NS_LOG_LOGIC ("No endpoint on packet dport " << dport);
+      return retval1;
+    }
+
+  bool subnetDirected = false;
+  Ipv4Address incomingInterfaceAddr = daddr;  // may be a broadcast
+  for (uint32_t i = 0; i < incomingInterface->GetNAddresses (); i++)
+    {
+      Ipv4InterfaceAddress addr = incomingInterface->GetAddress (i);
+      if (addr.GetLocal ().CombineMask (addr.GetMask ()) == daddr.CombineMask (addr.GetMask ()) &&
+          daddr.IsSubnetDirectedBroadcast (addr.GetMask ()))
+        {
+          subnetDirected = true;
+          incomingInterfaceAddr = addr.GetLocal ();
+        }
+    }
+  bool isBroadcast = (daddr.IsBroadcast () || subnetDirected == true);
+  NS_LOG_DEBUG ("dest addr " << daddr << " broadcast? " << isBroadcast);
+
+  if (!isBroadcast)
+    {
+      // Each class of match is a single four-tuple, so probe them from
+      // the most exact one.  Wildcard listeners only get the packet when
+      // no listener is bound to daddr.
+      Ptr<NetDevice> device = incomingInterface->GetDevice ();
+      if (AddMatches (FourTuple (daddr, dport, saddr, sport), device, retval4)) return retval4;
+      if (AddMatches (FourTuple (Ipv4Address::GetAny (), dport, saddr, sport), device, retval3)) return retval3;
+      if (AddMatches (FourTuple (daddr, dport, Ipv4Address::GetAny (), 0), device, retval2)) return retval2;
+      AddMatches (FourTuple (Ipv4Address::GetAny (), dport, Ipv4Address::GetAny (), 0), device, retval1);
+      return retval1;  // might be empty if no matches
+    }
+
+  for (Allocations::iterator i = port->second.begin (); i != port->second.end (); i++) 
+    {
+      Ipv4EndPoint* endP = i->second;
       NS_LOG_DEBUG ("Looking at endpoint dport=" << endP->GetLocalPort ()
                                                  << " daddr=" << endP->GetLocalAddress ()
                                                  << " sport=" << endP->GetPeerPort ()
                                                  << " saddr=" << endP->GetPeerAddress ());
-      if (endP->GetLocalPort () != dport) 
-        {
-          NS_LOG_LOGIC ("Skipping endpoint " << &endP
-                                             << " because endpoint dport "
-                                             << endP->GetLocalPort ()
-                                             << " does not match packet dport " << dport);
-          continue;
-        }
       if (endP->GetBoundNetDevice ())
         {
           if (endP->GetBoundNetDevice () != incomingInterface->GetDevice ())
@@ -230,30 +360,13 @@ Ipv4EndPointDemux::Lookup (Ipv4Address daddr, uint16_t dport,
               continue;
             }
         }
-      bool subnetDirected = false;
-      Ipv4Address incomingInterfaceAddr = daddr;  // may be a broadcast
-      for (uint32_t i = 0; i < incomingInterface->GetNAddresses (); i++)
-        {
-          Ipv4InterfaceAddress addr = incomingInterface->GetAddress (i);
-          if (addr.GetLocal ().CombineMask (addr.GetMask ()) == daddr.CombineMask (addr.GetMask ()) &&
-              daddr.IsSubnetDirectedBroadcast (addr.GetMask ()))
-            {
-              subnetDirected = true;
-              incomingInterfaceAddr = addr.GetLocal ();
-            }
-        }
-      bool isBroadcast = (daddr.IsBroadcast () || subnetDirected == true);
-      NS_LOG_DEBUG ("dest addr " << daddr << " broadcast? " << isBroadcast);
       bool localAddressMatchesWildCard = 
         endP->GetLocalAddress () == Ipv4Address::GetAny ();
       bool localAddressMatchesExact = endP->GetLocalAddress () == daddr;
 
-      if (isBroadcast)
-        {
-          NS_LOG_DEBUG ("Found bcast, localaddr " << endP->GetLocalAddress ());
-        }
+      NS_LOG_DEBUG ("Found bcast, localaddr " << endP->GetLocalAddress ());
 
-      if (isBroadcast && (endP->GetLocalAddress () != Ipv4Address::GetAny ()))
+      if (endP->GetLocalAddress () != Ipv4Address::GetAny ())
         {
           localAddressMatchesExact = (endP->GetLocalAddress () ==
                                       incomingInterfaceAddr);
@@ -280,7 +393,7 @@ Ipv4EndPointDemux::Lookup (Ipv4Address daddr, uint16_t dport,
         { // Only local port matches exactly
           retval1.push_back (endP);
         }
-      if ((localAddressMatchesExact || (isBroadcast && localAddressMatchesWildCard))&&
+      if ((localAddressMatchesExact || localAddressMatchesWildCard) &&
           remotePeerMatchesWildCard &&
           remoteAddressMatchesWildCard)
         { // Only local port and local address matches exactly
@@ -313,35 +426,35 @@ Ipv4EndPointDemux::SimpleLookup (Ipv4Address daddr,
                                  Ipv4Address saddr, 
                                  uint16_t sport)
 {
+  TupleIndex::iterator exact = m_tuples.find (FourTuple (daddr, dport, saddr, sport));
+  if (exact != m_tuples.end ())
+    {
+      /* this is an exact match. */
+      return exact->second.front ();
+    }
+  PortIndex::iterator port = m_ports.find (dport);
+  if (port == m_ports.end ())
+    {
+      return 0;
+    }
   // this code is a copy/paste version of an old BSD ip stack lookup
   // function.
   uint32_t genericity = 3;
   Ipv4EndPoint *generic = 0;
-  for (EndPointsI i = m_endPoints.begin (); i != m_endPoints.end (); i++) 
+  for (Allocations::iterator i = port->second.begin (); i != port->second.end () && genericity > 0; i++) 
     {
-      if ((*i)->GetLocalPort () != dport) 
-        {
-          continue;
-        }
-      if ((*i)->GetLocalAddress () == daddr &&
-          (*i)->GetPeerPort () == sport &&
-          (*i)->GetPeerAddress () == saddr) 
-        {
-          /* this is an exact match. */
-          return *i;
-        }
       uint32_t tmp = 0;
-      if ((*i)->GetLocalAddress () == Ipv4Address::GetAny ()) 
+      if (i->second->GetLocalAddress () == Ipv4Address::GetAny ()) 
         {
           tmp++;
         }
-      if ((*i)->GetPeerAddress () == Ipv4Address::GetAny ()) 
+      if (i->second->GetPeerAddress () == Ipv4Address::GetAny ()) 
         {
           tmp++;
         }
       if (tmp < genericity) 
         {
-          generic = (*i);
+          generic = i->second;
           genericity = tmp;
         }
     }
@@ -350,25 +463,30 @@ Ipv4EndPointDemux::SimpleLookup (Ipv4Address daddr,
 uint16_t
 Ipv4EndPointDemux::AllocateEphemeralPort (void)
 {
-  // Similar to counting up logic in netinet/in_pcb.c
+  // Similar to counting up logic in netinet/in_pcb.c, with the ports in
+  // use kept in a bitmap so that whole words of them are skipped at once
   NS_LOG_FUNCTION_NOARGS ();
-  uint16_t port = m_ephemeral;
-  int count = m_portLast - m_portFirst;
-  do 
+  uint32_t range = m_portLast - m_portFirst + 1;
+  uint32_t bit = m_ephemeral - m_portFirst;
+  uint32_t count = 0;
+  while (count < range)
     {
-      if (count-- < 0)
+      bit = bit + 1 < range ? bit + 1 : 0;
+      uint64_t word = m_ephemeralInUse[bit / 64];
+      if (bit % 64 == 0 && word == ~uint64_t (0) && count + 64 <= range)
         {
-          return 0;
+          bit += 63;
+          count += 64;
+          continue;
         }
-      ++port;
-      if (port < m_portFirst || port > m_portLast)
+      count++;
+      if ((word & (uint64_t (1) << (bit % 64))) == 0)
         {
-          port = m_portFirst;
+          m_ephemeral = m_portFirst + bit;
+          return m_ephemeral;
         }
-    } while (LookupPortLocal (port));
-  m_ephemeral = port;
-  return port;
+    }
+  return 0;
 }
 
 } // namespace ns3
-
@@ -23,7 +23,10 @@
 
 #include <stdint.h>
 #include <list>
+#include <map>
+#include <vector>
 #include "ns3/ipv4-address.h"
+#include "ns3/sgi-hashmap.h"
 #include "ipv4-interface.h"
 
 namespace ns3 {
@@ -38,6 +41,15 @@ class Ipv4EndPoint;
  * of endpoints, and has APIs to add and find endpoints in this demux.  This
  * code is shared in common to TCP and UDP protocols in ns3.  This demux
  * sits between ns3's layer four and the socket layer
+ *
+ * Endpoints are indexed by their four-tuple, with wildcards stored as
+ * such, so that a unicast lookup probes at most four hash buckets: the
+ * exact match, the match on all but the local address, and the two
+ * listener tuples.  Endpoints are also indexed by local port, for the
+ * broadcast lookups and port queries, and a bitmap tracks the ephemeral
+ * ports in use.  Endpoints tell their demux when their addresses change,
+ * and every list handed out is in allocation order, as with the single
+ * list this replaces.
  */
 
 class Ipv4EndPointDemux {
@@ -74,12 +86,49 @@ public:
   void DeAllocate (Ipv4EndPoint *endPoint);
 
 private:
+  friend class Ipv4EndPoint;
+
+  struct FourTuple
+  {
+    FourTuple (Ipv4Address localAddr, uint16_t localPort, Ipv4Address peerAddr, uint16_t peerPort);
+    bool operator == (const FourTuple &o) const;
+
+    Ipv4Address localAddr;
+    Ipv4Address peerAddr;
+    uint16_t localPort;
+    uint16_t peerPort;
+  };
+  struct FourTupleHash
+  {
+    size_t operator() (const FourTuple &t) const;
+  };
+  // Endpoints keyed by their allocation number, hence in allocation order
+  typedef std::map<uint64_t, Ipv4EndPoint *> Allocations;
+  // Endpoints sharing a four-tuple, in allocation order
+  typedef std::vector<Ipv4EndPoint *> Bucket;
+  typedef sgi::hash_map<FourTuple, Bucket, FourTupleHash> TupleIndex;
+  typedef std::map<uint16_t, Allocations> PortIndex;
+
   uint16_t AllocateEphemeralPort (void);
+  Ipv4EndPoint *Insert (Ipv4EndPoint *endPoint);
+  void MarkPort (uint16_t port, bool inUse);
+  // Appends the endpoints of tuple that accept packets from device
+  bool AddMatches (const FourTuple &tuple, Ptr<NetDevice> device, EndPoints &endPoints);
+
+  static bool AllocatedBefore (Ipv4EndPoint *a, Ipv4EndPoint *b);
+
+  // Called by the endpoints around a change of their four-tuple
+  void Index (Ipv4EndPoint *endPoint);
+  void Unindex (Ipv4EndPoint *endPoint);
 
   uint16_t m_ephemeral;
   uint16_t m_portLast;
   uint16_t m_portFirst;
-  EndPoints m_endPoints;
+  uint64_t m_allocations;
+  Allocations m_endPoints;
+  TupleIndex m_tuples;
+  PortIndex m_ports;
+  std::vector<uint64_t> m_ephemeralInUse;    //< One bit per ephemeral port
 };
 
 } // namespace ns3
@@ -19,6 +19,7 @@
  */
 
 #include "ipv4-end-point.h"
+#include "ipv4-end-point-demux.h"
 #include "ns3/packet.h"
 #include "ns3/log.h"
 #include "ns3/simulator.h"
@@ -31,7 +32,9 @@ Ipv4EndPoint::Ipv4EndPoint (Ipv4Address address, uint16_t port)
   : m_localAddr (address), 
     m_localPort (port),
     m_peerAddr (Ipv4Address::GetAny ()),
-    m_peerPort (0)
+    m_peerPort (0),
+    m_demux (0),
+    m_allocation (0)
 {
 }
 Ipv4EndPoint::~Ipv4EndPoint ()
@@ -43,6 +46,11 @@ Ipv4EndPoint::~Ipv4EndPoint ()
   m_rxCallback.Nullify ();
   m_icmpCallback.Nullify ();
   m_destroyCallback.Nullify ();
+  // Deliveries scheduled before the endpoint went away must not run
+  for (std::list<EventId>::iterator i = m_deferred.begin (); i != m_deferred.end (); ++i)
+    {
+      i->Cancel ();
+    }
 }
 
 Ipv4Address 
@@ -54,7 +62,15 @@ Ipv4EndPoint::GetLocalAddress (void)
 void 
 Ipv4EndPoint::SetLocalAddress (Ipv4Address address)
 {
+  if (m_demux != 0)
+    {
+      m_demux->Unindex (this);
+    }
   m_localAddr = address;
+  if (m_demux != 0)
+    {
+      m_demux->Index (this);
+    }
 }
 
 uint16_t 
@@ -75,8 +91,16 @@ Ipv4EndPoint::GetPeerPort (void)
 void 
 Ipv4EndPoint::SetPeer (Ipv4Address address, uint16_t port)
 {
+  if (m_demux != 0)
+    {
+      m_demux->Unindex (this);
+    }
   m_peerAddr = address;
   m_peerPort = port;
+  if (m_demux != 0)
+    {
+      m_demux->Index (this);
+    }
 }
 
 void
@@ -115,8 +139,8 @@ Ipv4EndPoint::ForwardUp (Ptr<Packet> p, const Ipv4Header& header, uint16_t sport
 {
   if (!m_rxCallback.IsNull ())
     {
-      Simulator::ScheduleNow (&Ipv4EndPoint::DoForwardUp, this, p, header, sport, 
-                              incomingInterface);
+      Defer (Simulator::ScheduleNow (&Ipv4EndPoint::DoForwardUp, this, p, header, sport,
+                                     incomingInterface));
     }
 }
 void 
@@ -138,8 +162,8 @@ Ipv4EndPoint::ForwardIcmp (Ipv4Address icmpSource, uint8_t icmpTtl,
                    (uint32_t)icmpCode << icmpInfo);
   if (!m_icmpCallback.IsNull ())
     {
-      Simulator::ScheduleNow (&Ipv4EndPoint::DoForwardIcmp, this, 
-                              icmpSource, icmpTtl, icmpType, icmpCode, icmpInfo);
+      Defer (Simulator::ScheduleNow (&Ipv4EndPoint::DoForwardIcmp, this,
+                                     icmpSource, icmpTtl, icmpType, icmpCode, icmpInfo));
     }
 }
 void 
@@ -153,4 +177,15 @@ Ipv4EndPoint::DoForwardIcmp (Ipv4Address icmpSource, uint8_t icmpTtl,
     }
 }
 
+void
+Ipv4EndPoint::Defer (EventId event)
+{
+  // Forget the deliveries that already ran
+  while (!m_deferred.empty () && m_deferred.front ().IsExpired ())
+    {
+      m_deferred.pop_front ();
+    }
+  m_deferred.push_back (event);
+}
+
 } // namespace ns3
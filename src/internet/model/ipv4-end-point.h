@@ -22,8 +22,10 @@
 #define IPV4_END_POINT_H
 
 #include <stdint.h>
+#include <list>
 #include "ns3/ipv4-address.h"
 #include "ns3/callback.h"
+#include "ns3/event-id.h"
 #include "ns3/net-device.h"
 #include "ns3/ipv4-header.h"
 #include "ns3/ipv4-interface.h"
@@ -32,6 +34,7 @@ namespace ns3 {
 
 class Header;
 class Packet;
+class Ipv4EndPointDemux;
 
 /**
  * \brief A representation of an internet endpoint/connection
@@ -76,11 +79,14 @@ public:
                     uint32_t icmpInfo);
 
 private:
+  friend class Ipv4EndPointDemux;
+
   void DoForwardUp (Ptr<Packet> p, const Ipv4Header& header, uint16_t sport,
                     Ptr<Ipv4Interface> incomingInterface);
   void DoForwardIcmp (Ipv4Address icmpSource, uint8_t icmpTtl, 
                       uint8_t icmpType, uint8_t icmpCode,
                       uint32_t icmpInfo);
+  void Defer (EventId event);
   Ipv4Address m_localAddr;
   uint16_t m_localPort;
   Ipv4Address m_peerAddr;
@@ -89,6 +95,9 @@ private:
   Callback<void,Ptr<Packet>, Ipv4Header, uint16_t, Ptr<Ipv4Interface> > m_rxCallback;
   Callback<void,Ipv4Address,uint8_t,uint8_t,uint8_t,uint32_t> m_icmpCallback;
   Callback<void> m_destroyCallback;
+  Ipv4EndPointDemux *m_demux;   // Demux indexing this endpoint, if any
+  uint64_t m_allocation;        // Allocation number within m_demux
+  std::list<EventId> m_deferred; // Deliveries not run yet, cancelled on destruction
 };
 
 } // namespace ns3
@@ -598,6 +598,7 @@ Ipv4L3Protocol::Send (Ptr<Packet> packet,
 
           m_sendOutgoingTrace (ipHeader, packetCopy, ifaceIndex);
           packetCopy->AddHeader (ipHeader);
+          packetCopy->SetNetworkHeaderMark ();
           m_txTrace (packetCopy, m_node->GetObject<Ipv4> (), ifaceIndex);
           outInterface->Send (packetCopy, destination);
         }
@@ -622,6 +623,7 @@ Ipv4L3Protocol::Send (Ptr<Packet> packet,
               Ptr<Packet> packetCopy = packet->Copy ();
               m_sendOutgoingTrace (ipHeader, packetCopy, ifaceIndex);
               packetCopy->AddHeader (ipHeader);
+              packetCopy->SetNetworkHeaderMark ();
               m_txTrace (packetCopy, m_node->GetObject<Ipv4> (), ifaceIndex);
               outInterface->Send (packetCopy, destination);
               return;
@@ -734,6 +736,7 @@ Ipv4L3Protocol::SendRealOut (Ptr<Ipv4Route> route,
       return;
     }
   packet->AddHeader (ipHeader);
+  packet->SetNetworkHeaderMark ();
   Ptr<NetDevice> outDev = route->GetOutputDevice ();
   int32_t interface = GetInterfaceForDevice (outDev);
   NS_ASSERT (interface >= 0);
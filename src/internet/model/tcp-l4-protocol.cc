@@ -87,7 +87,8 @@ TcpL4Protocol::GetTypeId (void)
 }
 
 TcpL4Protocol::TcpL4Protocol ()
-  : m_endPoints (new Ipv4EndPointDemux ()), m_endPoints6 (new Ipv6EndPointDemux ())
+  : m_endPoints (new Ipv4EndPointDemux ()), m_endPoints6 (new Ipv6EndPointDemux ()),
+    m_prototypeVersion (0)
 {
   NS_LOG_FUNCTION_NOARGS ();
   NS_LOG_LOGIC ("Made a TcpL4Protocol "<<this);
@@ -156,6 +157,8 @@ TcpL4Protocol::DoDispose (void)
 {
   NS_LOG_FUNCTION_NOARGS ();
   m_sockets.clear ();
+  m_socketPrototypes.clear ();
+  m_rttPrototype = 0;
 
   if (m_endPoints != 0)
     {
@@ -179,15 +182,32 @@ Ptr<Socket>
 TcpL4Protocol::CreateSocket (TypeId socketTypeId)
 {
   NS_LOG_FUNCTION_NOARGS ();
-  ObjectFactory rttFactory;
-  ObjectFactory socketFactory;
-  rttFactory.SetTypeId (m_rttTypeId);
-  socketFactory.SetTypeId (socketTypeId);
-  Ptr<RttEstimator> rtt = rttFactory.Create<RttEstimator> ();
-  Ptr<TcpSocketBase> socket = socketFactory.Create<TcpSocketBase> ();
+  // Run the attribute system once per type, and copy-construct the
+  // sockets and estimators from the result, the same way Fork does.
+  // Start over when the attribute defaults have changed since.
+  if (m_prototypeVersion != TypeId::GetInitialValueVersion ())
+    {
+      m_socketPrototypes.clear ();
+      m_rttPrototype = 0;
+      m_prototypeVersion = TypeId::GetInitialValueVersion ();
+    }
+  if (m_rttPrototype == 0 || m_rttPrototype->GetInstanceTypeId () != m_rttTypeId)
+    {
+      ObjectFactory rttFactory;
+      rttFactory.SetTypeId (m_rttTypeId);
+      m_rttPrototype = rttFactory.Create<RttEstimator> ();
+    }
+  Ptr<TcpSocketBase> &prototype = m_socketPrototypes[socketTypeId];
+  if (prototype == 0)
+    {
+      ObjectFactory socketFactory;
+      socketFactory.SetTypeId (socketTypeId);
+      prototype = socketFactory.Create<TcpSocketBase> ();
+    }
+  Ptr<TcpSocketBase> socket = prototype->Fork ();
   socket->SetNode (m_node);
   socket->SetTcp (this);
-  socket->SetRtt (rtt);
+  socket->SetRtt (m_rttPrototype->Copy ());
   return socket;
 }
 
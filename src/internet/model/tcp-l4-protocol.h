@@ -22,6 +22,7 @@
 #define TCP_L4_PROTOCOL_H
 
 #include <stdint.h>
+#include <map>
 
 #include "ns3/packet.h"
 #include "ns3/ipv4-address.h"
@@ -40,6 +41,7 @@ class Ipv4EndPointDemux;
 class Ipv6EndPointDemux;
 class Ipv4Interface;
 class TcpSocketBase;
+class RttEstimator;
 class Ipv4EndPoint;
 class Ipv6EndPoint;
 
@@ -70,6 +72,11 @@ public:
   /**
    * \return A smart Socket pointer to a TcpSocket allocated by this instance
    * of the TCP protocol
+   *
+   * The socket and its RTT estimator are copies of prototypes built
+   * through the attribute system on the first request for each type.
+   * The prototypes are built again once attribute defaults change, so
+   * sockets always start from the current defaults.
    */
   Ptr<Socket> CreateSocket (void);
   Ptr<Socket> CreateSocket (TypeId socketTypeId);
@@ -167,6 +174,11 @@ private:
   TcpL4Protocol (const TcpL4Protocol &o);
   TcpL4Protocol &operator = (const TcpL4Protocol &o);
 
+  typedef std::map<TypeId, Ptr<TcpSocketBase> > SocketPrototypes;
+  SocketPrototypes m_socketPrototypes;   //< Unconnected socket of each type, copied by CreateSocket
+  Ptr<RttEstimator> m_rttPrototype;      //< Fresh estimator of m_rttTypeId
+  uint32_t m_prototypeVersion;           //< TypeId::GetInitialValueVersion () the prototypes were built with
+
   std::vector<Ptr<TcpSocketBase> > m_sockets;
   IpL4Protocol::DownTargetCallback m_downTarget;
   IpL4Protocol::DownTargetCallback6 m_downTarget6;
@@ -217,15 +217,16 @@ TcpRxBuffer::Add (Ptr<Packet> p, TcpHeader const& tcph)
 }
 
 Ptr<Packet>
-TcpRxBuffer::Extract (uint32_t maxSize)
+TcpRxBuffer::Extract (uint32_t maxSize, bool virtualPayload)
 {
-  NS_LOG_FUNCTION (this << maxSize);
+  NS_LOG_FUNCTION (this << maxSize << virtualPayload);
 
   uint32_t extractSize = std::min (maxSize, m_availBytes);
   NS_LOG_LOGIC ("Requested to extract " << extractSize << " bytes from TcpRxBuffer of size=" << m_size);
   if (extractSize == 0) return 0;  // No contiguous block to return
   NS_ASSERT (m_data.size ()); // At least we have something to extract
   Ptr<Packet> outPkt = Create<Packet> (); // The packet that contains all the data to return
+  uint32_t extracted = 0;
   BufIterator i;
   while (extractSize)
     { // Check the buffered data for delivery
@@ -235,7 +236,11 @@ TcpRxBuffer::Extract (uint32_t maxSize)
       uint32_t pktSize = i->second->GetSize ();
       if (pktSize <= extractSize)
         { // Whole packet is extracted
-          outPkt->AddAtEnd (i->second);
+          if (!virtualPayload)
+            {
+              outPkt->AddAtEnd (i->second);
+            }
+          extracted += pktSize;
           m_data.erase (i);
           m_size -= pktSize;
           m_availBytes -= pktSize;
@@ -243,14 +248,26 @@ TcpRxBuffer::Extract (uint32_t maxSize)
         }
       else
         { // Partial is extracted and done
-          outPkt->AddAtEnd (i->second->CreateFragment (0, extractSize));
-          m_data[i->first + SequenceNumber32 (extractSize)] = i->second->CreateFragment (extractSize, pktSize - extractSize);
+          if (virtualPayload)
+            {
+              m_data[i->first + SequenceNumber32 (extractSize)] = Create<Packet> (pktSize - extractSize);
+            }
+          else
+            {
+              outPkt->AddAtEnd (i->second->CreateFragment (0, extractSize));
+              m_data[i->first + SequenceNumber32 (extractSize)] = i->second->CreateFragment (extractSize, pktSize - extractSize);
+            }
+          extracted += extractSize;
           m_data.erase (i);
           m_size -= extractSize;
           m_availBytes -= extractSize;
           extractSize = 0;
         }
     }
+  if (virtualPayload && extracted > 0)
+    {
+      outPkt = Create<Packet> (extracted);
+    }
   if (outPkt->GetSize () == 0)
     {
       NS_LOG_LOGIC ("Nothing extracted.");
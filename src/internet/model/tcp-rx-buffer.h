@@ -70,8 +70,10 @@ public:
   /**
    * Extract data from the head of the buffer as indicated by nextRxSeq.
    * The extracted data is going to be forwarded to the application.
+   * With virtualPayload, the received bytes are only counted and returned
+   * as a zero-filled packet of the same size, without merging segments.
    */
-  Ptr<Packet> Extract (uint32_t maxSize);
+  Ptr<Packet> Extract (uint32_t maxSize, bool virtualPayload = false);
 public:
   typedef std::map<SequenceNumber32, Ptr<Packet> >::iterator BufIterator;
   TracedValue<SequenceNumber32> m_nextRxSeq; //< Seqnum of the first missing byte in data (RCV.NXT)
@@ -46,6 +46,7 @@
 #include "tcp-l4-protocol.h"
 #include "ipv4-end-point.h"
 #include "ipv6-end-point.h"
+#include "ipv4-l3-protocol.h"
 #include "ipv6-l3-protocol.h"
 #include "tcp-header.h"
 #include "rtt-estimator.h"
@@ -94,6 +95,16 @@ TcpSocketBase::GetTypeId (void)
                    BooleanValue (false),
                    MakeBooleanAccessor (&TcpSocketBase::m_blocking),
                    MakeBooleanChecker ())
+    .AddAttribute ("BlockWeight",
+                   "Share of the socket when a device wakes blocked sockets in weighted order",
+                   DoubleValue (1.0),
+                   MakeDoubleAccessor (&TcpSocketBase::m_blockWeight),
+                   MakeDoubleChecker<double> (0))
+    .AddAttribute ("VirtualPayload",
+                   "Only count received bytes and hand them to the application as zero-filled packets",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&TcpSocketBase::m_virtualPayload),
+                   MakeBooleanChecker ())
     .AddTraceSource ("RTO",
                      "Retransmission timeout",
                      MakeTraceSourceAccessor (&TcpSocketBase::m_rto))
@@ -121,6 +132,7 @@ TcpSocketBase::TcpSocketBase (void)
     m_delAckCount (0),
     m_priority (-1),
     m_blocked (false),
+    m_virtualPayload (false),
     m_ackdBytes (0),
     m_endPoint (0),
     m_endPoint6 (0),
@@ -161,6 +173,8 @@ TcpSocketBase::TcpSocketBase (const TcpSocketBase& sock)
     m_blocking (sock.m_blocking),
     //m_blocked (sock.m_blocked),
     m_blocked (false),
+    m_blockWeight (sock.m_blockWeight),
+    m_virtualPayload (sock.m_virtualPayload),
     m_ackdBytes (sock.m_ackdBytes),
     m_endPoint (0),
     m_endPoint6 (0),
@@ -227,6 +241,7 @@ TcpSocketBase::~TcpSocketBase (void)
     }
   m_tcp = 0;
   CancelAllTimers ();
+  CancelDeviceWait ();
 }
 
 /** Associate a node with this TCP socket */
@@ -509,10 +524,27 @@ TcpSocketBase::Send (Ptr<Packet> p, uint32_t flags)
 {
   NS_LOG_FUNCTION (this << p);
   NS_ABORT_MSG_IF (flags, "use of flags is not supported in TcpSocketBase::Send()");
+  return DoSend (p, p->GetSize ());
+}
+
+/** Same as Send(), but buffers size bytes of zero-filled data without a
+    packet holding them. Segments are created only when they are sent */
+int
+TcpSocketBase::SendVirtual (uint32_t size)
+{
+  NS_LOG_FUNCTION (this << size);
+  return DoSend (0, size);
+}
+
+/** Common part of Send() and SendVirtual(): store the data into the Tx
+    buffer and submit it to lower layers if the state allows */
+int
+TcpSocketBase::DoSend (Ptr<Packet> p, uint32_t size)
+{
   if (m_state == ESTABLISHED || m_state == SYN_SENT || m_state == CLOSE_WAIT)
     {
-      // Store the packet into Tx buffer
-      if (!m_txBuffer.Add (p))
+      // Store the data into Tx buffer
+      if (!(p != 0 ? m_txBuffer.Add (p) : m_txBuffer.AddVirtual (size)))
         { // TxBuffer overflow, send failed
           m_errno = ERROR_MSGSIZE;
           return -1;
@@ -523,7 +555,7 @@ TcpSocketBase::Send (Ptr<Packet> p, uint32_t flags)
         { // Try to send the data out
           SendPendingData (m_connected);
         }
-      return p->GetSize ();
+      return size;
     }
   else
     { // Connection not established yet
@@ -550,7 +582,7 @@ TcpSocketBase::Recv (uint32_t maxSize, uint32_t flags)
     {
       return Create<Packet> (); // Send EOF on connection close
     }
-  Ptr<Packet> outPacket = m_rxBuffer.Extract (maxSize);
+  Ptr<Packet> outPacket = m_rxBuffer.Extract (maxSize, m_virtualPayload);
   if (outPacket != 0 && outPacket->GetSize () != 0)
     {
       SocketAddressTag tag;
@@ -646,6 +678,7 @@ TcpSocketBase::BindToNetDevice (Ptr<NetDevice> netdevice)
 {
   NS_LOG_FUNCTION (netdevice);
   Socket::BindToNetDevice (netdevice); // Includes sanity check
+  m_egressDevice = 0;
   if (m_endPoint == 0 && m_endPoint6 == 0)
     {
       if (Bind () == -1)
@@ -818,6 +851,7 @@ TcpSocketBase::ForwardIcmp (Ipv4Address icmpSource, uint8_t icmpTtl,
 {
   NS_LOG_FUNCTION (this << icmpSource << (uint32_t)icmpTtl << (uint32_t)icmpType <<
                    (uint32_t)icmpCode << icmpInfo);
+  m_egressDevice = 0; // The path may have changed, look the route up again
   if (!m_icmpCallback.IsNull ())
     {
       m_icmpCallback (icmpSource, icmpTtl, icmpType, icmpCode, icmpInfo);
@@ -1734,6 +1768,8 @@ TcpSocketBase::DeallocateEndPoint (void)
           m_tcp->m_sockets.erase (it);
         }
       CancelAllTimers ();
+      CancelDeviceWait ();
+      m_egressDevice = 0;
     }
   if (m_endPoint6 != 0)
     {
@@ -1973,19 +2009,20 @@ void
 TcpSocketBase::DeviceUnblocked(Ptr<NetDevice> nd, uint32_t avail)
 {
 	NS_LOG_FUNCTION (this << nd << avail);
-	//Ptr<QbbNetDevice> qbb = nd->GetObject<QbbNetDevice>();
-	if (nd->GetTxAvailable () >= m_segmentSize) {
-                m_blocked = false;
-		Simulator::ScheduleNow(&TcpSocketBase::CancelNetDeviceCallback, this, nd);
-		SendPendingData(m_connected);
-	};
+	// The device wakes us once, with at least a segment available
+	m_blockDevice = 0;
+	m_blocked = false;
+	SendPendingData(m_connected);
 };
 
 void
-TcpSocketBase::CancelNetDeviceCallback(Ptr<NetDevice> nd)
+TcpSocketBase::CancelDeviceWait(void)
 {
-	NS_LOG_FUNCTION (this << nd);
-	nd->DisconnectWithoutContext (MakeCallback (&TcpSocketBase::DeviceUnblocked, this));
+	NS_LOG_FUNCTION (this);
+	if (m_blockDevice != 0) {
+		m_blockDevice->CancelTxWait (MakeCallback (&TcpSocketBase::DeviceUnblocked, this));
+		m_blockDevice = 0;
+	};
 };
 
 bool
@@ -1993,20 +2030,25 @@ TcpSocketBase::IsBlocked (void)
 {
   NS_LOG_FUNCTION (this);
   //NS_LOG_UNCOND ("Checking if blocking");
-  // Assumed we called SetupEndPoint, now we get the route to destination
-  Ptr<Ipv4RoutingProtocol> rp = m_node->GetObject<Ipv4> ()->GetRoutingProtocol ();
-  Ipv4Header header;
-  header.SetDestination (m_endPoint->GetPeerAddress ());
-  Socket::SocketErrno errno_;
-  Ptr<Ipv4Route> route = m_node->GetObject<Ipv4> ()->GetRoutingProtocol ()->RouteOutput (Ptr<Packet> (), header, 0, errno_);
-  // From the route, get the netdevice
-  Ptr<NetDevice> nd = route->GetOutputDevice ();
-  //NS_LOG_UNCOND ("nd GetTxAvailable: " << nd->GetTxAvailable ());
-  if (nd != 0 && nd->GetTxAvailable () < m_segmentSize)
+  // The device's free Tx buffer is the credit for the next segment
+  Ptr<NetDevice> nd = GetEgressDevice ();
+  if (nd == 0)
+    {
+      return false;
+    }
+  // The device may keep a Tx buffer per class, so ask for ours
+  Ptr<const Packet> probe = GetTxProbe ();
+  //NS_LOG_UNCOND ("nd GetTxAvailable: " << nd->GetTxAvailable (probe));
+  if (nd->GetTxAvailable (probe) < m_segmentSize)
     {
       NS_LOG_LOGIC ("NetDevice buffer full. Device is blocked.");
       //NS_LOG_UNCOND ("NetDevice buffer full. Device is blocked.");
-      nd->ConnectWithoutContext (MakeCallback(&TcpSocketBase::DeviceUnblocked, this));
+      if (m_blockDevice == 0)
+        {
+          m_blockDevice = nd;
+          nd->WaitTxAvailable (MakeCallback (&TcpSocketBase::DeviceUnblocked, this),
+                               m_segmentSize, m_blockWeight, probe);
+        }
       //XXX: Got wild with setting this variable
       m_blocked = true;
       return true;
@@ -2015,6 +2057,70 @@ TcpSocketBase::IsBlocked (void)
   return false;
 }
 
+/** Return the device the route to the peer goes out of. The route is looked
+    up once and kept until the endpoint is released, an ICMP error arrives or
+    the link of the cached device goes down */
+Ptr<NetDevice>
+TcpSocketBase::GetEgressDevice (void)
+{
+  if (m_egressDevice != 0 && m_egressDevice->IsLinkUp ())
+    {
+      return m_egressDevice;
+    }
+  NS_LOG_FUNCTION (this);
+  m_egressDevice = 0;
+  if (m_endPoint == 0)
+    {
+      return 0;
+    }
+  // Assumed we called SetupEndPoint, now we get the route to destination
+  Ipv4Header header;
+  header.SetDestination (m_endPoint->GetPeerAddress ());
+  Socket::SocketErrno errno_;
+  Ptr<Ipv4Route> route = m_node->GetObject<Ipv4> ()->GetRoutingProtocol ()->RouteOutput (Ptr<Packet> (), header, m_boundnetdevice, errno_);
+  if (route != 0)
+    {
+      m_egressDevice = route->GetOutputDevice ();
+    }
+  return m_egressDevice;
+}
+
+/** Return a header-only packet that the egress device classifies like our
+    data segments: an IPv4 header with the TOS the segments leave with, and
+    the PriorityTag SendPacket would add to the next one */
+Ptr<const Packet>
+TcpSocketBase::GetTxProbe (void)
+{
+  if (m_txProbe == 0 || (IsManualIpTos () && m_txProbe->PeekU8 (1) != GetIpTos ()))
+    {
+      Ipv4Header header;
+      if (IsManualIpTos ())
+        {
+          header.SetTos (GetIpTos ());
+        }
+      else
+        {
+          UintegerValue tos;
+          Ptr<Ipv4L3Protocol> ipv4 = m_node->GetObject<Ipv4L3Protocol> ();
+          if (ipv4 != 0)
+            {
+              ipv4->GetAttribute ("DefaultTos", tos);
+            }
+          header.SetTos (tos.Get ());
+        }
+      m_txProbe = Create<Packet> ();
+      m_txProbe->AddHeader (header);
+    }
+  if (m_priority > -1)
+    {
+      PriorityTag priTag;
+      m_txProbe->RemovePacketTag (priTag);
+      priTag.SetPriority (m_priority - m_ackdBytes);
+      m_txProbe->AddPacketTag (priTag);
+    }
+  return m_txProbe;
+}
+
 /** Send as much pending data as possible according to the Tx window. Note that
  *  this function did not implement the PSH flag
  */
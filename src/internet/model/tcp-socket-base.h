@@ -91,6 +91,7 @@ public:
   virtual int ShutdownSend (void);    // Assert the m_shutdownSend flag to prevent send to network
   virtual int ShutdownRecv (void);    // Assert the m_shutdownRecv flag to prevent forward to app
   virtual int Send (Ptr<Packet> p, uint32_t flags);  // Call by app to send data to network
+  int SendVirtual (uint32_t size);  // Send size bytes of zero-filled data without creating a packet
   virtual int SendTo (Ptr<Packet> p, uint32_t flags, const Address &toAddress); // Same as Send(), toAddress is insignificant
   virtual Ptr<Packet> Recv (uint32_t maxSize, uint32_t flags); // Return a packet to be forwarded to app
   virtual Ptr<Packet> RecvFrom (uint32_t maxSize, uint32_t flags, Address &fromAddress); // ... and write the remote address at fromAddress
@@ -100,6 +101,8 @@ public:
   virtual void BindToNetDevice (Ptr<NetDevice> netdevice); // NetDevice with my m_endPoint
 
 protected:
+  friend class TcpL4Protocol; // Forks its prototype sockets in CreateSocket
+
   // Implementing ns3::TcpSocket -- Attribute get/set
   virtual void     SetSndBufSize (uint32_t size);
   virtual uint32_t GetSndBufSize (void) const;
@@ -142,8 +145,11 @@ protected:
   void ForwardIcmp (Ipv4Address icmpSource, uint8_t icmpTtl, uint8_t icmpType, uint8_t icmpCode, uint32_t icmpInfo);
   void ForwardIcmp6 (Ipv6Address icmpSource, uint8_t icmpTtl, uint8_t icmpType, uint8_t icmpCode, uint32_t icmpInfo);  
   void DeviceUnblocked(Ptr<NetDevice> nd, uint32_t avail); // To be called by the QbbNetDevice upon tx buffer available again
-  void CancelNetDeviceCallback(Ptr<NetDevice> qbb);
+  void CancelDeviceWait(void); // Stop waiting for the device, if we are
   bool IsBlocked(void);
+  Ptr<NetDevice> GetEgressDevice (void); // Device toward the peer, resolved once per connection
+  Ptr<const Packet> GetTxProbe (void); // A packet the egress device classifies like our segments
+  int DoSend (Ptr<Packet> p, uint32_t size); // Buffer p, or size virtual bytes if p is null, and send what the window allows
   bool SendPendingData (bool withAck = false); // Send as much as the window allows
   uint32_t SendDataPacket (SequenceNumber32 seq, uint32_t maxSize, bool withAck); // Send a data packet
   void SendEmptyPacket (uint8_t flags); // Send a empty packet that carries a flag, e.g. ACK
@@ -216,6 +222,11 @@ protected:
   double            m_priority;        //< Priority of the socket
   bool              m_blocking;        //< If the socket blocks (for qbb)
   bool              m_blocked;         // If the socket is currently blocked
+  double            m_blockWeight;     //< Share of the socket in weighted device wake-ups
+  Ptr<NetDevice>    m_blockDevice;     //< Device the socket waits on for Tx buffer
+  Ptr<NetDevice>    m_egressDevice;    //< Cached output device toward the peer
+  Ptr<Packet>       m_txProbe;         //< Header-only packet classified like our segments
+  bool              m_virtualPayload;  //< Deliver received data as zero-filled packets
   uint64_t          m_ackdBytes;       // The number of ackd bytes
 
   // Connections to other layers of TCP/IP
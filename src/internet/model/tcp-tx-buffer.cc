@@ -53,7 +53,7 @@ TcpTxBuffer::GetTypeId (void)
  * initialized below is insignificant.
  */
 TcpTxBuffer::TcpTxBuffer (uint32_t n)
-  : m_firstByteSeq (n), m_size (0), m_maxBuffer (32768), m_data (0)
+  : m_firstByteSeq (n), m_size (0), m_maxBuffer (32768), m_firstByteOffset (0)
 {
 }
 
@@ -107,7 +107,16 @@ TcpTxBuffer::Add (Ptr<Packet> p)
     {
       if (p->GetSize () > 0)
         {
-          m_data.push_back (p);
+          if (m_data.empty () && m_size > 0)
+            { // Mark the virtual payload buffered so far
+              Chunk v;
+              v.start = m_firstByteOffset;
+              m_data.push_back (v);
+            }
+          Chunk c;
+          c.packet = p;
+          c.start = m_firstByteOffset + m_size;
+          m_data.push_back (c);
           m_size += p->GetSize ();
           NS_LOG_LOGIC ("Updated size=" << m_size << ", lastSeq=" << m_firstByteSeq + SequenceNumber32 (m_size));
         }
@@ -117,6 +126,27 @@ TcpTxBuffer::Add (Ptr<Packet> p)
   return false;
 }
 
+bool
+TcpTxBuffer::AddVirtual (uint32_t n)
+{
+  NS_LOG_FUNCTION (this << n);
+  if (n > Available ())
+    {
+      NS_LOG_LOGIC ("Rejected. Not enough room to buffer " << n << " bytes.");
+      return false;
+    }
+  // With no packets buffered, all data is virtual. Otherwise extend the
+  // virtual chunk at the tail, or start one.
+  if (n > 0 && !m_data.empty () && m_data.back ().packet != 0)
+    {
+      Chunk v;
+      v.start = m_firstByteOffset + m_size;
+      m_data.push_back (v);
+    }
+  m_size += n;
+  return true;
+}
+
 uint32_t
 TcpTxBuffer::SizeFromSequence (const SequenceNumber32& seq) const
 {
@@ -143,60 +173,57 @@ TcpTxBuffer::CopyFromSequence (uint32_t numBytes, const SequenceNumber32& seq)
       return Create<Packet> (s);
     }
 
-  // Extract data from the buffer and return
-  uint32_t offset = seq - m_firstByteSeq.Get ();
-  uint32_t count = 0;      // Offset of the first byte of a packet in the buffer
-  uint32_t pktSize = 0;
-  bool beginFound = false;
-  int pktCount = 0;
-  Ptr<Packet> outPacket;
-  NS_LOG_LOGIC ("There are " << m_data.size () << " number of packets in buffer");
-  for (BufIterator i = m_data.begin (); i != m_data.end (); ++i)
+  // Find the packet holding the first byte, then copy forward from it
+  uint64_t offset = m_firstByteOffset + (seq - m_firstByteSeq.Get ());
+  BufIterator i = std::upper_bound (m_data.begin (), m_data.end (), offset, &TcpTxBuffer::StartsAfter);
+  NS_ASSERT (i != m_data.begin ());
+  --i;
+  NS_LOG_LOGIC ("First byte found in packet #" << i - m_data.begin () << " at stream offset " << i->start
+                                               << ", packet len=" << ChunkEnd (i) - i->start);
+  uint32_t packetOffset = offset - i->start;
+  uint32_t fragmentLength = ChunkEnd (i) - offset;
+  if (fragmentLength >= s)
+    { // Data to be copied falls entirely in this packet
+      return i->packet ? i->packet->CreateFragment (packetOffset, s) : Create<Packet> (s);
+    }
+  // This packet only fulfills part of the request
+  Ptr<Packet> outPacket = i->packet ? i->packet->CreateFragment (packetOffset, fragmentLength)
+                                    : Create<Packet> (fragmentLength);
+  uint32_t remaining = s - fragmentLength;
+  for (++i; remaining > 0; ++i)
     {
-      pktCount++;
-      pktSize = (*i)->GetSize ();
-      if (!beginFound)
-        { // Look for first fragment
-          if (count + pktSize > offset)
-            {
-              NS_LOG_LOGIC ("First byte found in packet #" << pktCount << " at buffer offset " << count
-                                                           << ", packet len=" << pktSize);
-              beginFound = true;
-              uint32_t packetOffset = offset - count;
-              uint32_t fragmentLength = count + pktSize - offset;
-              if (fragmentLength >= s)
-                { // Data to be copied falls entirely in this packet
-                  return (*i)->CreateFragment (packetOffset, s);
-                }
-              else
-                { // This packet only fulfills part of the request
-                  outPacket = (*i)->CreateFragment (packetOffset, fragmentLength);
-                }
-              NS_LOG_LOGIC ("Output packet is now of size " << outPacket->GetSize ());
-            }
-        }
-      else if (count + pktSize >= offset + s)
+      NS_ASSERT (i != m_data.end ());
+      uint32_t pktSize = ChunkEnd (i) - i->start;
+      if (pktSize >= remaining)
         { // Last packet fragment found
-          NS_LOG_LOGIC ("Last byte found in packet #" << pktCount << " at buffer offset " << count
-                                                      << ", packet len=" << pktSize);
-          uint32_t fragmentLength = offset + s - count;
-          Ptr<Packet> endFragment = (*i)->CreateFragment (0, fragmentLength);
-          outPacket->AddAtEnd (endFragment);
-          NS_LOG_LOGIC ("Output packet is now of size " << outPacket->GetSize ());
+          outPacket->AddAtEnd (i->packet ? i->packet->CreateFragment (0, remaining) : Create<Packet> (remaining));
           break;
         }
-      else
-        {
-          NS_LOG_LOGIC ("Appending to output the packet #" << pktCount << " of offset " << count << " len=" << pktSize);
-          outPacket->AddAtEnd (*i);
-          NS_LOG_LOGIC ("Output packet is now of size " << outPacket->GetSize ());
-        }
-      count += pktSize;
+      outPacket->AddAtEnd (i->packet ? i->packet : Create<Packet> (pktSize));
+      remaining -= pktSize;
     }
+  NS_LOG_LOGIC ("Output packet is now of size " << outPacket->GetSize ());
   NS_ASSERT (outPacket->GetSize () == s);
   return outPacket;
 }
 
+bool
+TcpTxBuffer::StartsAfter (uint64_t offset, const Chunk& chunk)
+{
+  return offset < chunk.start;
+}
+
+uint64_t
+TcpTxBuffer::ChunkEnd (BufIterator i) const
+{
+  if (i->packet != 0)
+    {
+      return i->start + i->packet->GetSize ();
+    }
+  ++i;
+  return (i == m_data.end ()) ? m_firstByteOffset + m_size : i->start;
+}
+
 void
 TcpTxBuffer::SetHeadSequence (const SequenceNumber32& seq)
 {
@@ -213,31 +240,18 @@ TcpTxBuffer::DiscardUpTo (const SequenceNumber32& seq)
   // Cases do not need to scan the buffer
   if (m_firstByteSeq >= seq) return;
 
-  // Scan the buffer and discard packets
+  // Drop the packets wholly before seq. A packet cut by seq is kept
+  // whole; its acknowledged bytes are skipped by their stream offset.
   uint32_t offset = seq - m_firstByteSeq.Get ();  // Number of bytes to remove
-  uint32_t pktSize;
+  offset = std::min (offset, m_size);
   NS_LOG_LOGIC ("Offset=" << offset);
-  BufIterator i = m_data.begin ();
-  while (i != m_data.end ())
+  m_firstByteOffset += offset;
+  m_firstByteSeq += offset;
+  m_size -= offset;
+  while (!m_data.empty () && ChunkEnd (m_data.begin ()) <= m_firstByteOffset)
     {
-      if (offset > (*i)->GetSize ())
-        { // This packet is behind the seqnum. Remove this packet from the buffer
-          pktSize = (*i)->GetSize ();
-          m_size -= pktSize;
-          offset -= pktSize;
-          m_firstByteSeq += pktSize;
-          i = m_data.erase (i);
-          NS_LOG_LOGIC ("Removed one packet of size " << pktSize << ", offset=" << offset);
-        }
-      else if (offset > 0)
-        { // Part of the packet is behind the seqnum. Fragment
-          pktSize = (*i)->GetSize () - offset;
-          *i = (*i)->CreateFragment (offset, pktSize);
-          m_size -= offset;
-          m_firstByteSeq += offset;
-          NS_LOG_LOGIC ("Fragmented one packet by size " << offset << ", new size=" << pktSize);
-          break;
-        }
+      NS_LOG_LOGIC ("Removed one packet at stream offset " << m_data.front ().start);
+      m_data.pop_front ();
     }
   // Catching the case of ACKing a FIN
   if (m_size == 0)
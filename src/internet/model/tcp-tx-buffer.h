@@ -21,7 +21,7 @@
 #ifndef TCP_TX_BUFFER_H
 #define TCP_TX_BUFFER_H
 
-#include <list>
+#include <deque>
 #include "ns3/traced-value.h"
 #include "ns3/trace-source-accessor.h"
 #include "ns3/object.h"
@@ -84,6 +84,15 @@ public:
    */
   bool Add (Ptr<Packet> p);
 
+  /**
+   * Append bytes of virtual payload to the end of the buffer. No packet is
+   * stored for them; CopyFromSequence returns them as zero-filled data.
+   *
+   * \param n The number of bytes to append
+   * \return Boolean to indicate success
+   */
+  bool AddVirtual (uint32_t n);
+
   /**
    * Returns the number of bytes from the buffer in the range [seq, tailSequence)
    */
@@ -108,12 +117,29 @@ public:
   void DiscardUpTo (const SequenceNumber32& seq);
 
 private:
-  typedef std::list<Ptr<Packet> >::iterator BufIterator;
+  /**
+   * A packet added by the application, with the stream offset of its first
+   * byte. Offsets count every byte ever added and never wrap, so the chunk
+   * holding a sequence number is found by binary search. A null packet
+   * stands for virtual payload up to the start of the next chunk.
+   */
+  struct Chunk
+  {
+    Ptr<Packet> packet;
+    uint64_t start;
+  };
+  typedef std::deque<Chunk>::const_iterator BufIterator;
+
+  static bool StartsAfter (uint64_t offset, const Chunk& chunk);
+
+  /// Stream offset one past the last byte of a chunk
+  uint64_t ChunkEnd (BufIterator i) const;
 
   TracedValue<SequenceNumber32> m_firstByteSeq; //< Sequence number of the first byte in data (SND.UNA)
   uint32_t m_size;                              //< Number of data bytes
   uint32_t m_maxBuffer;                         //< Max number of data bytes in buffer (SND.WND)
-  std::list<Ptr<Packet> > m_data;               //< Corresponding data (may be null)
+  uint64_t m_firstByteOffset;                   //< Stream offset of m_firstByteSeq
+  std::deque<Chunk> m_data;                     //< Corresponding data (may be null)
 };
 
 } // namepsace ns3
@@ -0,0 +1,149 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ns3/test.h"
+#include "ns3/uinteger.h"
+#include "ns3/simulator.h"
+#include "ns3/dctcp-control.h"
+
+#include <cmath>
+
+using namespace ns3;
+
+class DctcpControlAlphaTestCase : public TestCase
+{
+public:
+  DctcpControlAlphaTestCase ();
+private:
+  virtual void DoRun (void);
+};
+
+DctcpControlAlphaTestCase::DctcpControlAlphaTestCase ()
+  : TestCase ("Fixed-point alpha of the DCTCP estimator")
+{
+}
+
+void
+DctcpControlAlphaTestCase::DoRun (void)
+{
+  Ptr<DctcpControl> control = CreateObject<DctcpControl> ();
+  control->SetAttribute ("ShiftG", UintegerValue (4));
+  Time noDeadline = Seconds (-1);
+  Time rtt = MicroSeconds (100);
+
+  // Half of the bytes marked: alpha = 1/16 * 512
+  control->Acked (3000, true);
+  control->Acked (3000, false);
+  control->Update (10 * 1500, 1500, noDeadline, rtt);
+  NS_TEST_EXPECT_MSG_EQ (control->GetAlpha (), 32, "First window");
+  NS_TEST_EXPECT_MSG_EQ (control->GetPenalty (), 32, "Penalty is alpha");
+
+  // A window with nothing acked only decays alpha
+  control->Update (10 * 1500, 1500, noDeadline, rtt);
+  NS_TEST_EXPECT_MSG_EQ (control->GetAlpha (), 30, "Empty window");
+
+  // Every byte marked converges to the whole window
+  for (uint32_t i = 0; i < 200; ++i)
+    {
+      control->Acked (1500, true);
+      control->Update (10 * 1500, 1500, noDeadline, rtt);
+    }
+  NS_TEST_EXPECT_MSG_EQ ((control->GetAlpha () >= 1009 && control->GetAlpha () <= 1024), true,
+                         "Saturated alpha " << control->GetAlpha ());
+
+  // Copies keep the parameters and start from a fresh estimate
+  control->SetAttribute ("ShiftG", UintegerValue (2));
+  Ptr<DctcpControl> copy = control->Copy ();
+  NS_TEST_EXPECT_MSG_EQ (copy->GetAlpha (), 0, "Fresh copy");
+  copy->Acked (1500, true);
+  copy->Update (10 * 1500, 1500, noDeadline, rtt);
+  NS_TEST_EXPECT_MSG_EQ (copy->GetAlpha (), 256, "Copied ShiftG");
+
+  // alpha's weight defaults to 1/4, which the original implementation used
+  Ptr<DctcpControl> defaults = CreateObject<DctcpControl> ();
+  defaults->Acked (1500, true);
+  defaults->Update (10 * 1500, 1500, noDeadline, rtt);
+  NS_TEST_EXPECT_MSG_EQ (defaults->GetAlpha (), 256, "Default ShiftG");
+}
+
+class D2tcpControlPenaltyTestCase : public TestCase
+{
+public:
+  D2tcpControlPenaltyTestCase ();
+private:
+  virtual void DoRun (void);
+};
+
+D2tcpControlPenaltyTestCase::D2tcpControlPenaltyTestCase ()
+  : TestCase ("Table-driven alpha^gamma of the D2TCP estimator")
+{
+}
+
+void
+D2tcpControlPenaltyTestCase::DoRun (void)
+{
+  for (uint32_t alpha = 0; alpha <= 1024; alpha += 7)
+    {
+      NS_TEST_EXPECT_MSG_EQ (D2tcpControl::Power (alpha, 1024), alpha, "alpha^1 is exact");
+      for (uint32_t gamma = 410; gamma <= 2048; gamma += 61)
+        {
+          double expected = std::pow (alpha / 1024.0, gamma / 1024.0) * 1024;
+          NS_TEST_EXPECT_MSG_EQ_TOL (double (D2tcpControl::Power (alpha, gamma)), expected, 1.0,
+                                     "alpha=" << alpha << " gamma=" << gamma);
+        }
+    }
+
+  // Without a deadline, D2TCP is DCTCP
+  Ptr<D2tcpControl> control = CreateObject<D2tcpControl> ();
+  control->Acked (3000, true);
+  control->Acked (3000, false);
+  control->Update (10 * 1500, 1500, Seconds (-1), MicroSeconds (100));
+  NS_TEST_EXPECT_MSG_EQ (control->GetGamma (), 1024, "No deadline");
+  NS_TEST_EXPECT_MSG_EQ (control->GetPenalty (), control->GetAlpha (), "No deadline");
+
+  // A deadline behind the time needed to finish raises gamma, which
+  // shrinks the penalty; a far one lowers it
+  Ptr<D2tcpControl> close = CreateObject<D2tcpControl> ();
+  Ptr<D2tcpControl> far = CreateObject<D2tcpControl> ();
+  for (uint32_t i = 0; i < 20; ++i)
+    {
+      close->Acked (1500, true);
+      close->Update (10 * 1500, 1500, MicroSeconds (500), MicroSeconds (100));
+      far->Acked (1500, true);
+      far->Update (10 * 1500, 1500, Seconds (1), MicroSeconds (100));
+    }
+  NS_TEST_EXPECT_MSG_EQ (close->GetGamma (), 2048, "Close deadline");
+  NS_TEST_EXPECT_MSG_EQ (far->GetGamma (), 410, "Far deadline");
+  NS_TEST_EXPECT_MSG_EQ ((close->GetPenalty () < close->GetAlpha ()), true, "Close deadline backs off less");
+  NS_TEST_EXPECT_MSG_EQ ((far->GetPenalty () > far->GetAlpha ()), true, "Far deadline backs off more");
+
+  Simulator::Destroy ();
+}
+
+class DctcpControlTestSuite : public TestSuite
+{
+public:
+  DctcpControlTestSuite ();
+};
+
+DctcpControlTestSuite::DctcpControlTestSuite ()
+  : TestSuite ("dctcp-control", UNIT)
+{
+  AddTestCase (new DctcpControlAlphaTestCase);
+  AddTestCase (new D2tcpControlPenaltyTestCase);
+}
+
+static DctcpControlTestSuite g_dctcpControlTestSuite;
@@ -0,0 +1,157 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ns3/test.h"
+#include "ns3/ipv4-end-point.h"
+#include "ns3/ipv4-end-point-demux.h"
+#include "ns3/ipv4-interface.h"
+#include "ns3/ipv4-interface-address.h"
+
+using namespace ns3;
+
+class Ipv4EndPointDemuxLookupTestCase : public TestCase
+{
+public:
+  Ipv4EndPointDemuxLookupTestCase ();
+private:
+  virtual void DoRun (void);
+};
+
+Ipv4EndPointDemuxLookupTestCase::Ipv4EndPointDemuxLookupTestCase ()
+  : TestCase ("Most exact match of an incoming four-tuple")
+{
+}
+
+void
+Ipv4EndPointDemuxLookupTestCase::DoRun (void)
+{
+  Ipv4Address local ("10.0.0.1");
+  Ipv4Address peer ("10.0.0.2");
+  Ipv4Address other ("10.0.0.3");
+  Ptr<Ipv4Interface> interface = CreateObject<Ipv4Interface> ();
+  interface->AddAddress (Ipv4InterfaceAddress (local, Ipv4Mask ("255.255.255.0")));
+
+  Ipv4EndPointDemux demux;
+  Ipv4EndPointDemux::EndPoints found = demux.Lookup (local, 80, peer, 1000, interface);
+  NS_TEST_EXPECT_MSG_EQ (found.size (), 0, "No endpoint on the port");
+
+  // A listener bound to the address hides the wildcard one, which
+  // still gets the packets for other local addresses
+  Ipv4EndPoint *any = demux.Allocate (80);
+  Ipv4EndPoint *bound = demux.Allocate (local, 80);
+  NS_TEST_ASSERT_MSG_NE (bound, 0, "Bound listener");
+  NS_TEST_EXPECT_MSG_EQ (demux.Allocate (local, 80), 0, "Duplicate listener");
+  found = demux.Lookup (local, 80, peer, 1000, interface);
+  NS_TEST_ASSERT_MSG_EQ (found.size (), 1, "Bound listener alone");
+  NS_TEST_EXPECT_MSG_EQ (found.front (), bound, "Bound listener");
+  found = demux.Lookup (other, 80, peer, 1000, interface);
+  NS_TEST_ASSERT_MSG_EQ (found.size (), 1, "Other local address");
+  NS_TEST_EXPECT_MSG_EQ (found.front (), any, "Only the wildcard listener");
+
+  // A connection takes precedence over the listeners, and is found
+  // again when its peer changes
+  Ipv4EndPoint *connection = demux.Allocate (Ipv4Address::GetAny (), 80, peer, 999);
+  NS_TEST_ASSERT_MSG_NE (connection, 0, "Connection");
+  NS_TEST_EXPECT_MSG_EQ (demux.Allocate (Ipv4Address::GetAny (), 80, peer, 999), 0, "Duplicate connection");
+  connection->SetPeer (peer, 1000);
+  found = demux.Lookup (local, 80, peer, 1000, interface);
+  NS_TEST_ASSERT_MSG_EQ (found.size (), 1, "All but the local address");
+  NS_TEST_EXPECT_MSG_EQ (found.front (), connection, "Connection with a wildcard address");
+  connection->SetLocalAddress (local);
+  found = demux.Lookup (local, 80, peer, 1000, interface);
+  NS_TEST_ASSERT_MSG_EQ (found.size (), 1, "Exact match");
+  NS_TEST_EXPECT_MSG_EQ (found.front (), connection, "Connection with its address set");
+  NS_TEST_EXPECT_MSG_EQ (demux.SimpleLookup (local, 80, peer, 1000), connection, "Simple exact match");
+  NS_TEST_EXPECT_MSG_EQ (demux.SimpleLookup (local, 80, peer, 1001), connection, "Least generic endpoint");
+  demux.DeAllocate (demux.Allocate (local, 81));
+  NS_TEST_EXPECT_MSG_EQ (demux.SimpleLookup (local, 81, peer, 1000), 0, "Released port");
+  found = demux.Lookup (local, 80, peer, 1001, interface);
+  NS_TEST_ASSERT_MSG_EQ (found.size (), 1, "Other peer port");
+  NS_TEST_EXPECT_MSG_EQ (found.front (), bound, "Other peer port to the bound listener");
+
+  // Broadcasts match endpoints against the address of the interface
+  found = demux.Lookup (Ipv4Address ("10.0.0.255"), 80, peer, 1000, interface);
+  NS_TEST_EXPECT_MSG_EQ (found.size (), 1, "Subnet-directed broadcast");
+  NS_TEST_EXPECT_MSG_EQ (found.front (), connection, "Broadcast to the connection");
+
+  demux.DeAllocate (connection);
+  found = demux.Lookup (local, 80, peer, 1000, interface);
+  NS_TEST_ASSERT_MSG_EQ (found.size (), 1, "Back to the listeners");
+  NS_TEST_EXPECT_MSG_EQ (found.front (), bound, "Back to the bound listener");
+  found = demux.Lookup (Ipv4Address ("10.0.0.255"), 80, peer, 1000, interface);
+  NS_TEST_EXPECT_MSG_EQ (found.size (), 2, "Broadcast to both listeners");
+  demux.DeAllocate (bound);
+  found = demux.Lookup (local, 80, peer, 1000, interface);
+  NS_TEST_ASSERT_MSG_EQ (found.size (), 1, "Wildcard listener left");
+  NS_TEST_EXPECT_MSG_EQ (found.front (), any, "Back to the wildcard listener");
+  demux.DeAllocate (any);
+  NS_TEST_EXPECT_MSG_EQ (demux.LookupPortLocal (80), false, "Port released");
+  NS_TEST_EXPECT_MSG_EQ (demux.GetAllEndPoints ().size (), 0, "No endpoints left");
+}
+
+class Ipv4EndPointDemuxEphemeralTestCase : public TestCase
+{
+public:
+  Ipv4EndPointDemuxEphemeralTestCase ();
+private:
+  virtual void DoRun (void);
+};
+
+Ipv4EndPointDemuxEphemeralTestCase::Ipv4EndPointDemuxEphemeralTestCase ()
+  : TestCase ("Ephemeral port allocation")
+{
+}
+
+void
+Ipv4EndPointDemuxEphemeralTestCase::DoRun (void)
+{
+  Ipv4EndPointDemux demux;
+  std::vector<Ipv4EndPoint *> endPoints;
+  // Ports count up from the one after the first ephemeral port
+  for (uint32_t port = 49153; port <= 65535; ++port)
+    {
+      Ipv4EndPoint *endPoint = demux.Allocate ();
+      NS_TEST_ASSERT_MSG_NE (endPoint, 0, "Port " << port);
+      NS_TEST_ASSERT_MSG_EQ (endPoint->GetLocalPort (), port, "Next port");
+      endPoints.push_back (endPoint);
+    }
+  Ipv4EndPoint *wrapped = demux.Allocate ();
+  NS_TEST_ASSERT_MSG_NE (wrapped, 0, "Wrapped around");
+  NS_TEST_EXPECT_MSG_EQ (wrapped->GetLocalPort (), 49152, "First ephemeral port");
+  NS_TEST_EXPECT_MSG_EQ (demux.Allocate (), 0, "Every port in use");
+
+  // Freed ports are found past runs of ports in use
+  demux.DeAllocate (endPoints[50000 - 49153]);
+  demux.DeAllocate (endPoints[60000 - 49153]);
+  NS_TEST_EXPECT_MSG_EQ (demux.Allocate ()->GetLocalPort (), 50000, "Next free port");
+  NS_TEST_EXPECT_MSG_EQ (demux.Allocate ()->GetLocalPort (), 60000, "Free port after it");
+  NS_TEST_EXPECT_MSG_EQ (demux.Allocate (), 0, "Every port in use again");
+}
+
+class Ipv4EndPointDemuxTestSuite : public TestSuite
+{
+public:
+  Ipv4EndPointDemuxTestSuite ();
+};
+
+Ipv4EndPointDemuxTestSuite::Ipv4EndPointDemuxTestSuite ()
+  : TestSuite ("ipv4-end-point-demux", UNIT)
+{
+  AddTestCase (new Ipv4EndPointDemuxLookupTestCase);
+  AddTestCase (new Ipv4EndPointDemuxEphemeralTestCase);
+}
+
+static Ipv4EndPointDemuxTestSuite g_ipv4EndPointDemuxTestSuite;
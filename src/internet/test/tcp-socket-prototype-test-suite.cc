@@ -0,0 +1,118 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ns3/test.h"
+#include "ns3/config.h"
+#include "ns3/nstime.h"
+#include "ns3/uinteger.h"
+#include "ns3/object-factory.h"
+#include "ns3/simulator.h"
+#include "ns3/tcp-l4-protocol.h"
+#include "ns3/tcp-socket-base.h"
+
+#include <string>
+
+using namespace ns3;
+
+class TcpSocketPrototypeTestCase : public TestCase
+{
+public:
+  TcpSocketPrototypeTestCase ();
+private:
+  virtual void DoRun (void);
+  void CheckSameAttributes (Ptr<Object> socket, TypeId tid);
+};
+
+TcpSocketPrototypeTestCase::TcpSocketPrototypeTestCase ()
+  : TestCase ("Sockets copied from a prototype match sockets built from their TypeId")
+{
+}
+
+/* Compare every attribute of socket, its parents' included, to a socket
+ * the attribute system builds from tid */
+void
+TcpSocketPrototypeTestCase::CheckSameAttributes (Ptr<Object> socket, TypeId tid)
+{
+  ObjectFactory factory;
+  factory.SetTypeId (tid);
+  Ptr<Object> expected = factory.Create<Object> ();
+  for (TypeId t = tid; ; t = t.GetParent ())
+    {
+      for (uint32_t i = 0; i < t.GetAttributeN (); ++i)
+        {
+          struct TypeId::AttributeInformation info = t.GetAttribute (i);
+          if (!(info.flags & TypeId::ATTR_GET) || !info.accessor->HasGetter ())
+            {
+              continue;
+            }
+          Ptr<AttributeValue> got = info.checker->Create ();
+          Ptr<AttributeValue> want = info.checker->Create ();
+          socket->GetAttribute (info.name, *got);
+          expected->GetAttribute (info.name, *want);
+          NS_TEST_EXPECT_MSG_EQ (got->SerializeToString (info.checker), want->SerializeToString (info.checker),
+                                 tid.GetName () << "::" << info.name);
+        }
+      if (t == t.GetParent ())
+        {
+          break;
+        }
+    }
+}
+
+void
+TcpSocketPrototypeTestCase::DoRun (void)
+{
+  const char *types[] = { "ns3::TcpNewReno", "ns3::TcpReno", "ns3::TcpTahoe",
+                          "ns3::TcpRfc793", "ns3::Dctcp" };
+  Ptr<TcpL4Protocol> tcp = CreateObject<TcpL4Protocol> ();
+  for (uint32_t i = 0; i < sizeof (types) / sizeof (types[0]); ++i)
+    {
+      TypeId tid = TypeId::LookupByName (types[i]);
+      CheckSameAttributes (tcp->CreateSocket (tid), tid);
+    }
+
+  // Defaults set once the prototypes exist reach the next sockets
+  TypeId dctcp = TypeId::LookupByName ("ns3::Dctcp");
+  Config::SetDefault ("ns3::Dctcp::Deadline", TimeValue (MilliSeconds (5)));
+  Config::SetDefault ("ns3::TcpSocket::SegmentSize", UintegerValue (1000));
+  Ptr<Socket> socket = tcp->CreateSocket (dctcp);
+  CheckSameAttributes (socket, dctcp);
+  TimeValue deadline;
+  socket->GetAttribute ("Deadline", deadline);
+  NS_TEST_EXPECT_MSG_EQ (deadline.Get (), MilliSeconds (5), "Deadline set after the first socket");
+  UintegerValue segmentSize;
+  socket->GetAttribute ("SegmentSize", segmentSize);
+  NS_TEST_EXPECT_MSG_EQ (segmentSize.Get (), 1000, "SegmentSize set after the first socket");
+
+  Config::Reset ();
+  CheckSameAttributes (tcp->CreateSocket (dctcp), dctcp);
+
+  Simulator::Destroy ();
+}
+
+class TcpSocketPrototypeTestSuite : public TestSuite
+{
+public:
+  TcpSocketPrototypeTestSuite ();
+};
+
+TcpSocketPrototypeTestSuite::TcpSocketPrototypeTestSuite ()
+  : TestSuite ("tcp-socket-prototype", UNIT)
+{
+  AddTestCase (new TcpSocketPrototypeTestCase);
+}
+
+static TcpSocketPrototypeTestSuite g_tcpSocketPrototypeTestSuite;
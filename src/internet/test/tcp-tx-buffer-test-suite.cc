@@ -0,0 +1,208 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ns3/test.h"
+#include "ns3/packet.h"
+#include "ns3/tcp-tx-buffer.h"
+
+#include <algorithm>
+
+using namespace ns3;
+
+class TcpTxBufferTestCase : public TestCase
+{
+public:
+  TcpTxBufferTestCase ();
+private:
+  virtual void DoRun (void);
+  Ptr<Packet> MakePacket (uint32_t first, uint32_t size);
+  bool CheckPacket (Ptr<Packet> p, uint32_t first, uint32_t size);
+};
+
+TcpTxBufferTestCase::TcpTxBufferTestCase ()
+  : TestCase ("Copy and discard across packet boundaries of the transmit buffer")
+{
+}
+
+// Byte i of the stream has the value i % 251
+Ptr<Packet>
+TcpTxBufferTestCase::MakePacket (uint32_t first, uint32_t size)
+{
+  uint8_t buf[1000];
+  for (uint32_t i = 0; i < size; ++i)
+    {
+      buf[i] = (first + i) % 251;
+    }
+  return Create<Packet> (buf, size);
+}
+
+bool
+TcpTxBufferTestCase::CheckPacket (Ptr<Packet> p, uint32_t first, uint32_t size)
+{
+  uint8_t buf[3000];
+  if (p->GetSize () != size)
+    {
+      return false;
+    }
+  p->CopyData (buf, size);
+  for (uint32_t i = 0; i < size; ++i)
+    {
+      if (buf[i] != (first + i) % 251)
+        {
+          return false;
+        }
+    }
+  return true;
+}
+
+void
+TcpTxBufferTestCase::DoRun (void)
+{
+  TcpTxBuffer buffer (100);
+  buffer.SetMaxBufferSize (100000);
+
+  // Packets of uneven sizes, 100 to 999 bytes
+  uint32_t total = 0;
+  for (uint32_t i = 0; i < 50; ++i)
+    {
+      uint32_t size = 100 + (i * 337) % 900;
+      NS_TEST_ASSERT_MSG_EQ (buffer.Add (MakePacket (total, size)), true, "Add");
+      total += size;
+    }
+  NS_TEST_EXPECT_MSG_EQ (buffer.Size (), total, "Size");
+  NS_TEST_EXPECT_MSG_EQ (buffer.TailSequence (), SequenceNumber32 (100 + total), "TailSequence");
+
+  // Copy segments at every alignment, discarding as we go
+  uint32_t acked = 0;
+  for (uint32_t offset = 0; offset + 1460 <= total; offset += 733)
+    {
+      Ptr<Packet> p = buffer.CopyFromSequence (1460, SequenceNumber32 (100 + offset));
+      NS_TEST_EXPECT_MSG_EQ (CheckPacket (p, offset, 1460), true, "Segment at offset " << offset);
+      if (offset > 2000)
+        {
+          acked = offset - 2000;
+          buffer.DiscardUpTo (SequenceNumber32 (100 + acked));
+          NS_TEST_EXPECT_MSG_EQ (buffer.HeadSequence (), SequenceNumber32 (100 + acked), "HeadSequence");
+          NS_TEST_EXPECT_MSG_EQ (buffer.Size (), total - acked, "Size after discard");
+        }
+    }
+
+  // The tail is cut short at the end of the data
+  Ptr<Packet> p = buffer.CopyFromSequence (1460, SequenceNumber32 (100 + total - 10));
+  NS_TEST_EXPECT_MSG_EQ (CheckPacket (p, total - 10, 10), true, "Tail segment");
+
+  // Acknowledging everything plus a FIN empties the buffer
+  buffer.DiscardUpTo (SequenceNumber32 (100 + total + 1));
+  NS_TEST_EXPECT_MSG_EQ (buffer.Size (), 0, "Empty");
+  NS_TEST_EXPECT_MSG_EQ (buffer.HeadSequence (), SequenceNumber32 (100 + total + 1), "HeadSequence after FIN");
+}
+
+class TcpTxBufferVirtualTestCase : public TestCase
+{
+public:
+  TcpTxBufferVirtualTestCase ();
+private:
+  virtual void DoRun (void);
+  bool IsReal (uint32_t offset);
+  bool CheckPacket (Ptr<Packet> p, uint32_t first, uint32_t size);
+};
+
+TcpTxBufferVirtualTestCase::TcpTxBufferVirtualTestCase ()
+  : TestCase ("Virtual payload mixed with packets in the transmit buffer")
+{
+}
+
+// Stream bytes [3000, 3500) and [5500, 6200) are real, the rest virtual
+bool
+TcpTxBufferVirtualTestCase::IsReal (uint32_t offset)
+{
+  return (offset >= 3000 && offset < 3500) || (offset >= 5500 && offset < 6200);
+}
+
+// Real byte i of the stream has the value i % 251, virtual bytes are zero
+bool
+TcpTxBufferVirtualTestCase::CheckPacket (Ptr<Packet> p, uint32_t first, uint32_t size)
+{
+  uint8_t buf[3000];
+  if (p->GetSize () != size)
+    {
+      return false;
+    }
+  p->CopyData (buf, size);
+  for (uint32_t i = 0; i < size; ++i)
+    {
+      uint8_t expected = IsReal (first + i) ? (first + i) % 251 : 0;
+      if (buf[i] != expected)
+        {
+          return false;
+        }
+    }
+  return true;
+}
+
+void
+TcpTxBufferVirtualTestCase::DoRun (void)
+{
+  TcpTxBuffer buffer (0);
+  buffer.SetMaxBufferSize (10000);
+
+  uint8_t data[700];
+  for (uint32_t i = 0; i < 700; ++i)
+    {
+      data[i] = (3000 + i) % 251;
+    }
+  NS_TEST_ASSERT_MSG_EQ (buffer.AddVirtual (3000), true, "AddVirtual");
+  NS_TEST_ASSERT_MSG_EQ (buffer.Add (Create<Packet> (data, 500)), true, "Add");
+  NS_TEST_ASSERT_MSG_EQ (buffer.AddVirtual (2000), true, "AddVirtual");
+  for (uint32_t i = 0; i < 700; ++i)
+    {
+      data[i] = (5500 + i) % 251;
+    }
+  NS_TEST_ASSERT_MSG_EQ (buffer.Add (Create<Packet> (data, 700)), true, "Add");
+  NS_TEST_ASSERT_MSG_EQ (buffer.AddVirtual (800), true, "AddVirtual");
+  NS_TEST_EXPECT_MSG_EQ (buffer.Size (), 7000, "Size");
+  NS_TEST_EXPECT_MSG_EQ (buffer.AddVirtual (3001), false, "AddVirtual beyond the buffer size");
+
+  for (uint32_t offset = 0; offset < 7000; offset += 1000)
+    {
+      Ptr<Packet> p = buffer.CopyFromSequence (1460, SequenceNumber32 (offset));
+      uint32_t size = std::min<uint32_t> (1460, 7000 - offset);
+      NS_TEST_EXPECT_MSG_EQ (CheckPacket (p, offset, size), true, "Segment at offset " << offset);
+      buffer.DiscardUpTo (SequenceNumber32 (offset));
+      NS_TEST_EXPECT_MSG_EQ (buffer.Size (), 7000 - offset, "Size after discard");
+    }
+  buffer.DiscardUpTo (SequenceNumber32 (7000));
+  NS_TEST_EXPECT_MSG_EQ (buffer.Size (), 0, "Empty");
+
+  // Once drained, the buffer takes virtual payload again
+  NS_TEST_ASSERT_MSG_EQ (buffer.AddVirtual (100), true, "AddVirtual after drain");
+  NS_TEST_EXPECT_MSG_EQ (buffer.CopyFromSequence (1460, SequenceNumber32 (7000))->GetSize (), 100, "Virtual tail");
+}
+
+class TcpTxBufferTestSuite : public TestSuite
+{
+public:
+  TcpTxBufferTestSuite ();
+};
+
+TcpTxBufferTestSuite::TcpTxBufferTestSuite ()
+  : TestSuite ("tcp-tx-buffer", UNIT)
+{
+  AddTestCase (new TcpTxBufferTestCase);
+  AddTestCase (new TcpTxBufferVirtualTestCase);
+}
+
+static TcpTxBufferTestSuite g_tcpTxBufferTestSuite;
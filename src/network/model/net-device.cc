@@ -22,6 +22,7 @@
 #include "ns3/log.h"
 #include "ns3/uinteger.h"
 #include "net-device.h"
+#include "packet.h"
 
 NS_LOG_COMPONENT_DEFINE ("NetDevice");
 
@@ -48,16 +49,23 @@ NetDevice::GetTxAvailable () const
   return std::numeric_limits<uint32_t>::max();
 };
 
+uint32_t
+NetDevice::GetTxAvailable (Ptr<const Packet> probe) const
+{
+  return GetTxAvailable ();
+}
+
 void
-NetDevice::ConnectWithoutContext(const CallbackBase& callback)
+NetDevice::WaitTxAvailable (TxAvailableCallback cb, uint32_t bytes, double weight,
+                            Ptr<const Packet> probe)
 {
-	NS_LOG_FUNCTION(this);
-};
+  NS_LOG_FUNCTION (this << bytes << weight);
+}
 
 void
-NetDevice::DisconnectWithoutContext(const CallbackBase& callback)
+NetDevice::CancelTxWait (TxAvailableCallback cb)
 {
-	NS_LOG_FUNCTION(this);
-};
+  NS_LOG_FUNCTION (this);
+}
 
 } // namespace ns3
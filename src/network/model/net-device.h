@@ -341,10 +341,44 @@ public:
   virtual uint32_t GetTxAvailable() const;
 
   /**
-   * TracedCallback hooks
+   * Get the size of Tx buffer available to the packets of a sender.
+   * Devices that keep one Tx buffer for all packets report
+   * GetTxAvailable ().
+   *
+   * @param probe a packet the device classifies like the sender's
+   * @return buffer available in bytes
+   */
+  virtual uint32_t GetTxAvailable (Ptr<const Packet> probe) const;
+
+  /**
+   * \param device a pointer to the net device with Tx buffer available
+   * \param avail the bytes available
+   */
+  typedef Callback<void, Ptr<NetDevice>, uint32_t> TxAvailableCallback;
+
+  /**
+   * Wait for Tx buffer space. The callback is invoked once, when at least
+   * the requested bytes are available, and is then forgotten. Each call
+   * queues one wake-up. Devices that never report a full Tx buffer
+   * ignore this.
+   *
+   * \param cb the callback to invoke
+   * \param bytes the bytes the caller needs to make progress
+   * \param weight the share of the caller when the device wakes waiters
+   *        in weighted order
+   * \param probe a packet the device classifies like the caller's, so
+   *        that the bytes are counted in the right Tx buffer; none for
+   *        the buffer GetTxAvailable () reports
+   */
+  virtual void WaitTxAvailable (TxAvailableCallback cb, uint32_t bytes, double weight = 1.0,
+                                Ptr<const Packet> probe = 0);
+
+  /**
+   * Forget a wake-up queued with WaitTxAvailable, if any.
+   *
+   * \param cb the callback given to WaitTxAvailable
    */
-  virtual void ConnectWithoutContext(const CallbackBase& callback);
-  virtual void DisconnectWithoutContext(const CallbackBase& callback);
+  virtual void CancelTxWait (TxAvailableCallback cb);
 
 };
 
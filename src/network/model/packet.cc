@@ -148,6 +148,7 @@ Packet::Packet ()
      * global UID
      */
     m_metadata (static_cast<uint64_t> (Simulator::GetSystemId ()) << 32 | m_globalUid, 0),
+    m_networkHeaderSize (0),
     m_nixVector (0)
 {
   NS_LOG_FUNCTION (this);
@@ -158,7 +159,8 @@ Packet::Packet (const Packet &o)
   : m_buffer (o.m_buffer),
     m_byteTagList (o.m_byteTagList),
     m_packetTagList (o.m_packetTagList),
-    m_metadata (o.m_metadata)
+    m_metadata (o.m_metadata),
+    m_networkHeaderSize (o.m_networkHeaderSize)
 {
   o.m_nixVector ? m_nixVector = o.m_nixVector->Copy ()
     : m_nixVector = 0;
@@ -175,6 +177,7 @@ Packet::operator = (const Packet &o)
   m_byteTagList = o.m_byteTagList;
   m_packetTagList = o.m_packetTagList;
   m_metadata = o.m_metadata;
+  m_networkHeaderSize = o.m_networkHeaderSize;
   o.m_nixVector ? m_nixVector = o.m_nixVector->Copy () 
     : m_nixVector = 0;
   return *this;
@@ -191,6 +194,7 @@ Packet::Packet (uint32_t size)
      * global UID
      */
     m_metadata (static_cast<uint64_t> (Simulator::GetSystemId ()) << 32 | m_globalUid, size),
+    m_networkHeaderSize (0),
     m_nixVector (0)
 {
   NS_LOG_FUNCTION (this << size);
@@ -201,6 +205,7 @@ Packet::Packet (uint8_t const *buffer, uint32_t size, bool magic)
     m_byteTagList (),
     m_packetTagList (),
     m_metadata (0,0),
+    m_networkHeaderSize (0),
     m_nixVector (0)
 {
   NS_LOG_FUNCTION (this << &buffer << size << magic);
@@ -219,6 +224,7 @@ Packet::Packet (uint8_t const*buffer, uint32_t size)
      * global UID
      */
     m_metadata (static_cast<uint64_t> (Simulator::GetSystemId ()) << 32 | m_globalUid, size),
+    m_networkHeaderSize (0),
     m_nixVector (0)
 {
   NS_LOG_FUNCTION (this << &buffer << size);
@@ -234,6 +240,7 @@ Packet::Packet (const Buffer &buffer,  const ByteTagList &byteTagList,
     m_byteTagList (byteTagList),
     m_packetTagList (packetTagList),
     m_metadata (metadata),
+    m_networkHeaderSize (0),
     m_nixVector (0)
 {
   NS_LOG_FUNCTION (this << &buffer << &byteTagList << &packetTagList << &metadata);
@@ -288,6 +295,10 @@ Packet::RemoveHeader (Header &header)
   NS_LOG_FUNCTION (this << &header);
   m_buffer.RemoveAtStart (deserialized);
   m_metadata.RemoveHeader (header, deserialized);
+  if (m_networkHeaderSize > m_buffer.GetSize ())
+    {
+      m_networkHeaderSize = 0;
+    }
   return deserialized;
 }
 uint32_t
@@ -312,6 +323,10 @@ Packet::AddTrailer (const Trailer &trailer)
   Buffer::Iterator end = m_buffer.End ();
   trailer.Serialize (end);
   m_metadata.AddTrailer (trailer, size);
+  if (m_networkHeaderSize != 0)
+    {
+      m_networkHeaderSize += size;
+    }
 }
 uint32_t
 Packet::RemoveTrailer (Trailer &trailer)
@@ -320,6 +335,7 @@ Packet::RemoveTrailer (Trailer &trailer)
   NS_LOG_FUNCTION (this << &trailer);
   m_buffer.RemoveAtEnd (deserialized);
   m_metadata.RemoveTrailer (trailer, deserialized);
+  m_networkHeaderSize = m_networkHeaderSize > deserialized ? m_networkHeaderSize - deserialized : 0;
   return deserialized;
 }
 uint32_t
@@ -345,6 +361,10 @@ Packet::AddAtEnd (Ptr<const Packet> packet)
                    appendPrependOffset);
   m_byteTagList.Add (copy);
   m_metadata.AddAtEnd (packet->m_metadata);
+  if (m_networkHeaderSize != 0)
+    {
+      m_networkHeaderSize += packet->m_buffer.GetSize ();
+    }
 }
 void
 Packet::AddPaddingAtEnd (uint32_t size)
@@ -358,6 +378,10 @@ Packet::AddPaddingAtEnd (uint32_t size)
                               m_buffer.GetCurrentEndOffset () - size);
     }
   m_metadata.AddPaddingAtEnd (size);
+  if (m_networkHeaderSize != 0)
+    {
+      m_networkHeaderSize += size;
+    }
 }
 void 
 Packet::RemoveAtEnd (uint32_t size)
@@ -365,6 +389,7 @@ Packet::RemoveAtEnd (uint32_t size)
   NS_LOG_FUNCTION (this << size);
   m_buffer.RemoveAtEnd (size);
   m_metadata.RemoveAtEnd (size);
+  m_networkHeaderSize = m_networkHeaderSize > size ? m_networkHeaderSize - size : 0;
 }
 void 
 Packet::RemoveAtStart (uint32_t size)
@@ -372,6 +397,10 @@ Packet::RemoveAtStart (uint32_t size)
   NS_LOG_FUNCTION (this << size);
   m_buffer.RemoveAtStart (size);
   m_metadata.RemoveAtStart (size);
+  if (m_networkHeaderSize > m_buffer.GetSize ())
+    {
+      m_networkHeaderSize = 0;
+    }
 }
 
 void 
@@ -408,6 +437,62 @@ Packet::CopyData (std::ostream *os, uint32_t size) const
   return m_buffer.CopyData (os, size);
 }
 
+uint8_t
+Packet::PeekU8 (uint32_t offset) const
+{
+  NS_LOG_FUNCTION (this << offset);
+  Buffer::Iterator i = m_buffer.Begin ();
+  i.Next (offset);
+  return i.ReadU8 ();
+}
+
+uint16_t
+Packet::PeekNtohU16 (uint32_t offset) const
+{
+  NS_LOG_FUNCTION (this << offset);
+  Buffer::Iterator i = m_buffer.Begin ();
+  i.Next (offset);
+  return i.ReadNtohU16 ();
+}
+
+uint32_t
+Packet::PeekNtohU32 (uint32_t offset) const
+{
+  NS_LOG_FUNCTION (this << offset);
+  Buffer::Iterator i = m_buffer.Begin ();
+  i.Next (offset);
+  return i.ReadNtohU32 ();
+}
+
+void
+Packet::PokeU8 (uint32_t offset, uint8_t value)
+{
+  NS_LOG_FUNCTION (this << offset << static_cast<uint32_t> (value));
+  Buffer::Iterator i = m_buffer.Begin ();
+  i.Next (offset);
+  i.WriteU8 (value);
+}
+
+void
+Packet::SetNetworkHeaderMark (void)
+{
+  NS_LOG_FUNCTION (this);
+  m_networkHeaderSize = m_buffer.GetSize ();
+}
+
+bool
+Packet::GetNetworkHeaderOffset (uint32_t &offset) const
+{
+  NS_LOG_FUNCTION (this);
+  uint32_t size = m_buffer.GetSize ();
+  if (m_networkHeaderSize == 0 || m_networkHeaderSize > size)
+    {
+      return false;
+    }
+  offset = size - m_networkHeaderSize;
+  return true;
+}
+
 uint64_t 
 Packet::GetUid (void) const
 {
@@ -357,6 +357,56 @@ public:
    */
   uint32_t CopyData (uint8_t *buffer, uint32_t size) const;
 
+  /**
+   * \param offset offset of the byte to read from the start of the packet.
+   * \returns the byte found at that offset.
+   *
+   * The Peek* methods read fields at a fixed offset directly from the
+   * packet buffer: unlike PeekHeader they neither copy the packet nor
+   * deserialize a whole Header, so they are the cheap way to look at a
+   * few header fields on a forwarding path.
+   */
+  uint8_t PeekU8 (uint32_t offset) const;
+  /**
+   * \param offset offset of the field to read from the start of the packet.
+   * \returns the 16 bit field found at that offset, converted from
+   *          network to host byte order.
+   */
+  uint16_t PeekNtohU16 (uint32_t offset) const;
+  /**
+   * \param offset offset of the field to read from the start of the packet.
+   * \returns the 32 bit field found at that offset, converted from
+   *          network to host byte order.
+   */
+  uint32_t PeekNtohU32 (uint32_t offset) const;
+  /**
+   * \param offset offset of the byte to overwrite from the start of the packet.
+   * \param value the new value of the byte.
+   *
+   * Rewrites a single byte of a header in place, e.g., to set the ECN
+   * codepoint of the network header. The byte is not serialized again
+   * through its Header, so the caller is responsible for keeping any
+   * checksum covering it valid. Like the dirty area of the Buffer, the
+   * byte is written in place and not copied on write.
+   */
+  void PokeU8 (uint32_t offset, uint8_t value);
+
+  /**
+   * Record that the header added last with AddHeader is the network
+   * header of the packet. The mark is carried by copies of the packet
+   * and lets GetNetworkHeaderOffset find the header in constant time,
+   * without packet metadata.
+   */
+  void SetNetworkHeaderMark (void);
+  /**
+   * \param offset set to the offset of the network header from the
+   *        start of the packet.
+   * \returns false if no network header was marked, or if it was
+   *          removed since. Trailers and data added or removed at the
+   *          end of the packet keep the mark valid.
+   */
+  bool GetNetworkHeaderOffset (uint32_t &offset) const;
+
   /**
    * \param os pointer to output stream in which we want
    *        to write the packet data.
@@ -563,6 +613,9 @@ private:
   ByteTagList m_byteTagList;
   PacketTagList m_packetTagList;
   PacketMetadata m_metadata;
+  // Bytes from the start of the network header to the end of the packet,
+  // 0 if no network header is marked
+  uint32_t m_networkHeaderSize;
 
   /* Please see comments above about nix-vector */
   Ptr<NixVector> m_nixVector;
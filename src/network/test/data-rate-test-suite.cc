@@ -0,0 +1,73 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ns3/data-rate.h"
+#include "ns3/test.h"
+
+using namespace ns3;
+
+class DataRateTxTimeTestCase : public TestCase
+{
+public:
+  DataRateTxTimeTestCase ();
+private:
+  virtual void DoRun (void);
+};
+
+DataRateTxTimeTestCase::DataRateTxTimeTestCase ()
+  : TestCase ("Integer transmission time of a data rate")
+{
+}
+
+void
+DataRateTxTimeTestCase::DoRun (void)
+{
+  // The double path rounds these down by one nanosecond
+  NS_TEST_EXPECT_MSG_EQ (DataRate ("1Gbps").CalculateBytesTxTime (1500), NanoSeconds (12000), "1500 bytes at 1Gbps");
+  NS_TEST_EXPECT_MSG_EQ (DataRate ("10Gbps").CalculateBytesTxTime (1500), NanoSeconds (1200), "1500 bytes at 10Gbps");
+  NS_TEST_EXPECT_MSG_EQ (DataRate ("10Gbps").CalculateBytesTxTime (1), NanoSeconds (0), "Less than a nanosecond");
+  NS_TEST_EXPECT_MSG_EQ (DataRate ("32768b/s").CalculateBytesTxTime (1), NanoSeconds (244140), "Slow rate");
+  NS_TEST_EXPECT_MSG_EQ (DataRate ("32768b/s").CalculateBytesTxTime (4096), Seconds (1), "Slow rate, whole second");
+
+  // Rounded down, for rates that leave a remainder
+  uint64_t rates[] = { 1000000000ULL, 10000000000ULL, 40000000000ULL, 1234567ULL, 9999999967ULL };
+  for (uint32_t i = 0; i < sizeof (rates) / sizeof (rates[0]); ++i)
+    {
+      DataRate rate (rates[i]);
+      for (uint32_t bytes = 0; bytes <= 9000; bytes += 7)
+        {
+          uint64_t bits = static_cast<uint64_t> (bytes) * 8;
+          int64_t ns = rate.CalculateBytesTxTime (bytes).GetNanoSeconds ();
+          NS_TEST_ASSERT_MSG_EQ ((ns * rates[i] <= bits * 1000000000ULL
+                                  && bits * 1000000000ULL < (ns + 1) * rates[i]), true,
+                                 bytes << " bytes at " << rates[i] << "bps took " << ns << "ns");
+        }
+    }
+}
+
+class DataRateTestSuite : public TestSuite
+{
+public:
+  DataRateTestSuite ();
+};
+
+DataRateTestSuite::DataRateTestSuite ()
+  : TestSuite ("data-rate", UNIT)
+{
+  AddTestCase (new DataRateTxTimeTestCase);
+}
+
+static DataRateTestSuite g_dataRateTestSuite;
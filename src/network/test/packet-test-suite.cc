@@ -434,6 +434,45 @@ PacketTest::DoRun (void)
     CHECK (tmp, 1, E (20, 1, 1001));
 #endif
   }
+
+  {
+    uint8_t data[] = { 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07 };
+    Ptr<Packet> tmp = Create<Packet> (data, sizeof (data));
+    NS_TEST_EXPECT_MSG_EQ ((uint32_t)tmp->PeekU8 (0), 0x01, "PeekU8");
+    NS_TEST_EXPECT_MSG_EQ (tmp->PeekNtohU16 (1), 0x0203, "PeekNtohU16");
+    NS_TEST_EXPECT_MSG_EQ (tmp->PeekNtohU32 (3), 0x04050607, "PeekNtohU32");
+    // read across the end of a header into the virtual zero area
+    Ptr<Packet> zero = Create<Packet> (16);
+    zero->AddHeader (ATestHeader<2> ());
+    NS_TEST_EXPECT_MSG_EQ (zero->PeekNtohU16 (0), 0x0202, "header bytes");
+    NS_TEST_EXPECT_MSG_EQ (zero->PeekNtohU16 (1), 0x0200, "header to zero area");
+    NS_TEST_EXPECT_MSG_EQ (zero->PeekNtohU32 (4), 0, "zero area");
+    NS_TEST_EXPECT_MSG_EQ (zero->GetSize (), 18, "Peek does not change the packet");
+  }
+
+  {
+    uint32_t offset = 0;
+    Ptr<Packet> tmp = Create<Packet> (100);
+    NS_TEST_EXPECT_MSG_EQ (tmp->GetNetworkHeaderOffset (offset), false, "no network header");
+    tmp->AddHeader (ATestHeader<4> ());
+    tmp->SetNetworkHeaderMark ();
+    tmp->AddHeader (ATestHeader<2> ());
+    tmp->AddTrailer (ATestTrailer<3> ());
+    Ptr<Packet> copy = tmp->Copy ();
+    NS_TEST_EXPECT_MSG_EQ (copy->GetNetworkHeaderOffset (offset), true, "mark follows copies");
+    NS_TEST_EXPECT_MSG_EQ (offset, 2, "below the outer header");
+    copy->PokeU8 (offset + 1, 0x07);
+    NS_TEST_EXPECT_MSG_EQ ((uint32_t)copy->PeekU8 (offset), 0x04, "PokeU8 writes one byte");
+    NS_TEST_EXPECT_MSG_EQ ((uint32_t)copy->PeekU8 (offset + 1), 0x07, "PokeU8");
+    NS_TEST_EXPECT_MSG_EQ ((uint32_t)copy->PeekU8 (offset + 2), 0x04, "PokeU8 writes one byte");
+    copy->RemoveAtStart (2);
+    copy->RemoveAtEnd (3);
+    NS_TEST_EXPECT_MSG_EQ (copy->GetNetworkHeaderOffset (offset), true, "outer header and trailer removed");
+    NS_TEST_EXPECT_MSG_EQ (offset, 0, "network header first");
+    copy->RemoveAtStart (4);
+    copy->AddHeader (ATestHeader<4> ());
+    NS_TEST_EXPECT_MSG_EQ (copy->GetNetworkHeaderOffset (offset), false, "network header removed");
+  }
 }
 //-----------------------------------------------------------------------------
 class PacketTestSuite : public TestSuite
@@ -18,6 +18,7 @@
 // Author: Rajib Bhattacharjea<raj.b@gatech.edu>
 //
 
+#include <limits>
 #include "data-rate.h"
 #include "ns3/nstime.h"
 #include "ns3/fatal-error.h"
@@ -232,6 +233,40 @@ double DataRate::CalculateTxTime (uint32_t bytes) const
   return static_cast<double>(bytes)*8/m_bps;
 }
 
+static uint64_t
+Gcd (uint64_t a, uint64_t b)
+{
+  while (b != 0)
+    {
+      uint64_t r = a % b;
+      a = b;
+      b = r;
+    }
+  return a;
+}
+
+Time DataRate::CalculateBytesTxTime (uint32_t bytes) const
+{
+  NS_LOG_FUNCTION (this << bytes);
+  NS_ASSERT_MSG (m_bps > 0, "Transmission time at a zero data rate");
+  // bits * unitsPerSecond / bps, reduced so that the common rates and
+  // resolutions leave a small factor, and split into the quotient and
+  // the remainder of bits / bps so that the products fit in 64 bits
+  uint64_t unitsPerSecond = Time::FromInteger (1, Time::S).GetTimeStep ();
+  uint64_t gcd = Gcd (unitsPerSecond, m_bps);
+  uint64_t units = unitsPerSecond / gcd;
+  uint64_t bps = m_bps / gcd;
+  uint64_t bits = static_cast<uint64_t> (bytes) * 8;
+  uint64_t quotient = bits / bps;
+  uint64_t remainder = bits % bps;
+  uint64_t max = std::numeric_limits<uint64_t>::max ();
+  if ((quotient != 0 && units > max / quotient) || (remainder != 0 && units > max / remainder))
+    {
+      return Seconds (CalculateTxTime (bytes));
+    }
+  return TimeStep (quotient * units + remainder * units / bps);
+}
+
 uint64_t DataRate::GetBitRate () const
 {
   NS_LOG_FUNCTION (this);
@@ -99,6 +99,17 @@ public:
    */
   double CalculateTxTime (uint32_t bytes) const;
 
+  /**
+   * \brief Calculate transmission time in integer arithmetic
+   *
+   * Unlike CalculateTxTime, the result does not go through a double, so
+   * it is the exact transmission time rounded down to the Time
+   * resolution, on every platform.
+   * \param bytes The number of bytes (not bits) for which to calculate
+   * \return The transmission time for the number of bytes specified
+   */
+  Time CalculateBytesTxTime (uint32_t bytes) const;
+
   /**
    * Get the underlying bitrate
    * \return The underlying bitrate in bits per second
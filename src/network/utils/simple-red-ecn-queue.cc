@@ -78,36 +78,29 @@ void
 SimpleRedEcnQueue::Mark (Ptr<Packet> p)
 {
   NS_LOG_FUNCTION(this);
-  PacketMetadata::ItemIterator metadataIterator = p->BeginItem();
-  PacketMetadata::Item item;
-  while (metadataIterator.HasNext())
+  // Ipv4L3Protocol marks the IP header it adds, so its TOS byte is found
+  // without walking the packet metadata
+  uint32_t offset;
+  if (!p->GetNetworkHeaderOffset (offset))
     {
-      item = metadataIterator.Next();
-      NS_LOG_DEBUG(this << "item name: " << item.tid.GetName());
-      if(item.tid.GetName() == "ns3::Ipv4Header")
-        {
-          NS_LOG_DEBUG("IP packet found");
-          // This is a dirty hack to access the ECN byte: directly read/write from the buffer
-          Buffer::Iterator i = item.current;
-          i.Next (1); // Move to TOS byte
-          uint8_t tos = i.ReadU8 ();
-          uint8_t ecn = tos & 0x3;
-          if (ecn == 1 || ecn == 2)
-            {
-              tos |= 0x3;
-              i.Prev (1); // Go back to the TOS byte after ReadU8()
-              i.WriteU8 (tos);
-            }
-          if ((tos & 0x3) == 0x3)
-            {
-              NS_LOG_LOGIC ("Marking IP packet");
-            }
-          else
-            {
-              NS_LOG_LOGIC ("Unable to mark packet");
-            }
-          break;
-        }
+      NS_LOG_LOGIC ("No IP header, unable to mark packet");
+      return;
+    }
+  offset += 1; // Move to TOS byte
+  uint8_t tos = p->PeekU8 (offset);
+  uint8_t ecn = tos & 0x3;
+  if (ecn == 1 || ecn == 2)
+    {
+      tos |= 0x3;
+      p->PokeU8 (offset, tos);
+    }
+  if ((tos & 0x3) == 0x3)
+    {
+      NS_LOG_LOGIC ("Marking IP packet");
+    }
+  else
+    {
+      NS_LOG_LOGIC ("Unable to mark packet");
     }
 }
 
@@ -102,6 +102,27 @@ PointToPointChannel::TransmitStart (
   return true;
 }
 
+bool
+PointToPointChannel::TransmitPause (
+  Ptr<Packet> frame,
+  Ptr<PointToPointNetDevice> src,
+  uint8_t qIndex,
+  uint32_t time,
+  Time txTime)
+{
+  NS_LOG_FUNCTION (this << src << (uint32_t) qIndex << time);
+
+  NS_ASSERT (m_link[0].m_state != INITIALIZING);
+  NS_ASSERT (m_link[1].m_state != INITIALIZING);
+
+  uint32_t wire = src == m_link[0].m_src ? 0 : 1;
+
+  Simulator::ScheduleWithContext (m_link[wire].m_dst->GetNode ()->GetId (),
+                                  txTime + m_delay, &PointToPointNetDevice::ReceivePauseFrame,
+                                  m_link[wire].m_dst, frame, qIndex, time);
+  return true;
+}
+
 uint32_t 
 PointToPointChannel::GetNDevices (void) const
 {
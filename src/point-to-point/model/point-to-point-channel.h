@@ -72,6 +72,23 @@ public:
    */
   virtual bool TransmitStart (Ptr<Packet> p, Ptr<PointToPointNetDevice> src, Time txTime);
 
+  /**
+   * \brief Transmit a link-layer PAUSE over this channel
+   *
+   * The PAUSE is carried out of band as a typed message and delivered
+   * to PointToPointNetDevice::ReceivePauseFrame of the peer. The frame
+   * only feeds the trace sources of the peer; it is never parsed.
+   *
+   * \param frame The PAUSE frame as seen on the wire
+   * \param src Source PointToPointNetDevice
+   * \param qIndex The priority class to pause
+   * \param time The pause time in microseconds, zero to resume
+   * \param txTime Transmit time to apply
+   * \returns true if successful (currently always true)
+   */
+  virtual bool TransmitPause (Ptr<Packet> frame, Ptr<PointToPointNetDevice> src, uint8_t qIndex,
+                              uint32_t time, Time txTime);
+
   /**
    * \brief Get number of devices on this channel
    * \returns number of devices on this channel
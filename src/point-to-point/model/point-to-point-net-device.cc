@@ -221,7 +221,7 @@ PointToPointNetDevice::TransmitStart (Ptr<Packet> p)
   m_currentPkt = p;
   m_phyTxBeginTrace (m_currentPkt);
 
-  Time txTime = Seconds (m_bps.CalculateTxTime (p->GetSize ()));
+  Time txTime = GetTxTime (p->GetSize ());
   Time txCompleteTime = txTime + m_tInterframeGap;
 
   NS_LOG_LOGIC ("Schedule TransmitCompleteEvent in " << txCompleteTime.GetSeconds () << "sec");
@@ -235,6 +235,31 @@ PointToPointNetDevice::TransmitStart (Ptr<Packet> p)
   return result;
 }
 
+Time
+PointToPointNetDevice::GetTxTime (uint32_t bytes)
+{
+  if (m_txTimesRate != m_bps)
+    {
+      m_txTimes.clear ();
+      m_txTimesRate = m_bps;
+    }
+  // Frames larger than the MTU and the PPP header are not memoized
+  if (bytes > m_mtu + 2)
+    {
+      return m_bps.CalculateBytesTxTime (bytes);
+    }
+  if (bytes >= m_txTimes.size ())
+    {
+      m_txTimes.resize (bytes + 1);
+    }
+  // A zero time is not memoized yet, or too short to matter
+  if (m_txTimes[bytes].IsZero ())
+    {
+      m_txTimes[bytes] = m_bps.CalculateBytesTxTime (bytes);
+    }
+  return m_txTimes[bytes];
+}
+
 void
 PointToPointNetDevice::TransmitComplete (void)
 {
@@ -316,6 +341,22 @@ PointToPointNetDevice::SetReceiveErrorModel (Ptr<ErrorModel> em)
   m_receiveErrorModel = em;
 }
 
+void
+PointToPointNetDevice::ReceivePauseFrame (Ptr<Packet> frame, uint8_t qIndex, uint32_t time)
+{
+  NS_LOG_FUNCTION (this << frame << (uint32_t) qIndex << time);
+  m_snifferTrace (frame);
+  m_promiscSnifferTrace (frame);
+  m_phyRxEndTrace (frame);
+  ReceivePause (qIndex, time);
+}
+
+void
+PointToPointNetDevice::ReceivePause (uint8_t qIndex, uint32_t time)
+{
+  NS_LOG_FUNCTION (this << (uint32_t) qIndex << time);
+}
+
 void
 PointToPointNetDevice::Receive (Ptr<Packet> packet)
 {
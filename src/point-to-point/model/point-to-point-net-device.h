@@ -20,6 +20,7 @@
 #define POINT_TO_POINT_NET_DEVICE_H
 
 #include <cstring>
+#include <vector>
 #include "ns3/address.h"
 #include "ns3/node.h"
 #include "ns3/net-device.h"
@@ -144,6 +145,29 @@ public:
    */
   virtual void Receive (Ptr<Packet> p);
 
+  /**
+   * Receive a link-layer PAUSE from a connected PointToPointChannel.
+   *
+   * PAUSE frames are delivered by the channel as typed control messages
+   * rather than packets. The frame hits the same sniffer and phy trace
+   * hooks as a data frame, then is handed to ReceivePause().
+   *
+   * @see PointToPointChannel::TransmitPause
+   * @param frame The PAUSE frame as seen on the wire
+   * @param qIndex The priority class to pause
+   * @param time The pause time in microseconds, zero to resume
+   */
+  void ReceivePauseFrame (Ptr<Packet> frame, uint8_t qIndex, uint32_t time);
+
+  /**
+   * Act on a link-layer PAUSE. This device does not implement flow
+   * control and ignores it.
+   *
+   * @param qIndex The priority class to pause
+   * @param time The pause time in microseconds, zero to resume
+   */
+  virtual void ReceivePause (uint8_t qIndex, uint32_t time);
+
   // The remaining methods are documented in ns3::NetDevice*
 
   virtual void SetIfIndex (const uint32_t index);
@@ -240,6 +264,15 @@ protected:
    */
   bool TransmitStart (Ptr<Packet> p);
 
+  /**
+   * \param bytes the size of a frame
+   * \returns the time to serialize the frame at the current data rate
+   *
+   * The times of frames up to the MTU are memoized until the data rate
+   * changes.
+   */
+  Time GetTxTime (uint32_t bytes);
+
   /**
    * Stop Sending a Packet Down the Wire and Begin the Interframe Gap.
    *
@@ -271,6 +304,14 @@ protected:
    */
   DataRate       m_bps;
 
+  /**
+   * Transmission times memoized by frame size, and the data rate they
+   * are valid for.
+   * @see GetTxTime
+   */
+  std::vector<Time> m_txTimes;
+  DataRate       m_txTimesRate;
+
   /**
    * The interframe gap that the Net Device uses to throttle packet
    * transmission
@@ -0,0 +1,151 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/*
+ * Per-ACK cost of the DCTCP and D2TCP congestion estimators. Each ACK
+ * acks one segment and one in four echoes congestion; an echo costs a
+ * penalty lookup and every window of 16 ACKs folds into alpha.  The
+ * "double" run is the floating-point D2TCP arithmetic the estimators
+ * replaced, for comparison.
+ */
+
+#include "ns3/system-wall-clock-ms.h"
+#include "ns3/simulator.h"
+#include "ns3/dctcp-control.h"
+#include <cmath>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <string.h>
+#include <stdlib.h> // for exit ()
+
+using namespace ns3;
+
+static const uint32_t g_segmentSize = 1448;
+static const uint32_t g_window = 16;
+static volatile uint32_t g_sink;
+
+static void
+benchControl (Ptr<DctcpControl> control, Time deadline, uint32_t n)
+{
+  Time rtt = MicroSeconds (100);
+  uint32_t cWnd = g_window * g_segmentSize;
+  for (uint32_t i = 0; i < n; i++)
+    {
+      bool ece = (i & 3) == 0;
+      control->Acked (g_segmentSize, ece);
+      if (ece)
+        {
+          g_sink = control->GetPenalty ();
+        }
+      if (i % g_window == g_window - 1)
+        {
+          control->Update (cWnd, g_segmentSize, deadline, rtt);
+        }
+    }
+}
+
+static void
+benchDctcp (uint32_t n)
+{
+  benchControl (CreateObject<DctcpControl> (), Seconds (-1), n);
+}
+
+static void
+benchD2tcp (uint32_t n)
+{
+  benchControl (CreateObject<D2tcpControl> (), MicroSeconds (1000), n);
+}
+
+static void
+benchDouble (uint32_t n)
+{
+  uint32_t alpha = 0;
+  double gamma = 1;
+  uint32_t ackedBytesEcn = 0;
+  uint32_t ackedBytesTotal = 0;
+  uint32_t cWnd = g_window * g_segmentSize;
+  int64_t remaining = 9;
+  for (uint32_t i = 0; i < n; i++)
+    {
+      bool ece = (i & 3) == 0;
+      ackedBytesTotal += g_segmentSize;
+      if (ece)
+        {
+          ackedBytesEcn += g_segmentSize;
+          g_sink = std::min<uint32_t> (static_cast<uint32_t> (1024 * std::pow (alpha / 1024.0, gamma)), 1024);
+        }
+      if (i % g_window == g_window - 1)
+        {
+          alpha = alpha - (alpha >> 4) + (ackedBytesEcn << 6) / ackedBytesTotal;
+          alpha = std::min<uint32_t> (alpha, 1024);
+          double w = cWnd / g_segmentSize;
+          double tc1 = std::sqrt (std::pow ((w + 1.0) / 2.0, 2.0) + 2.0 * g_segmentSize) - (w + 1.0) / 2.0;
+          double tc2 = g_segmentSize / (3.0 * w / 4.0 + 0.5);
+          double newGamma = std::max (tc1, tc2) / (double) remaining;
+          gamma = std::min (std::max (0.75 * gamma + 0.25 * newGamma, 0.4), 2.0);
+          ackedBytesEcn = 0;
+          ackedBytesTotal = 0;
+        }
+    }
+}
+
+static void
+runBench (void (*bench) (uint32_t), uint32_t n, char const *name)
+{
+  SystemWallClockMs time;
+  time.Start ();
+  (*bench) (n);
+  uint64_t deltaMs = time.End ();
+  if (deltaMs == 0)
+    {
+      deltaMs = 1;
+    }
+  double ps = n;
+  ps *= 1000;
+  ps /= deltaMs;
+  std::cout << name << "=" << ps << " acks/s, " << 1e9 / ps << " ns/ack" << std::endl;
+}
+
+int main (int argc, char *argv[])
+{
+  uint32_t n = 0;
+  while (argc > 0) {
+      if (strncmp ("--n=", argv[0],strlen ("--n=")) == 0)
+        {
+          char const *nAscii = argv[0] + strlen ("--n=");
+          std::istringstream iss;
+          iss.str (nAscii);
+          iss >> n;
+        }
+      argc--;
+      argv++;
+  }
+  if (n == 0)
+    {
+      std::cerr << "Error-- number of acks must be specified " <<
+        "by command-line argument --n=(number of acks)" << std::endl;
+      exit (1);
+    }
+  std::cout << "Running bench-dctcp with n=" << n << std::endl;
+
+  runBench (&benchDctcp, n, "dctcp");
+  runBench (&benchD2tcp, n, "d2tcp");
+  runBench (&benchDouble, n, "double");
+
+  Simulator::Destroy ();
+  return 0;
+}
@@ -0,0 +1,158 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/*
+ * Replays a scheduler trace, as written by ns3::RecordingScheduler,
+ * against each scheduler and reports the time per operation.  The
+ * scheduler calls are made directly, without the simulator around
+ * them, so the numbers compare the event lists alone.
+ *
+ *   ./waf --run "scratch/oldi_sim --SchedulerType=ns3::RecordingScheduler
+ *                --ns3::RecordingScheduler::FileName=oldi.events ..."
+ *   bench-scheduler oldi.events
+ */
+
+#include "ns3/core-module.h"
+#include "ns3/recording-scheduler.h"
+#include <iostream>
+#include <fstream>
+#include <algorithm>
+#include <vector>
+#include <string.h>
+#include <stdlib.h> // for exit ()
+
+using namespace ns3;
+
+static std::vector<SchedulerTraceEntry>
+ReadTrace (char const *filename)
+{
+  std::vector<SchedulerTraceEntry> trace;
+  std::ifstream file (filename, std::ios::in | std::ios::binary);
+  char magic[8];
+  if (!file.read (magic, 8) || memcmp (magic, "NS3EVT01", 8) != 0)
+    {
+      std::cerr << "Error-- " << filename << " is not a scheduler trace" << std::endl;
+      exit (1);
+    }
+  SchedulerTraceEntry entry;
+  while (file.read (reinterpret_cast<char *> (&entry), sizeof (entry)))
+    {
+      trace.push_back (entry);
+    }
+  return trace;
+}
+
+static void
+runBench (const std::vector<SchedulerTraceEntry> &trace, char const *type, uint32_t n)
+{
+  uint64_t deltaMs = 0;
+  uint32_t mismatches = 0;
+  for (uint32_t i = 0; i < n; i++)
+    {
+      ObjectFactory factory;
+      factory.SetTypeId (type);
+      Ptr<Scheduler> scheduler = factory.Create<Scheduler> ();
+      SystemWallClockMs time;
+      time.Start ();
+      for (std::vector<SchedulerTraceEntry>::const_iterator j = trace.begin (); j != trace.end (); j++)
+        {
+          Scheduler::Event ev;
+          ev.impl = 0;
+          ev.key.m_ts = j->ts;
+          ev.key.m_uid = j->uid;
+          ev.key.m_context = 0;
+          switch (j->op)
+            {
+            case SchedulerTraceEntry::INSERT:
+              scheduler->Insert (ev);
+              break;
+            case SchedulerTraceEntry::REMOVE_NEXT:
+              if (scheduler->RemoveNext ().key.m_uid != j->uid)
+                {
+                  mismatches++;
+                }
+              break;
+            case SchedulerTraceEntry::REMOVE:
+              scheduler->Remove (ev);
+              break;
+            }
+        }
+      deltaMs += time.End ();
+    }
+  if (deltaMs == 0)
+    {
+      deltaMs = 1;
+    }
+  double ns = deltaMs * 1e6 / (double (trace.size ()) * n);
+  std::cout << type << "=" << ns << " ns/op, " << deltaMs << " ms";
+  if (mismatches != 0)
+    {
+      std::cout << ", " << mismatches << " events out of order";
+    }
+  std::cout << std::endl;
+}
+
+int main (int argc, char *argv[])
+{
+  if (argc < 2)
+    {
+      std::cerr << "bench-scheduler filename [--n=repeats] [--list]" << std::endl;
+      exit (1);
+    }
+  std::vector<SchedulerTraceEntry> trace = ReadTrace (argv[1]);
+  uint32_t n = 1;
+  bool list = false;
+  for (int i = 2; i < argc; i++)
+    {
+      if (strncmp ("--n=", argv[i], strlen ("--n=")) == 0)
+        {
+          n = atoi (argv[i] + strlen ("--n="));
+        }
+      else if (strcmp ("--list", argv[i]) == 0)
+        {
+          list = true;
+        }
+    }
+
+  uint64_t inserts = 0;
+  uint32_t pending = 0;
+  uint32_t maxPending = 0;
+  for (std::vector<SchedulerTraceEntry>::const_iterator j = trace.begin (); j != trace.end (); j++)
+    {
+      if (j->op == SchedulerTraceEntry::INSERT)
+        {
+          inserts++;
+          pending++;
+          maxPending = std::max (pending, maxPending);
+        }
+      else
+        {
+          pending--;
+        }
+    }
+  std::cout << "Running bench-scheduler with " << trace.size () << " operations, " <<
+    inserts << " events, at most " << maxPending << " pending" << std::endl;
+
+  runBench (trace, "ns3::MapScheduler", n);
+  runBench (trace, "ns3::HeapScheduler", n);
+  runBench (trace, "ns3::RadixHeapScheduler", n);
+  runBench (trace, "ns3::CalendarScheduler", n);
+  if (list)
+    {
+      runBench (trace, "ns3::ListScheduler", n);
+    }
+  return 0;
+}
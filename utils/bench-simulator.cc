@@ -104,6 +104,9 @@ Bench::RunBench (void)
       "simu " << ((double)m_n) / simu<< " hold/s, avg hold=" << 
       simu / ((double)m_n) << "s" << std::endl
       ;
+  EventImpl::PoolStats pool = EventImpl::GetPoolStats ();
+  std::cout << "events allocated=" << pool.allocated << ", recycled=" << pool.recycled <<
+    ", system allocations avoided=" << pool.avoided << std::endl;
 }
 
 void
@@ -135,6 +138,7 @@ PrintHelp (void)
   std::cout << "      --list: use std::list scheduler"<<std::endl;
   std::cout << "      --map: use std::map cheduler"<<std::endl;
   std::cout << "      --heap: use Binary Heap scheduler"<<std::endl;
+  std::cout << "      --radix: use Radix Heap scheduler"<<std::endl;
   std::cout << "      --debug: enable some debugging"<<std::endl;
 }
 
@@ -177,6 +181,11 @@ int main (int argc, char *argv[])
           factory.SetTypeId ("ns3::HeapScheduler");
           Simulator::SetScheduler (factory);
         } 
+      else if (strcmp ("--radix", argv[0]) == 0)
+        {
+          factory.SetTypeId ("ns3::RadixHeapScheduler");
+          Simulator::SetScheduler (factory);
+        }
       else if (strcmp ("--calendar", argv[0]) == 0)
         {
           factory.SetTypeId ("ns3::CalendarScheduler");
@@ -0,0 +1,70 @@
+#!/usr/bin/env python
+## -*- Mode: python; py-indent-offset: 4; indent-tabs-mode: nil; coding: utf-8; -*-
+#
+# Reader for the flow record files (*.fctb) written by ns3::FlowRecordWriter.
+#
+#   import fct_records
+#   for stop, fct, nbytes, flows in fct_records.read_records ("incasts.X-1.fctb"):
+#       ...
+#
+# Run as a script, it prints the records in the old text format,
+# "- [stop, fct, bytes, flows]", or with --npz stores them as compressed
+# numpy columns.
+
+import struct
+import sys
+
+MAGIC = b'NS3FCT01'
+RECORD = struct.Struct('=qqQII')   # stop ns, duration ns, bytes, flows, reserved
+BATCH = 4096
+
+def read_records(path):
+    """Yield (stop seconds, fct seconds, bytes, flows) for each record."""
+    f = open(path, 'rb')
+    try:
+        if f.read(len(MAGIC)) != MAGIC:
+            raise ValueError('%s is not a flow record file' % path)
+        while True:
+            chunk = f.read(RECORD.size * BATCH)
+            for i in range(len(chunk) // RECORD.size):
+                stop, duration, nbytes, flows, _ = RECORD.unpack_from(chunk, i * RECORD.size)
+                yield stop / 1e9, duration / 1e9, nbytes, flows
+            if len(chunk) < RECORD.size * BATCH:
+                break
+    finally:
+        f.close()
+
+def read_columns(path):
+    """Return the records as numpy arrays: stop, fct, bytes, flows."""
+    import numpy
+    dtype = numpy.dtype([('stop', '=i8'), ('duration', '=i8'), ('bytes', '=u8'),
+                         ('flows', '=u4'), ('reserved', '=u4')])
+    data = numpy.fromfile(path, dtype=numpy.uint8)
+    if bytes(bytearray(data[:len(MAGIC)])) != MAGIC:
+        raise ValueError('%s is not a flow record file' % path)
+    records = data[len(MAGIC):].view(dtype)
+    return (records['stop'] / 1e9, records['duration'] / 1e9,
+            records['bytes'], records['flows'])
+
+def main(argv):
+    if len(argv) < 2:
+        sys.stderr.write('Usage: %s [--npz out.npz] file.fctb...\n' % argv[0])
+        return 1
+    if argv[1] == '--npz':
+        import numpy
+        columns = {}
+        for path in argv[3:]:
+            stop, fct, nbytes, flows = read_columns(path)
+            columns[path + ':stop'] = stop
+            columns[path + ':fct'] = fct
+            columns[path + ':bytes'] = nbytes
+            columns[path + ':flows'] = flows
+        numpy.savez_compressed(argv[2], **columns)
+        return 0
+    for path in argv[1:]:
+        for stop, fct, nbytes, flows in read_records(path):
+            sys.stdout.write('- [%g, %g, %d, %d]\n' % (stop, fct, nbytes, flows))
+    return 0
+
+if __name__ == '__main__':
+    sys.exit(main(sys.argv))
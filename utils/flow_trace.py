@@ -0,0 +1,46 @@
+#!/usr/bin/env python
+## -*- Mode: python; py-indent-offset: 4; indent-tabs-mode: nil; coding: utf-8; -*-
+#
+# Writer for the flow trace files (*.flows) replayed by ns3::FlowTraceHelper.
+#
+#   python flow_trace.py flows.txt flows.flows
+#
+# The text input has one flow per line, "start-seconds src dst bytes",
+# where src and dst index the hosts of the simulation.  Lines starting
+# with '#' are skipped.  Flows are sorted by start time on the way out.
+
+import struct
+import sys
+
+MAGIC = b'NS3FLW01'
+ENTRY = struct.Struct('=qIIQ')   # start ns, src, dst, bytes
+
+def write_trace(path, flows):
+    """Write (start seconds, src, dst, bytes) tuples to a flow trace file."""
+    f = open(path, 'wb')
+    try:
+        f.write(MAGIC)
+        for start, src, dst, nbytes in sorted(flows):
+            f.write(ENTRY.pack(int(round(start * 1e9)), src, dst, nbytes))
+    finally:
+        f.close()
+
+def read_text(path):
+    flows = []
+    for line in open(path):
+        line = line.strip()
+        if not line or line.startswith('#'):
+            continue
+        start, src, dst, nbytes = line.split()
+        flows.append((float(start), int(src), int(dst), int(nbytes)))
+    return flows
+
+def main(argv):
+    if len(argv) != 3:
+        sys.stderr.write('Usage: %s flows.txt out.flows\n' % argv[0])
+        return 1
+    write_trace(argv[2], read_text(argv[1]))
+    return 0
+
+if __name__ == '__main__':
+    sys.exit(main(sys.argv))